@@ -0,0 +1,533 @@
+// Author: Dr Stephen Braithwaite.
+// This work is licensed under a Creative Commons Attribution-ShareAlike 4.0 International License.
+
+// Compares the hash tables of the library.
+//
+// For csc_hash_t, csc_flatHash_t, csc_concHash_t (from one thread) and a
+// csc_hashMap_code() map, with string keys and with pointer keys, and at
+// sizes from minSize to maxSize in powers of ten, this times inserting
+// every key, looking up every key (hits), looking up as many keys that
+// are not present (misses), iterating over the whole table and deleting
+// every key.  It reports nanoseconds per operation, and the bytes of heap
+// the table uses per entry, not counting the records and keys.  That
+// includes memcheck's header on each block while it is on in std.h.
+//
+// It then reports on the quality of csc_hash_str() and csc_hash_ptr().
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+#include <malloc.h>
+#include <CscNetLib/std.h>
+#include <CscNetLib/alloc.h>
+#include <CscNetLib/isvalid.h>
+#include <CscNetLib/hash.h>
+#include <CscNetLib/flatHash.h>
+#include <CscNetLib/concHash.h>
+#include <CscNetLib/hashMap.h>
+
+
+typedef enum
+{   key_Str = 0,   // The record holds a pointer to a string key.
+    key_Ptr,       // The key is the address of the record.
+    key_N
+} keyKind_t;
+
+static const char *keyNames[key_N] = { "str", "ptr" };
+
+
+// The key field is first, so a pointer to the record is also a pointer to
+// the key for both kinds of table.
+typedef struct
+{   char *name;
+    long val;
+} rec_t;
+
+
+// Each table is driven through these.
+typedef struct
+{   const char *name;
+    void *(*make)(keyKind_t kind);
+    void (*add)(void *t, rec_t *rec);
+    rec_t *(*get)(void *t, rec_t *key);
+    int (*del)(void *t, rec_t *key);
+    long (*iterate)(void *t);
+    void (*destroy)(void *t);
+} table_t;
+
+
+typedef struct
+{   double insert, hit, miss, iterate, delete;   // Nanoseconds per op.
+    double bytes;                                // Per entry.
+} result_t;
+
+
+// The key kind of the table being measured.
+static keyKind_t curKind;
+
+// Somewhere for results to go, so that lookups are not optimised away.
+static volatile long sink;
+
+
+static double nowNs(void)
+{   struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec*1e9 + ts.tv_nsec;
+}
+
+
+static size_t heapInUse(void)
+{   struct mallinfo2 mi = mallinfo2();
+    return mi.uordblks + mi.hblkhd;
+}
+
+
+static uint64_t rnd(uint64_t *state)
+{   uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    return *state = x;
+}
+
+
+// -------------------------------------------------------------------
+// csc_hash_t, csc_flatHash_t and csc_concHash_t are all driven the same
+// way.
+// -------------------------------------------------------------------
+
+static void *hashMake(keyKind_t kind)
+{   if (kind == key_Str)
+        return csc_hash_new(0, csc_hash_StrPtCmpr, csc_hash_StrPt, csc_hash_FreeNothing);
+    else
+        return csc_hash_new(0, csc_hash_PtrCmpr, csc_hash_ptr, csc_hash_FreeNothing);
+}
+
+static void hashAdd(void *t, rec_t *rec) { csc_hash_add(t, rec); }
+static rec_t *hashGet(void *t, rec_t *key) { return csc_hash_get(t, key); }
+static int hashDel(void *t, rec_t *key) { return csc_hash_del(t, key); }
+static void hashDestroy(void *t) { csc_hash_free(t); }
+
+static long hashIterate(void *t)
+{   csc_hash_iter_t iter;
+    rec_t *rec;
+    long sum = 0;
+    for_hash_all((csc_hash_t*)t, iter, rec, rec_t*)
+        sum += rec->val;
+    return sum;
+}
+
+
+static void *flatMake(keyKind_t kind)
+{   if (kind == key_Str)
+        return csc_flatHash_new(0, csc_hash_StrPtCmpr, csc_hash_StrPt, csc_hash_FreeNothing);
+    else
+        return csc_flatHash_new(0, csc_hash_PtrCmpr, csc_hash_ptr, csc_hash_FreeNothing);
+}
+
+static void flatAdd(void *t, rec_t *rec) { csc_flatHash_add(t, rec); }
+static rec_t *flatGet(void *t, rec_t *key) { return csc_flatHash_get(t, key); }
+static int flatDel(void *t, rec_t *key) { return csc_flatHash_del(t, key); }
+static void flatDestroy(void *t) { csc_flatHash_free(t); }
+
+static long flatIterate(void *t)
+{   csc_flatHash_iter_t iter;
+    rec_t *rec;
+    long sum = 0;
+    for_flatHash_all((csc_flatHash_t*)t, iter, rec, rec_t*)
+        sum += rec->val;
+    return sum;
+}
+
+
+static void *concMake(keyKind_t kind)
+{   if (kind == key_Str)
+        return csc_concHash_new(0, csc_hash_StrPtCmpr, csc_hash_StrPt, csc_hash_FreeNothing);
+    else
+        return csc_concHash_new(0, csc_hash_PtrCmpr, csc_hash_ptr, csc_hash_FreeNothing);
+}
+
+static void concAdd(void *t, rec_t *rec) { csc_concHash_add(t, rec); }
+static rec_t *concGet(void *t, rec_t *key) { return csc_concHash_get(t, key); }
+static int concDel(void *t, rec_t *key) { return csc_concHash_del(t, key); }
+static void concDestroy(void *t) { csc_concHash_free(t); }
+
+static void concSum(void *rec, void *context)
+{   *(long*)context += ((rec_t*)rec)->val;
+}
+
+static long concIterate(void *t)
+{   long sum = 0;
+    csc_concHash_forEach(t, concSum, &sum);
+    return sum;
+}
+
+
+// -------------------------------------------------------------------
+// The generated maps have their key type fixed, so there is one for each
+// kind of key.
+// -------------------------------------------------------------------
+
+#define strHash(key) csc_hash_str((void*)(key))
+#define strEq(a,b) (strcmp((a),(b))==0)
+#define ptrHash(key) csc_hashMap_mixInt((csc_ulong)(key))
+#define ptrEq(a,b) ((a)==(b))
+
+csc_hashMap_headers(strMap, const char*, rec_t*, strHash, strEq)
+csc_hashMap_code(strMap, const char*, rec_t*, strHash, strEq)
+csc_hashMap_headers(ptrMap, void*, rec_t*, ptrHash, ptrEq)
+csc_hashMap_code(ptrMap, void*, rec_t*, ptrHash, ptrEq)
+
+static void *mapMake(keyKind_t kind)
+{   if (kind == key_Str)
+        return strMap_new();
+    else
+        return ptrMap_new();
+}
+
+static void mapAdd(void *t, rec_t *rec)
+{   if (curKind == key_Str)
+        strMap_put(t, rec->name, rec);
+    else
+        ptrMap_put(t, rec, rec);
+}
+
+static rec_t *mapGet(void *t, rec_t *key)
+{   rec_t **val;
+    if (curKind == key_Str)
+        val = strMap_get(t, key->name);
+    else
+        val = ptrMap_get(t, key);
+    return val!=NULL ? *val : NULL;
+}
+
+static int mapDel(void *t, rec_t *key)
+{   if (curKind == key_Str)
+        return strMap_del(t, key->name);
+    else
+        return ptrMap_del(t, key);
+}
+
+static long mapIterate(void *t)
+{   csc_ulong iter = 0;
+    rec_t *rec;
+    long sum = 0;
+    if (curKind == key_Str)
+    {   while (strMap_next(t, &iter, NULL, &rec))
+            sum += rec->val;
+    }
+    else
+    {   while (ptrMap_next(t, &iter, NULL, &rec))
+            sum += rec->val;
+    }
+    return sum;
+}
+
+static void mapDestroy(void *t)
+{   if (curKind == key_Str)
+        strMap_free(t);
+    else
+        ptrMap_free(t);
+}
+
+
+static const table_t tables[] =
+{   { "hash",     hashMake, hashAdd, hashGet, hashDel, hashIterate, hashDestroy }
+,   { "flatHash", flatMake, flatAdd, flatGet, flatDel, flatIterate, flatDestroy }
+,   { "concHash", concMake, concAdd, concGet, concDel, concIterate, concDestroy }
+,   { "hashMap",  mapMake,  mapAdd,  mapGet,  mapDel,  mapIterate,  mapDestroy  }
+};
+#define NTables (sizeof(tables)/sizeof(tables[0]))
+
+
+// -------------------------------------------------------------------
+// The keys.
+// -------------------------------------------------------------------
+
+typedef struct
+{   long n;
+    rec_t *recs;       // The records to insert.
+    rec_t *misses;     // Keys that are never inserted.
+    rec_t **order;     // The records in a random order for lookups.
+    char *names;
+} keySet_t;
+
+
+static void keysMake(keySet_t *ks, long n)
+{   uint64_t seed = 88172645463325252ULL;
+    char *pt;
+    rec_t *tmp;
+    long j;
+
+// The names are in one block, as the records are, so that the heap in
+// use while a table exists is the table's alone.
+    ks->n = n;
+    ks->recs = csc_allocMany(rec_t, n);
+    ks->misses = csc_allocMany(rec_t, n);
+    ks->order = csc_allocMany(rec_t*, n);
+    ks->names = csc_allocMany(char, n*2*24);
+    pt = ks->names;
+    for (long i=0; i<n; i++)
+    {   ks->recs[i].name = pt;
+        pt += sprintf(pt, "user:%ld", i) + 1;
+        ks->recs[i].val = i;
+        ks->misses[i].name = pt;
+        pt += sprintf(pt, "miss:%ld", i) + 1;
+        ks->misses[i].val = i;
+        ks->order[i] = &ks->recs[i];
+    }
+    for (long i=n-1; i>0; i--)
+    {   j = (long)(rnd(&seed) % (uint64_t)(i+1));
+        tmp = ks->order[i];
+        ks->order[i] = ks->order[j];
+        ks->order[j] = tmp;
+    }
+}
+
+
+static void keysFree(keySet_t *ks)
+{   free(ks->recs);
+    free(ks->misses);
+    free(ks->order);
+    free(ks->names);
+}
+
+
+// -------------------------------------------------------------------
+// Timing.
+// -------------------------------------------------------------------
+
+// Builds and tears down the table 'reps' times, so that small tables are
+// timed over enough operations to be measured.
+static result_t runTable(const table_t *tbl, keyKind_t kind, keySet_t *ks, int reps)
+{   long n = ks->n;
+    result_t res;
+    size_t heap0;
+    double t0;
+    void *t;
+    long sum;
+
+    memset(&res, 0, sizeof(res));
+    curKind = kind;
+    for (int r=0; r<reps; r++)
+    {   heap0 = heapInUse();
+        t0 = nowNs();
+        t = tbl->make(kind);
+        for (long i=0; i<n; i++)
+            tbl->add(t, &ks->recs[i]);
+        res.insert += nowNs() - t0;
+        if (r == 0)
+            res.bytes = (double)(heapInUse() - heap0) / n;
+
+        sum = 0;
+        t0 = nowNs();
+        for (long i=0; i<n; i++)
+            sum += tbl->get(t, ks->order[i])->val;
+        res.hit += nowNs() - t0;
+
+        t0 = nowNs();
+        for (long i=0; i<n; i++)
+            sum += tbl->get(t, &ks->misses[i]) != NULL;
+        res.miss += nowNs() - t0;
+
+        t0 = nowNs();
+        sum += tbl->iterate(t);
+        res.iterate += nowNs() - t0;
+
+        t0 = nowNs();
+        for (long i=0; i<n; i++)
+            sum += tbl->del(t, ks->order[i]);
+        res.delete += nowNs() - t0;
+
+        tbl->destroy(t);
+        sink += sum;
+    }
+
+    res.insert /= (double)n * reps;
+    res.hit /= (double)n * reps;
+    res.miss /= (double)n * reps;
+    res.iterate /= (double)n * reps;
+    res.delete /= (double)n * reps;
+    return res;
+}
+
+
+static void report(const table_t *tbl, keyKind_t kind, long n, result_t res)
+{   fprintf( stdout, "%-9s %-4s %9ld %8.1f %8.1f %8.1f %8.1f %8.1f %8.1f\n"
+           , tbl->name, keyNames[kind], n
+           , res.insert, res.hit, res.miss, res.iterate, res.delete, res.bytes
+           );
+    fflush(stdout);
+}
+
+
+// -------------------------------------------------------------------
+// Hash quality.
+// -------------------------------------------------------------------
+
+#define QualBits 16
+#define QualKeys (1L<<20)
+#define AvalTrials 10000
+
+// The tables index chains with the low bits of the hash value, so that is
+// what is tested.  Gives chi squared over its degrees of freedom, which is
+// near 1 for a good hash, and the fullest bucket over the mean.
+static void spread(const char *title, csc_ulong (*hashOf)(long i))
+{   csc_ulong nBkt = 1UL << QualBits;
+    csc_ulong *bkt = csc_ck_calloc(nBkt * sizeof(csc_ulong));
+    double mean = (double)QualKeys / nBkt;
+    double chi2 = 0;
+    csc_ulong most = 0;
+
+    for (long i=0; i<QualKeys; i++)
+        bkt[hashOf(i) & (nBkt-1)]++;
+    for (csc_ulong i=0; i<nBkt; i++)
+    {   chi2 += (bkt[i]-mean) * (bkt[i]-mean) / mean;
+        if (bkt[i] > most)
+            most = bkt[i];
+    }
+    fprintf( stdout, "%-28s chi2/df %6.3f   max/mean %5.2f\n"
+           , title, chi2/(nBkt-1), most/mean);
+    free(bkt);
+}
+
+
+// For each bit of the input, the chance that flipping it flips each bit
+// of the hash value should be one half.  Reports the mean and worst
+// distance from one half, as a fraction of one half.
+static void avalanche( const char *title, int nInBits
+                     , csc_ulong (*hashFlip)(uint64_t *state, int bit, csc_ulong *flipped))
+{   int nOutBits = sizeof(csc_ulong) * 8;
+    long *counts = csc_ck_calloc(nInBits * nOutBits * sizeof(long));
+    uint64_t state = 0x9E3779B97F4A7C15ULL;
+    double bias, worst = 0, total = 0;
+    csc_ulong hv, hvf, diff;
+    uint64_t st;
+
+    for (long t=0; t<AvalTrials; t++)
+    {   for (int b=0; b<nInBits; b++)
+        {   st = state;
+            hv = hashFlip(&st, -1, NULL);
+            st = state;
+            hashFlip(&st, b, &hvf);
+            diff = hv ^ hvf;
+            for (int o=0; o<nOutBits; o++)
+                counts[b*nOutBits+o] += (diff >> o) & 1;
+        }
+        rnd(&state);
+    }
+    for (int i=0; i<nInBits*nOutBits; i++)
+    {   bias = fabs(2.0*counts[i]/AvalTrials - 1);
+        total += bias;
+        if (bias > worst)
+            worst = bias;
+    }
+    fprintf( stdout, "%-28s avalanche bias mean %5.3f worst %5.3f\n"
+           , title, total/(nInBits*nOutBits), worst);
+    free(counts);
+}
+
+
+static csc_ulong strSeqHash(long i)
+{   char buf[32];
+    sprintf(buf, "user:%ld", i);
+    return csc_hash_str(buf);
+}
+
+static csc_ulong ptrHeapHash(long i)
+{   return csc_hash_ptr((char*)0x5555555a0000 + i*32);
+}
+
+static csc_ulong ptrPageHash(long i)
+{   return csc_hash_ptr((char*)0x7f0000000000 + i*4096);
+}
+
+
+// Hashes 12 random letters, or the same with 'bit' flipped.  Letters stay
+// non zero whichever bit is flipped.
+#define AvalStrLen 12
+
+static csc_ulong strFlip(uint64_t *state, int bit, csc_ulong *flipped)
+{   char buf[AvalStrLen+1];
+    csc_ulong hv;
+    for (int i=0; i<AvalStrLen; i++)
+        buf[i] = 'a' + rnd(state) % 26;
+    buf[AvalStrLen] = '\0';
+    if (bit >= 0)
+        buf[bit/8] ^= (char)(1 << bit%8);
+    hv = csc_hash_str(buf);
+    if (flipped != NULL)
+        *flipped = hv;
+    return hv;
+}
+
+static csc_ulong ptrFlip(uint64_t *state, int bit, csc_ulong *flipped)
+{   uintptr_t p = (uintptr_t)rnd(state) & ~(uintptr_t)15;
+    csc_ulong hv;
+    if (bit >= 0)
+        p ^= (uintptr_t)1 << bit;
+    hv = csc_hash_ptr((void*)p);
+    if (flipped != NULL)
+        *flipped = hv;
+    return hv;
+}
+
+
+static void quality(void)
+{   fprintf(stdout, "\nHash quality, low %d bits, %ld keys:-\n", QualBits, QualKeys);
+    spread("csc_hash_str \"user:N\"", strSeqHash);
+    spread("csc_hash_ptr 32 byte stride", ptrHeapHash);
+    spread("csc_hash_ptr 4096 byte stride", ptrPageHash);
+    avalanche("csc_hash_str 12 letters", AvalStrLen*8, strFlip);
+    avalanche("csc_hash_ptr", sizeof(void*)*8, ptrFlip);
+}
+
+
+static void usage(char *progname)
+{   fprintf( stderr
+           , "Usage %s minSize maxSize\n\n"
+             "   where minSize is the number of keys in the smallest tables\n"
+             "     maxSize is the number in the largest, each size being ten\n"
+             "     times the last\n\n"
+           , progname
+           );
+    exit(1);
+}
+
+
+int main(int argc, char **argv)
+{   int minSize, maxSize, reps;
+    keySet_t ks;
+    result_t res;
+
+// Check the command line arguments.
+    if (argc != 3)
+        usage(argv[0]);
+    if (  !csc_isValidRange_int(argv[1], 1, 100000000, &minSize)
+       || !csc_isValidRange_int(argv[2], minSize, 100000000, &maxSize)
+       )
+        usage(argv[0]);
+
+    fprintf( stdout, "%-9s %-4s %9s %8s %8s %8s %8s %8s %8s\n"
+           , "table", "key", "n", "insert", "hit", "miss", "iterate", "delete", "bytes");
+    fprintf( stdout, "%-9s %-4s %9s %8s %8s %8s %8s %8s %8s\n"
+           , "", "", "", "ns/op", "ns/op", "ns/op", "ns/op", "ns/op", "/entry");
+
+    for (long n=minSize; n<=maxSize; n*=10)
+    {   keysMake(&ks, n);
+        reps = n < 1000000 ? 1000000 / n : 1;
+        for (keyKind_t kind=0; kind<key_N; kind++)
+        {   for (size_t i=0; i<NTables; i++)
+            {   res = runTable(&tables[i], kind, &ks, reps);
+                report(&tables[i], kind, n, res);
+            }
+        }
+        keysFree(&ks);
+    }
+
+    quality();
+    exit(0);
+}
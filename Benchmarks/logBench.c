@@ -0,0 +1,243 @@
+// Author: Dr Stephen Braithwaite.
+// This work is licensed under a Creative Commons Attribution-ShareAlike 4.0 International License.
+
+// Measures the throughput and call latency of the logger.
+//
+// For each logger backend, and for both filtered entries (below the
+// logging threshold) and unfiltered entries, this runs csc_log_str() and
+// csc_log_printf() from 1, 2, 4 ... maxThreads threads, and then from
+// nProcs forked processes.  It reports lines per second over all workers
+// and the 99th percentile latency of a single call.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <assert.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <CscNetLib/std.h>
+#include <CscNetLib/alloc.h>
+#include <CscNetLib/isvalid.h>
+#include <CscNetLib/logger.h>
+
+
+typedef enum
+{   backend_Text = 0,   // Traditional "level[time]" entries.
+    backend_Json,      // JSON lines.
+    backend_Recorder,  // Traditional, with the flight recorder on.
+    backend_N
+} backend_t;
+
+static const char *backendNames[backend_N] = { "text", "json", "recorder" };
+
+
+typedef struct
+{   csc_log_t *log;
+    csc_bool_t isPrintf;
+    csc_log_level_t level;
+    int nCalls;
+    double *lat;   // Latency of each call in nanoseconds.
+} worker_t;
+
+
+typedef struct
+{   double elapsed;   // Seconds.
+    double p99;       // Nanoseconds.
+    long nCalls;
+} result_t;
+
+
+static double nowNs(void)
+{   struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec*1e9 + ts.tv_nsec;
+}
+
+
+static int cmpDouble(const void *a, const void *b)
+{   double x = *(const double*)a;
+    double y = *(const double*)b;
+    return (x>y) - (x<y);
+}
+
+
+static double percentile99(double *lat, int n)
+{   if (n == 0)
+        return 0;
+    qsort(lat, n, sizeof(double), cmpDouble);
+    return lat[(int)(n*0.99)];
+}
+
+
+static void *workerRun(void *context)
+{   worker_t *w = context;
+    double t0;
+    for (int i=0; i<w->nCalls; i++)
+    {   t0 = nowNs();
+        if (w->isPrintf)
+            csc_log_printf(w->log, w->level, "request %d from %s took %dms", i, "10.0.0.1", 42);
+        else
+            csc_log_str(w->log, w->level, "Accepted connection from 10.0.0.1");
+        w->lat[i] = nowNs() - t0;
+    }
+    return NULL;
+}
+
+
+static csc_log_t *logOpen(const char *path, backend_t backend)
+{   csc_log_t *log;
+    unlink(path);
+    log = csc_log_new(path, csc_log_NOTICE);
+    assert(log != NULL);
+    if (backend == backend_Json)
+        csc_log_setJsonLines(log, csc_TRUE);
+    else if (backend == backend_Recorder)
+        csc_log_setRecorder(log, 256);
+    return log;
+}
+
+
+static result_t runThreads( const char *path, backend_t backend, csc_bool_t isPrintf
+                          , csc_log_level_t level, int nThreads, int nCalls)
+{   csc_log_t *log = logOpen(path, backend);
+    pthread_t *threads = csc_allocMany(pthread_t, nThreads);
+    worker_t *workers = csc_allocMany(worker_t, nThreads);
+    double *lat = csc_allocMany(double, nThreads*nCalls);
+    result_t res;
+    double t0;
+
+    for (int i=0; i<nThreads; i++)
+    {   workers[i].log = log;
+        workers[i].isPrintf = isPrintf;
+        workers[i].level = level;
+        workers[i].nCalls = nCalls;
+        workers[i].lat = lat + i*nCalls;
+    }
+    t0 = nowNs();
+    for (int i=0; i<nThreads; i++)
+        pthread_create(&threads[i], NULL, workerRun, &workers[i]);
+    for (int i=0; i<nThreads; i++)
+        pthread_join(threads[i], NULL);
+    res.elapsed = (nowNs() - t0) / 1e9;
+    res.nCalls = (long)nThreads * nCalls;
+    res.p99 = percentile99(lat, nThreads*nCalls);
+
+    free(lat);
+    free(workers);
+    free(threads);
+    csc_log_free(log);
+    return res;
+}
+
+
+static result_t runProcs( const char *path, backend_t backend, csc_bool_t isPrintf
+                        , csc_log_level_t level, int nProcs, int nCalls)
+{   csc_log_t *log = logOpen(path, backend);
+    int fds[2];
+    result_t res;
+    double t0, p99;
+
+// Each child sends back the 99th percentile of its own calls.
+    if (pipe(fds) != 0)
+    {   perror("pipe");
+        exit(1);
+    }
+    t0 = nowNs();
+    for (int i=0; i<nProcs; i++)
+    {   if (fork() == 0)
+        {   worker_t w;
+            w.log = log;
+            w.isPrintf = isPrintf;
+            w.level = level;
+            w.nCalls = nCalls;
+            w.lat = csc_allocMany(double, nCalls);
+            workerRun(&w);
+            p99 = percentile99(w.lat, nCalls);
+            if (write(fds[1], &p99, sizeof(p99)) != sizeof(p99))
+                _exit(1);
+            _exit(0);
+        }
+    }
+    for (int i=0; i<nProcs; i++)
+        wait(NULL);
+    res.elapsed = (nowNs() - t0) / 1e9;
+    res.nCalls = (long)nProcs * nCalls;
+
+// Report the worst of the child percentiles.
+    res.p99 = 0;
+    for (int i=0; i<nProcs; i++)
+    {   if (read(fds[0], &p99, sizeof(p99)) == sizeof(p99) && p99 > res.p99)
+            res.p99 = p99;
+    }
+    close(fds[0]);
+    close(fds[1]);
+
+    csc_log_free(log);
+    return res;
+}
+
+
+static void report( backend_t backend, csc_bool_t isPrintf, csc_bool_t isFiltered
+                  , const char *workers, int nWorkers, result_t res)
+{   fprintf( stdout, "%-9s %-6s %-10s %3d %-7s %14.0f %12.0f\n"
+           , backendNames[backend]
+           , isPrintf ? "printf" : "str"
+           , isFiltered ? "filtered" : "unfiltered"
+           , nWorkers, workers
+           , res.nCalls / res.elapsed
+           , res.p99
+           );
+    fflush(stdout);
+}
+
+
+static void usage(char *progname)
+{   fprintf( stderr
+           , "Usage %s logPath maxThreads nProcs nCalls\n\n"
+             "   where logPath is the path of a scratch log file\n"
+             "     maxThreads is the largest number of threads to try\n"
+             "     nProcs is the number of processes to fork\n"
+             "     nCalls is the number of calls made by each thread or process\n\n"
+           , progname
+           );
+    exit(1);
+}
+
+
+int main(int argc, char **argv)
+{   int maxThreads, nProcs, nCalls;
+    csc_log_level_t level;
+    result_t res;
+
+// Check the command line arguments.
+    if (argc != 5)
+        usage(argv[0]);
+    if (  !csc_isValidRange_int(argv[2], 1, 1024, &maxThreads)
+       || !csc_isValidRange_int(argv[3], 1, 1024, &nProcs)
+       || !csc_isValidRange_int(argv[4], 1, 100000000, &nCalls)
+       )
+        usage(argv[0]);
+
+    fprintf( stdout, "%-9s %-6s %-10s %3s %-7s %14s %12s\n"
+           , "backend", "call", "level", "n", "workers", "lines/sec", "p99 ns");
+
+    for (backend_t backend=0; backend<backend_N; backend++)
+    {   for (int isFiltered=0; isFiltered<=1; isFiltered++)
+        {   level = isFiltered ? csc_log_TRACE : csc_log_NOTICE;
+            for (int isPrintf=0; isPrintf<=1; isPrintf++)
+            {   for (int n=1; n<=maxThreads; n*=2)
+                {   res = runThreads(argv[1], backend, isPrintf, level, n, nCalls);
+                    report(backend, isPrintf, isFiltered, "threads", n, res);
+                }
+                res = runProcs(argv[1], backend, isPrintf, level, nProcs, nCalls);
+                report(backend, isPrintf, isFiltered, "procs", nProcs, res);
+            }
+        }
+    }
+
+    unlink(argv[1]);
+    exit(0);
+}
@@ -0,0 +1,261 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+#include <CscNetLib/std.h>
+#include <CscNetLib/alloc.h>
+#include <CscNetLib/hash.h>
+
+FILE *fout;
+
+void printPassFail(const char *testName, csc_bool_t isPass)
+{	if (isPass)
+		fprintf(fout, "pass (%s)\n", testName);
+	else
+		fprintf(fout, "FAIL (%s)\n", testName);
+}
+
+#define NRecs 5000
+
+// The records are strings "key<n>", which are also their keys.
+char *keyStr(char *buf, int n)
+{	sprintf(buf, "key%d", n);
+	return buf;
+}
+
+int keyNum(const char *rec)
+{	return atoi(rec+3);
+}
+
+csc_hash_t *newTable()
+{	return csc_hash_new(0, (int (*)(void*,void*))strcmp, csc_hash_str, csc_hash_FreeBlk);
+}
+
+csc_bool_t addRec(csc_hash_t *h, int n)
+{	char buf[20];
+	char *rec = csc_alloc_str(keyStr(buf, n));
+	if (csc_hash_addex(h, rec))
+		return csc_TRUE;
+	free(rec);
+	return csc_FALSE;
+}
+
+csc_bool_t isRehashing(csc_hash_t *h)
+{	csc_hash_stats_t st;
+	csc_hash_getStats(h, &st);
+	return st.isRehashing;
+}
+
+// Are the records from 0 to NRecs-1 that are in 'h' exactly those for
+// which 'isIn[n]' is set?
+csc_bool_t isRecs(csc_hash_t *h, const char *isIn)
+{	char buf[20];
+	csc_bool_t isFound;
+	int n;
+	for (n=0; n<NRecs; n++)
+	{	isFound = csc_hash_get(h, keyStr(buf,n)) != NULL;
+		if (isFound != (isIn[n]!=0))
+			return csc_FALSE;
+	}
+	return csc_TRUE;
+}
+
+// Does iterating over 'h' visit each record in it exactly once?
+csc_bool_t isIterOk(csc_hash_t *h, const char *isIn)
+{	char seen[NRecs];
+	csc_hash_iter_t iter;
+	char *rec;
+	int n;
+	memset(seen, 0, NRecs);
+	for_hash_all(h, iter, rec, char*)
+	{	n = keyNum(rec);
+		if (!isIn[n] || seen[n])
+			return csc_FALSE;
+		seen[n] = 1;
+	}
+	return memcmp(seen, isIn, NRecs) == 0;
+}
+
+
+// Do keys of 'len' bytes that begin with 'prefix' and differ after it
+// hash differently, and each hash differently under each seed?
+csc_bool_t isPrefixSpread(const char *prefix, int len)
+{	static const unsigned long seeds[] = {0, 12345, 0xdeadbeef};
+	unsigned long hv[3][4];
+	char key[32];
+	int iSeed, iKey, j, k;
+	for (iSeed=0; iSeed<3; iSeed++)
+	{	for (iKey=0; iKey<4; iKey++)
+		{	memcpy(key, prefix, 8);
+			memset(key+8, 'a'+iKey, len-8);
+			hv[iSeed][iKey] = csc_hash_bytesSeed(key, len, seeds[iSeed]);
+		}
+	}
+	for (j=0; j<12; j++)
+	{	for (k=j+1; k<12; k++)
+		{	if (hv[j/4][j%4] == hv[k/4][k%4])
+				return csc_FALSE;
+		}
+	}
+	return csc_TRUE;
+}
+
+
+int main(int argc, char **argv)
+{	csc_hash_t *h;
+	csc_hash_stats_t st;
+	csc_hash_iter_t iter;
+	char isIn[NRecs];
+	char buf[20];
+	char *rec;
+	csc_bool_t isOk, isSeenRehash;
+	unsigned long tblsize, nResizes;
+	int n, nAdded, nVisited;
+	fout = fopen("csc_testOut.txt", "a"); assert(fout);
+
+// Keys beginning with the bytes of a constant used by the hash function
+// must still depend on the seed and on the rest of the key.
+	printPassFail("seedPrefix13", isPrefixSpread("\xdb\x28\xb4\xa0\xd1\x7e\x03\xe7", 13));
+	printPassFail("seedPrefix16", isPrefixSpread("\xdb\x28\xb4\xa0\xd1\x7e\x03\xe7", 16));
+	printPassFail("seedPrefix17", isPrefixSpread("\xdb\x28\xb4\xa0\xd1\x7e\x03\xe7", 17));
+	printPassFail("seedPrefix24", isPrefixSpread("\xdb\x28\xb4\xa0\xd1\x7e\x03\xe7", 24));
+	printPassFail("seedZeros", isPrefixSpread("\0\0\0\0\0\0\0\0", 17));
+
+// Add records one at a time, looking them up as the table grows.
+	h = newTable();
+	memset(isIn, 0, NRecs);
+	isOk = csc_TRUE;
+	isSeenRehash = csc_FALSE;
+	for (n=0; n<NRecs; n++)
+	{	isOk = isOk && addRec(h, n);
+		isIn[n] = 1;
+		if (isRehashing(h))
+		{	isSeenRehash = csc_TRUE;
+			isOk = isOk && isRecs(h, isIn) && isIterOk(h, isIn);
+		}
+	}
+	printPassFail("addDuringRehash", isOk && isSeenRehash);
+	printPassFail("addAll", isRecs(h, isIn) && isIterOk(h, isIn));
+	isOk = !addRec(h, 7);
+	printPassFail("addexDuplicate", isOk);
+	csc_hash_free(h);
+	printPassFail("addFree", csc_mck_nchunks()==0);
+
+// Stop part way through a rehash, and remove records as they are visited.
+	h = newTable();
+	memset(isIn, 0, NRecs);
+	for (n=0; n<NRecs && !isRehashing(h); n++)
+	{	addRec(h, n);
+		isIn[n] = 1;
+	}
+	printPassFail("rehashStarted", isRehashing(h));
+	nAdded = n;
+	nVisited = 0;
+	for_hash_all(h, iter, rec, char*)
+	{	nVisited++;
+		n = keyNum(rec);
+		if (n%2 == 0)
+		{	csc_hash_del(h, rec);
+			isIn[n] = 0;
+		}
+	}
+	csc_hash_getStats(h, &st);
+	printPassFail("delWhileIterating", nVisited==nAdded && st.count==nAdded/2 && isRecs(h, isIn));
+	printPassFail("iterAfterDel", isIterOk(h, isIn));
+
+// Carry on adding while the rehash finishes.
+	for (n=nAdded; n<NRecs; n++)
+	{	addRec(h, n);
+		isIn[n] = 1;
+	}
+	printPassFail("addAfterDel", isRecs(h, isIn) && isIterOk(h, isIn) && !isRehashing(h));
+
+// Remove almost everything, so that the table shrinks.
+	csc_hash_getStats(h, &st);
+	tblsize = st.tblsize;
+	nResizes = st.nResizes;
+	isOk = csc_TRUE;
+	isSeenRehash = csc_FALSE;
+	for (n=0; n<NRecs-10; n++)
+	{	if (isIn[n])
+		{	isOk = isOk && csc_hash_del(h, keyStr(buf,n));
+			isIn[n] = 0;
+		}
+		if (isRehashing(h))
+		{	isSeenRehash = csc_TRUE;
+			if (n%16 == 0)
+				isOk = isOk && isRecs(h, isIn) && isIterOk(h, isIn);
+		}
+	}
+	csc_hash_getStats(h, &st);
+	printPassFail("delDuringShrink", isOk && isSeenRehash);
+	printPassFail("shrunk", st.tblsize<tblsize && st.nResizes>nResizes && st.count==10);
+	printPassFail("shrunkRecs", isRecs(h, isIn) && isIterOk(h, isIn));
+	isOk = !csc_hash_del(h, keyStr(buf,0)) && csc_hash_out(h, keyStr(buf,0))==NULL;
+	printPassFail("delMissing", isOk);
+	csc_hash_free(h);
+	printPassFail("shrinkFree", csc_mck_nchunks()==0);
+
+// Leave an iteration early, part way through a rehash.  Removals do not
+// carry on the rehash until csc_hash_iterStop() is called.
+	h = newTable();
+	memset(isIn, 0, NRecs);
+	for (n=0; n<NRecs && !isRehashing(h); n++)
+	{	addRec(h, n);
+		isIn[n] = 1;
+	}
+	nAdded = n;
+	for_hash_all(h, iter, rec, char*)
+		break;
+	for (n=0; n<20; n++)
+	{	csc_hash_del(h, keyStr(buf,n));
+		isIn[n] = 0;
+	}
+	printPassFail("breakPauses", isRehashing(h));
+	csc_hash_iterStop(h);
+	for (; n<60; n++)
+	{	csc_hash_del(h, keyStr(buf,n));
+		isIn[n] = 0;
+	}
+	printPassFail("iterStopResumes", !isRehashing(h) && isRecs(h, isIn) && isIterOk(h, isIn));
+	csc_hash_free(h);
+
+// Reserving room gives the load that growing would, and no growth.
+	h = newTable();
+	csc_hash_reserve(h, 1000);
+	csc_hash_getStats(h, &st);
+	nResizes = st.nResizes;
+	for (n=0; n<1000; n++)
+		addRec(h, n);
+	csc_hash_getStats(h, &st);
+	printPassFail("reserveLoad", st.nResizes==nResizes && st.loadFactor<=0.5);
+	csc_hash_free(h);
+
+// Reserve room, grow well beyond it, and then remove almost everything.
+// The table may shrink, but not below the size reserved.
+	h = newTable();
+	csc_hash_reserve(h, 200);
+	csc_hash_getStats(h, &st);
+	tblsize = st.tblsize;
+	memset(isIn, 0, NRecs);
+	for (n=0; n<NRecs; n++)
+	{	addRec(h, n);
+		isIn[n] = 1;
+	}
+	csc_hash_getStats(h, &st);
+	isOk = st.tblsize > tblsize;
+	for (n=0; n<NRecs-10; n++)
+	{	csc_hash_del(h, keyStr(buf,n));
+		isIn[n] = 0;
+		csc_hash_getStats(h, &st);
+		isOk = isOk && st.tblsize>=tblsize;
+	}
+	printPassFail("reserveNoShrinkBelow", isOk && st.nResizes>=2);
+	printPassFail("reserveRecs", isRecs(h, isIn) && isIterOk(h, isIn));
+	csc_hash_free(h);
+	printPassFail("reserveFree", csc_mck_nchunks()==0);
+
+	fclose(fout);
+	exit(0);
+}
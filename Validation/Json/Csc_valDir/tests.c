@@ -0,0 +1,673 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <unistd.h>
+
+#include <CscNetLib/std.h>
+#include <CscNetLib/alloc.h>
+#include <CscNetLib/cstr.h>
+#include <CscNetLib/json.h>
+
+FILE *fout;
+
+void printPassFail(const char *testName, csc_bool_t isPass)
+{	if (isPass)
+		fprintf(fout, "pass (%s)\n", testName);
+	else
+		fprintf(fout, "FAIL (%s)\n", testName);
+}
+
+
+// Documents, and what each is written back as.
+typedef struct
+{	const char *in;
+	const char *out;
+} doc_t;
+
+static const doc_t docs[] =
+{	{"{}", "{}"}
+,	{" \t\r\n{ } \n", "{}"}
+,	{"{\"a\":1}", "{\"a\":1}"}
+,	{"{ \"a\" : 1 , \"b\" : -2 }", "{\"a\":1,\"b\":-2}"}
+,	{"{a:1,bc_d:true}", "{\"a\":1,\"bc_d\":true}"}
+,	{"{\"n\":null,\"t\":true,\"f\":false}", "{\"n\":null,\"t\":true,\"f\":false}"}
+,	{"{\"i\":9223372036854775807,\"j\":-9223372036854775808}"
+	, "{\"i\":9223372036854775807,\"j\":-9223372036854775808}"}
+,	{"{\"f\":2.5,\"g\":-0.125,\"h\":1e3,\"k\":2.5E-1}"
+	, "{\"f\":2.5,\"g\":-0.125,\"h\":1000,\"k\":0.25}"}
+,	{"{\"big\":1e400}", "{\"big\":null}"}
+,	{"{\"s\":\"\",\"t\":\"short\",\"u\":\"exactly 14 byte\",\"v\":\"a string of more than fourteen bytes\"}"
+	, "{\"s\":\"\",\"t\":\"short\",\"u\":\"exactly 14 byte\",\"v\":\"a string of more than fourteen bytes\"}"}
+,	{"{\"e\":\"q\\\"b\\\\s\\/n\\nt\\tr\\r\"}", "{\"e\":\"q\\\"b\\\\s\\/n\\nt\\tr\\r\"}"}
+,	{"{\"u\":\"\\u0041\\u00e9\\u20ac\"}", "{\"u\":\"A\xc3\xa9\xe2\x82\xac\"}"}
+,	{"{\"utf8\":\"x\xc3\xa9y\"}", "{\"utf8\":\"x\xc3\xa9y\"}"}
+,	{"{\"\\u0041b\":1}", "{\"Ab\":1}"}
+,	{"{\"a\":[],\"o\":{}}", "{\"a\":[],\"o\":{}}"}
+,	{"{\"a\":[1,[2,[3,[4,[]]]],{\"b\":[{\"c\":{}}]}]}"
+	, "{\"a\":[1,[2,[3,[4,[]]]],{\"b\":[{\"c\":{}}]}]}"}
+,	{"{\"a\":[ \"x\" , 1 , 2.5 , true , null , { } , [ ] ]}"
+	, "{\"a\":[\"x\",1,2.5,true,null,{},[]]}"}
+,	{"{\n  \"first\": {\n    \"second\": [\n      \"third\"\n    ]\n  }\n}\n"
+	, "{\"first\":{\"second\":[\"third\"]}}"}
+};
+#define NDocs (sizeof(docs)/sizeof(docs[0]))
+
+
+// Documents in error, and the error each gives.  Each has more after the
+// error, so that a push parser can tell that it is an error rather than
+// waiting for more bytes.
+typedef struct
+{	const char *in;
+	const char *err;
+} badDoc_t;
+
+static const badDoc_t badDocs[] =
+{	{" x{}", "Expected Opening Brace.  Got char # 120 at 2 line 1"}
+,	{"{\"a\" 1}", "Expected Colon at 6 line 1"}
+,	{"{\"a\":1,,}", "Expected ending brace or new identifier at 8 line 1"}
+,	{"{\"a\":[1 2]}", "Expected comma or ending brace at 9 line 1"}
+,	{"{\"a\":1 \"b\":2}", "Expected comma or ending brace at 8 line 1"}
+,	{"{\"a\":tru}", "Expected Element at 9 line 1"}
+,	{"{\"a\":}", "Expected Element at 6 line 1"}
+,	{"{\"a\":\"\\u12\"}", "Expected Element at 11 line 1"}
+,	{"{\"a\":1,\n \"b\":[tru]}", "Expected Element at 18 line 2"}
+,	{"{\n\"a\":1,\n\n\"b\":{\"c\" 2}}", "Expected Colon at 20 line 4"}
+};
+#define NBadDocs (sizeof(badDocs)/sizeof(badDocs[0]))
+
+
+// Sets 'res' to what the object 'js' was read as.
+static void describeObj(csc_json_t *js, csc_str_t *res)
+{	char buf[40];
+	csc_str_assign(res, "");
+	if (js == NULL)
+		csc_str_assign(res, "EOF");
+	else if (csc_json_getErrStr(js) != NULL)
+	{	csc_str_append(res, csc_json_getErrStr(js));
+		sprintf(buf, " at %d line %d", csc_json_getErrPos(js), csc_json_getErrLinePos(js));
+		csc_str_append(res, buf);
+	}
+	else
+		csc_json_writeCstr(js, res);
+	if (js != NULL)
+		csc_json_free(js);
+}
+
+
+// Each way of reading a document sets 'res' to what it was read as.
+
+static void parseStr(const char *in, csc_str_t *res)
+{	describeObj(csc_json_newParseStr(in), res);
+}
+
+static void parseInSitu(const char *in, csc_str_t *res)
+{	size_t len = strlen(in);
+	char *buf = csc_allocMany(char, len+1);
+	memcpy(buf, in, len+1);
+	describeObj(csc_json_newParseInSitu(buf, len), res);
+	free(buf);
+}
+
+// A stream from a file, or from a pipe, which is read differently.
+static FILE *openStream(const char *in, csc_bool_t isPipe)
+{	FILE *fp;
+	int fds[2];
+	if (isPipe)
+	{	assert(pipe(fds) == 0);
+		assert(write(fds[1], in, strlen(in)) == strlen(in));
+		close(fds[1]);
+		fp = fdopen(fds[0], "r"); assert(fp);
+	}
+	else
+	{	fp = tmpfile(); assert(fp);
+		fputs(in, fp);
+		rewind(fp);
+	}
+	return fp;
+}
+
+static void parseFILE(const char *in, csc_bool_t isPipe, csc_str_t *res)
+{	FILE *fp = openStream(in, isPipe);
+	describeObj(csc_json_newParseFILE(fp), res);
+	fclose(fp);
+}
+
+
+// A SAX reader builds a csc_json_t from what it is given, so that it can
+// be written just as the other parsers' objects are.
+#define MaxNest 100
+
+typedef struct
+{	csc_json_t *root;
+	csc_json_t *objs[MaxNest];     // The object at each depth, or NULL.
+	csc_jsonArr_t *arrs[MaxNest];  // The array at each depth, or NULL.
+	int nNest;
+	char *key;
+	csc_str_t *err;
+} saxCtx_t;
+
+static char *strnCopy(const char *str, int len)
+{	char *copy = csc_allocMany(char, len+1);
+	memcpy(copy, str, len);
+	copy[len] = '\0';
+	return copy;
+}
+
+static void saxPush(saxCtx_t *ctx, csc_json_t *obj, csc_jsonArr_t *arr)
+{	assert(ctx->nNest < MaxNest);
+	ctx->objs[ctx->nNest] = obj;
+	ctx->arrs[ctx->nNest] = arr;
+	ctx->nNest++;
+}
+
+// The object or array that a value goes in.
+#define saxObj(ctx) ((ctx)->objs[(ctx)->nNest-1])
+#define saxArr(ctx) ((ctx)->arrs[(ctx)->nNest-1])
+
+static void saxBeginObj(void *context)
+{	saxCtx_t *ctx = context;
+	if (ctx->nNest == 0)
+	{	ctx->root = csc_json_new();
+		saxPush(ctx, ctx->root, NULL);
+	}
+	else if (saxObj(ctx) != NULL)
+		saxPush(ctx, csc_json_addNewObj(saxObj(ctx), ctx->key), NULL);
+	else
+		saxPush(ctx, csc_jsonArr_apndNewObj(saxArr(ctx)), NULL);
+}
+static void saxBeginArr(void *context)
+{	saxCtx_t *ctx = context;
+	if (saxObj(ctx) != NULL)
+		saxPush(ctx, NULL, csc_json_addNewArr(saxObj(ctx), ctx->key));
+	else
+		saxPush(ctx, NULL, csc_jsonArr_apndNewArr(saxArr(ctx)));
+}
+static void saxEnd(void *context)
+{	((saxCtx_t*)context)->nNest--;
+}
+static void saxKey(void *context, const char *name, int len)
+{	saxCtx_t *ctx = context;
+	if (ctx->key != NULL)
+		free(ctx->key);
+	ctx->key = strnCopy(name, len);
+}
+static void saxNull(void *context)
+{	saxCtx_t *ctx = context;
+	if (saxObj(ctx) != NULL)
+		csc_json_addNull(saxObj(ctx), ctx->key);
+	else
+		csc_jsonArr_apndNull(saxArr(ctx));
+}
+static void saxBool(void *context, csc_bool_t val)
+{	saxCtx_t *ctx = context;
+	if (saxObj(ctx) != NULL)
+		csc_json_addBool(saxObj(ctx), ctx->key, val);
+	else
+		csc_jsonArr_apndBool(saxArr(ctx), val);
+}
+static void saxInt(void *context, int64_t val)
+{	saxCtx_t *ctx = context;
+	if (saxObj(ctx) != NULL)
+		csc_json_addInt64(saxObj(ctx), ctx->key, val);
+	else
+		csc_jsonArr_apndInt64(saxArr(ctx), val);
+}
+static void saxFloat(void *context, double val)
+{	saxCtx_t *ctx = context;
+	if (saxObj(ctx) != NULL)
+		csc_json_addFloat(saxObj(ctx), ctx->key, val);
+	else
+		csc_jsonArr_apndFloat(saxArr(ctx), val);
+}
+static void saxStr(void *context, const char *val, int len)
+{	saxCtx_t *ctx = context;
+	char *copy = strnCopy(val, len);
+	if (saxObj(ctx) != NULL)
+		csc_json_addStr(saxObj(ctx), ctx->key, copy);
+	else
+		csc_jsonArr_apndStr(saxArr(ctx), copy);
+	free(copy);
+}
+static void saxError(void *context, const char *errMsg, int errPos, int errLinePos)
+{	char buf[40];
+	saxCtx_t *ctx = context;
+	csc_str_assign(ctx->err, errMsg);
+	sprintf(buf, " at %d line %d", errPos, errLinePos);
+	csc_str_append(ctx->err, buf);
+}
+
+static const csc_jsonSax_t sax =
+{	saxBeginObj, saxEnd, saxBeginArr, saxEnd, saxKey
+,	saxNull, saxBool, saxInt, saxFloat, saxStr, saxError
+};
+
+static void saxCtx_init(saxCtx_t *ctx)
+{	ctx->root = NULL;
+	ctx->nNest = 0;
+	ctx->key = NULL;
+	ctx->err = csc_str_new(NULL);
+}
+
+// Sets 'res' to what a SAX reader was given, and starts it afresh.
+static void describeSax(csc_jsonErr_t errNum, saxCtx_t *ctx, csc_str_t *res)
+{	if (csc_str_length(ctx->err) > 0)
+		csc_str_assign(res, csc_str_charr(ctx->err));
+	else if (errNum == csc_jsonErr_Missing)
+		csc_str_assign(res, "EOF");
+	else
+	{	describeObj(ctx->root, res);
+		ctx->root = NULL;
+	}
+	if (ctx->root != NULL)
+		csc_json_free(ctx->root);
+	ctx->root = NULL;
+	ctx->nNest = 0;
+	csc_str_assign(ctx->err, "");
+}
+
+static void saxCtx_free(saxCtx_t *ctx)
+{	if (ctx->root != NULL)
+		csc_json_free(ctx->root);
+	if (ctx->key != NULL)
+		free(ctx->key);
+	csc_str_free(ctx->err);
+}
+
+static void parseSaxStr(const char *in, csc_str_t *res)
+{	saxCtx_t ctx;
+	saxCtx_init(&ctx);
+	describeSax(csc_json_saxStr(in, &sax, &ctx), &ctx, res);
+	saxCtx_free(&ctx);
+}
+
+static void parseSaxFILE(const char *in, csc_bool_t isPipe, csc_str_t *res)
+{	saxCtx_t ctx;
+	FILE *fp = openStream(in, isPipe);
+	saxCtx_init(&ctx);
+	describeSax(csc_json_saxFILE(fp, &sax, &ctx), &ctx, res);
+	saxCtx_free(&ctx);
+	fclose(fp);
+}
+
+
+// Pushes the bytes of 'in' in pieces of 'split' bytes, or if 'split' is
+// negative, in two pieces split after '-split' bytes.  Sets 'res' to the
+// objects read, separated by spaces, followed by "EOF" if the last object
+// was not finished.  If 'isSax', the objects are read with a SAX reader.
+static void parsePush(const char *in, int split, csc_bool_t isSax, csc_str_t *res)
+{	csc_jsonPush_t *jp;
+	csc_jsonErr_t errNum;
+	csc_str_t *one = csc_str_new(NULL);
+	saxCtx_t ctx;
+	int len = strlen(in);
+	int pos = 0;
+	int nPieces = 0;
+	int n;
+
+	saxCtx_init(&ctx);
+	jp = csc_jsonPush_new(isSax ? &sax : NULL, &ctx);
+	csc_str_assign(res, "");
+	do
+	{	if (split > 0)
+			n = split;
+		else
+			n = nPieces==0 ? -split : len-pos;
+		nPieces++;
+		if (n > len-pos)
+			n = len - pos;
+		errNum = csc_jsonPush_feed(jp, in+pos, n);
+		pos += n;
+
+	// Take every object read, including any read from bytes left over.
+		while (errNum != csc_jsonErr_Missing)
+		{	if (isSax)
+				describeSax(errNum, &ctx, one);
+			else
+				describeObj(csc_jsonPush_takeObj(jp), one);
+			if (csc_str_length(res) > 0)
+				csc_str_append_ch(res, ' ');
+			csc_str_append(res, csc_str_charr(one));
+			if (errNum == csc_jsonErr_BadParse)
+				break;
+			errNum = csc_jsonPush_feed(jp, "", 0);
+		}
+	} while (pos<len && errNum!=csc_jsonErr_BadParse);
+	if (errNum == csc_jsonErr_Missing)
+	{	if (csc_str_length(res) > 0)
+			csc_str_append_ch(res, ' ');
+		csc_str_append(res, "EOF");
+	}
+
+	csc_jsonPush_free(jp);
+	saxCtx_free(&ctx);
+	csc_str_free(one);
+}
+
+
+// Reads objects from a stream of 'in' until the end, setting 'res' to
+// them, separated by spaces and followed by "EOF".
+static void readStream(const char *in, csc_bool_t isPipe, csc_bool_t isSax, csc_str_t *res)
+{	FILE *fp = openStream(in, isPipe);
+	csc_str_t *one = csc_str_new(NULL);
+	saxCtx_t ctx;
+	saxCtx_init(&ctx);
+	csc_str_assign(res, "");
+	do
+	{	if (isSax)
+			describeSax(csc_json_saxFILE(fp, &sax, &ctx), &ctx, one);
+		else
+			describeObj(csc_json_newParseFILE(fp), one);
+		if (csc_str_length(res) > 0)
+			csc_str_append_ch(res, ' ');
+		csc_str_append(res, csc_str_charr(one));
+	} while (!csc_streq(csc_str_charr(one), "EOF"));
+	saxCtx_free(&ctx);
+	csc_str_free(one);
+	fclose(fp);
+}
+
+
+// Returns whether a push parser read 'expect' first, followed by nothing
+// or by what it read from the bytes left over.
+static csc_bool_t isPushFirst(csc_str_t *res, csc_str_t *expect)
+{	int len = csc_str_length(expect);
+	const char *chars = csc_str_charr(res);
+	return strncmp(chars, csc_str_charr(expect), len) == 0
+	    && (chars[len]=='\0' || chars[len]==' ');
+}
+
+
+// Checks that every way of reading 'in' gives 'expect'.  A push parser
+// cannot tell the end of its input, so a document that only has an error
+// at its end is still waiting for more when its bytes run out.
+static csc_bool_t isAllAgree(const char *in, const char *expect)
+{	csc_str_t *res = csc_str_new(NULL);
+	csc_str_t *pushExpect = csc_str_new(NULL);
+	csc_bool_t isOk = csc_TRUE;
+	int len = strlen(in);
+	int split;
+	char buf[40];
+
+// Work out what a push parser should make of it.
+	sprintf(buf, " at %d line ", len+1);
+	if (strstr(expect, buf) != NULL)
+		csc_str_assign(pushExpect, "EOF");
+	else
+		csc_str_assign(pushExpect, expect);
+
+	parseStr(in, res);
+	isOk = isOk && csc_streq(csc_str_charr(res), expect);
+	parseInSitu(in, res);
+	isOk = isOk && csc_streq(csc_str_charr(res), expect);
+	parseFILE(in, csc_FALSE, res);
+	isOk = isOk && csc_streq(csc_str_charr(res), expect);
+	parseFILE(in, csc_TRUE, res);
+	isOk = isOk && csc_streq(csc_str_charr(res), expect);
+	parseSaxStr(in, res);
+	isOk = isOk && csc_streq(csc_str_charr(res), expect);
+	parseSaxFILE(in, csc_FALSE, res);
+	isOk = isOk && csc_streq(csc_str_charr(res), expect);
+	parseSaxFILE(in, csc_TRUE, res);
+	isOk = isOk && csc_streq(csc_str_charr(res), expect);
+	for (split=0; split<=len && isOk; split++)
+	{	parsePush(in, -split, csc_FALSE, res);
+		isOk = isOk && isPushFirst(res, pushExpect);
+		parsePush(in, -split, csc_TRUE, res);
+		isOk = isOk && isPushFirst(res, pushExpect);
+	}
+	parsePush(in, 1, csc_FALSE, res);
+	isOk = isOk && isPushFirst(res, pushExpect);
+	parsePush(in, 1, csc_TRUE, res);
+	isOk = isOk && isPushFirst(res, pushExpect);
+
+	csc_str_free(res);
+	csc_str_free(pushExpect);
+	return isOk;
+}
+
+
+// A random number generator that gives the same documents everywhere.
+static unsigned long randState = 12345;
+static int randN(int n)
+{	randState = randState * 6364136223846793005UL + 1442695040888963407UL;
+	return (int)((randState >> 33) % n);
+}
+
+
+// Append random space, strings, values and objects to 'cstr'.  Values are
+// nested no more than 'depth' deep.
+static void randSpace(csc_str_t *cstr)
+{	static const char *spaces[] = {"", "", "", " ", "\n", "\t ", "\r\n  "};
+	csc_str_append(cstr, spaces[randN(7)]);
+}
+static void randStr(csc_str_t *cstr)
+{	static const char *bits[] =
+	{	"a", "b", "xyz", " ", "\\\"", "\\\\", "\\/", "\\n", "\\t", "\\u00e9"
+	,	"\\u20ac", "\\ud83d\\ude00", "\xc3\xa9", "long enough to be out of line"
+	};
+	int n = randN(6);
+	csc_str_append_ch(cstr, '\"');
+	while (n-- > 0)
+		csc_str_append(cstr, bits[randN(14)]);
+	csc_str_append_ch(cstr, '\"');
+}
+static void randObj(csc_str_t *cstr, int depth);
+static void randVal(csc_str_t *cstr, int depth)
+{	static const char *scalars[] =
+	{	"null", "true", "false", "0", "-1", "42", "123456789012", "-9223372036854775808"
+	,	"2.5", "-0.75", "1e10", "6.25E-2", "1e400", "18446744073709551616"
+	};
+	char buf[30];
+	int i, n;
+	randSpace(cstr);
+	switch (depth>0 ? randN(6) : 2+randN(4))
+	{	case 0:
+			randObj(cstr, depth-1);
+			break;
+		case 1:
+			n = randN(5);
+			csc_str_append_ch(cstr, '[');
+			for (i=0; i<n; i++)
+			{	if (i > 0)
+					csc_str_append_ch(cstr, ',');
+				randVal(cstr, depth-1);
+			}
+			randSpace(cstr);
+			csc_str_append_ch(cstr, ']');
+			break;
+		case 2:
+			randStr(cstr);
+			break;
+		case 3:
+			sprintf(buf, "%d", randN(2000000)-1000000);
+			csc_str_append(cstr, buf);
+			break;
+		default:
+			csc_str_append(cstr, scalars[randN(14)]);
+			break;
+	}
+	randSpace(cstr);
+}
+static void randObj(csc_str_t *cstr, int depth)
+{	int i;
+	int n = randN(6);
+	char buf[20];
+	csc_str_append_ch(cstr, '{');
+	for (i=0; i<n; i++)
+	{	if (i > 0)
+			csc_str_append_ch(cstr, ',');
+		randSpace(cstr);
+		if (randN(4) == 0)
+		{	sprintf(buf, "k%d", i);
+			csc_str_append(cstr, buf);
+		}
+		else
+			randStr(cstr);
+		randSpace(cstr);
+		csc_str_append_ch(cstr, ':');
+		randVal(cstr, depth);
+	}
+	randSpace(cstr);
+	csc_str_append_ch(cstr, '}');
+}
+
+
+// Changes one byte of 'cstr', or cuts it short.
+static void corrupt(csc_str_t *cstr)
+{	static const char *bytes = "{}[]:,\"\\ a1-.eu";
+	int len = csc_str_length(cstr);
+	int pos = randN(len);
+	char *chars = csc_str_alloc_charr(cstr);
+	if (randN(4) == 0)
+		chars[pos] = '\0';
+	else
+		chars[pos] = bytes[randN(strlen(bytes))];
+	csc_str_assign(cstr, chars);
+	free(chars);
+}
+
+#define NRandDocs 200
+
+
+int main(int argc, char **argv)
+{
+	csc_str_t *res = csc_str_new(NULL);
+	csc_str_t *doc = csc_str_new(NULL);
+	csc_str_t *expect = csc_str_new(NULL);
+	csc_bool_t isOk;
+	int i;
+	fout = fopen("csc_testOut.txt", "a"); assert(fout);
+
+// Each document is read the same way by every parser, and the push
+// parsers read it the same way however its bytes are split.
+	isOk = csc_TRUE;
+	for (i=0; i<NDocs; i++)
+		isOk = isOk && isAllAgree(docs[i].in, docs[i].out);
+	printPassFail("docsAllParsers", isOk);
+
+// What is written back reads the same again.
+	isOk = csc_TRUE;
+	for (i=0; i<NDocs; i++)
+	{	parseStr(docs[i].out, res);
+		isOk = isOk && csc_streq(csc_str_charr(res), docs[i].out);
+	}
+	printPassFail("docsRoundTrip", isOk);
+
+// Errors have the same message, position and line from every parser.
+	isOk = csc_TRUE;
+	for (i=0; i<NBadDocs; i++)
+		isOk = isOk && isAllAgree(badDocs[i].in, badDocs[i].err);
+	printPassFail("errsAllParsers", isOk);
+
+// A document cut short is an error at its end, but a push parser waits
+// for more.
+	isOk = isAllAgree("{\"a\":[1,2", "Expected comma or ending brace at 10 line 1");
+	isOk = isOk && isAllAgree("{\"a\":\"abc", "Expected Element at 10 line 1");
+	isOk = isOk && isAllAgree("{\"a\":1.5e", "Expected Element at 10 line 1");
+	isOk = isOk && isAllAgree("{\n", "Expected ending brace or new identifier at 3 line 2");
+	printPassFail("errsCutShort", isOk);
+
+// Nothing but space is the end of the input.
+	isOk = isAllAgree("", "EOF");
+	parsePush(" \n\t", 1, csc_FALSE, res);
+	isOk = isOk && csc_streq(csc_str_charr(res), "EOF");
+	parseStr(" \n\t", res);
+	isOk = isOk && csc_streq(csc_str_charr(res), "EOF");
+	printPassFail("eofAllParsers", isOk);
+
+// Bytes after an object are read as the next object, however the bytes
+// are split.
+	csc_str_assign(doc, "{\"a\":1} {\"b\":[2,\"long string of bytes\"]}\n{c:\"x\"}{}  ");
+	csc_str_assign(expect, "{\"a\":1} {\"b\":[2,\"long string of bytes\"]} {\"c\":\"x\"} {} EOF");
+	isOk = csc_TRUE;
+	for (i=0; i<=csc_str_length(doc); i++)
+	{	parsePush(csc_str_charr(doc), -i, csc_FALSE, res);
+		isOk = isOk && csc_streq(csc_str_charr(res), csc_str_charr(expect));
+		parsePush(csc_str_charr(doc), -i, csc_TRUE, res);
+		isOk = isOk && csc_streq(csc_str_charr(res), csc_str_charr(expect));
+	}
+	parsePush(csc_str_charr(doc), 1, csc_FALSE, res);
+	isOk = isOk && csc_streq(csc_str_charr(res), csc_str_charr(expect));
+	printPassFail("pushNextObj", isOk);
+
+// The same from a stream.
+	csc_str_assign(expect, "{\"a\":1} {\"b\":[2,\"long string of bytes\"]} {\"c\":\"x\"} {} EOF");
+	readStream(csc_str_charr(doc), csc_FALSE, csc_FALSE, res);
+	isOk = csc_streq(csc_str_charr(res), csc_str_charr(expect));
+	readStream(csc_str_charr(doc), csc_TRUE, csc_FALSE, res);
+	isOk = isOk && csc_streq(csc_str_charr(res), csc_str_charr(expect));
+	readStream(csc_str_charr(doc), csc_FALSE, csc_TRUE, res);
+	isOk = isOk && csc_streq(csc_str_charr(res), csc_str_charr(expect));
+	readStream(csc_str_charr(doc), csc_TRUE, csc_TRUE, res);
+	isOk = isOk && csc_streq(csc_str_charr(res), csc_str_charr(expect));
+	printPassFail("fileNextObj", isOk);
+
+// An error in the next object does not spoil the one before it, and its
+// position is counted from the start of all the bytes pushed.
+	parsePush("{\"a\":1} {\"b\" 2}", 1, csc_FALSE, res);
+	isOk = csc_streq(csc_str_charr(res), "{\"a\":1} Expected Colon at 14 line 1");
+	parsePush("{\"a\":1} {\"b\" 2}", -3, csc_TRUE, res);
+	isOk = isOk && csc_streq(csc_str_charr(res), "{\"a\":1} Expected Colon at 14 line 1");
+	printPassFail("pushNextObjErr", isOk);
+
+// Random documents are read the same by every parser, and read back the
+// same after being written.
+	isOk = csc_TRUE;
+	for (i=0; i<NRandDocs; i++)
+	{	csc_str_assign(doc, "");
+		randSpace(doc);
+		randObj(doc, 4);
+		randSpace(doc);
+		parseStr(csc_str_charr(doc), expect);
+		isOk = isOk && csc_str_charr(expect)[0]=='{';
+		isOk = isOk && isAllAgree(csc_str_charr(doc), csc_str_charr(expect));
+		parseStr(csc_str_charr(expect), res);
+		isOk = isOk && csc_streq(csc_str_charr(res), csc_str_charr(expect));
+	}
+	printPassFail("randDocs", isOk);
+
+// Random documents with a byte changed or cut short are read the same by
+// every parser, whether or not that makes an error.
+	isOk = csc_TRUE;
+	for (i=0; i<NRandDocs; i++)
+	{	csc_str_assign(doc, "");
+		randObj(doc, 3);
+		corrupt(doc);
+		parseStr(csc_str_charr(doc), expect);
+		isOk = isOk && isAllAgree(csc_str_charr(doc), csc_str_charr(expect));
+	}
+	printPassFail("corruptDocs", isOk);
+
+// Documents bigger than the chunks that a whole string is indexed in are
+// read the same from a string, in place and from a file, whole or with a
+// byte changed.  A pipe would fill before being read.
+	isOk = csc_TRUE;
+	for (i=0; i<20; i++)
+	{	csc_str_assign(doc, "{\"big\": [");
+		while (csc_str_length(doc) < 50000)
+		{	randObj(doc, 3);
+			csc_str_append(doc, ",\n");
+		}
+		csc_str_append(doc, "0]}");
+		if (i%2 == 1)
+			corrupt(doc);
+		parseStr(csc_str_charr(doc), expect);
+		isOk = isOk && (i%2==1 || csc_str_charr(expect)[0]=='{');
+		parseInSitu(csc_str_charr(doc), res);
+		isOk = isOk && csc_streq(csc_str_charr(res), csc_str_charr(expect));
+		parseFILE(csc_str_charr(doc), csc_FALSE, res);
+		isOk = isOk && csc_streq(csc_str_charr(res), csc_str_charr(expect));
+		parseSaxStr(csc_str_charr(doc), res);
+		isOk = isOk && csc_streq(csc_str_charr(res), csc_str_charr(expect));
+	}
+	printPassFail("bigDocs", isOk);
+
+	csc_str_free(res);
+	csc_str_free(doc);
+	csc_str_free(expect);
+	printPassFail("allFree", csc_mck_nchunks()==0);
+
+	fclose(fout);
+	exit(0);
+}
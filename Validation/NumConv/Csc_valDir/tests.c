@@ -0,0 +1,215 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <float.h>
+#include <math.h>
+#include <assert.h>
+
+#include <CscNetLib/std.h>
+#include <CscNetLib/alloc.h>
+#include <CscNetLib/cstr.h>
+#include <CscNetLib/numConv.h>
+#include <CscNetLib/json.h>
+
+FILE *fout;
+
+void printPassFail(const char *testName, csc_bool_t isPass)
+{	if (isPass)
+		fprintf(fout, "pass (%s)\n", testName);
+	else
+		fprintf(fout, "FAIL (%s)\n", testName);
+}
+
+
+// Is 'val' written as 'good', with the right length returned?
+csc_bool_t isIntStr(int64_t val, const char *good)
+{	char buf[csc_numConv_IntLen+1];
+	int len = csc_numConv_fmtInt(buf, val);
+	return len==strlen(good) && strcmp(buf, good)==0;
+}
+
+
+// Is 'val' written with digits that read back as exactly 'val', and no
+// more of them than printf() needs to do the same?
+csc_bool_t isFloatRoundTrip(double val)
+{	char buf[csc_numConv_FloatLen+1];
+	char good[40];
+	double back;
+	int len, prec;
+	len = csc_numConv_fmtFloat(buf, val);
+	if (len != strlen(buf))
+		return csc_FALSE;
+	back = strtod(buf, NULL);
+	if (memcmp(&back, &val, sizeof(double)) != 0)
+		return csc_FALSE;
+	for (prec=1; prec<=17; prec++)
+	{	sprintf(good, "%.*g", prec, val);
+		if (strtod(good, NULL) == val)
+			break;
+	}
+	return strtod(good, NULL)==val && strlen(buf)<=strlen(good);
+}
+
+
+// Does 'mant' times ten to the 'exp10' read as strtod() reads it?  A
+// csc_FALSE from csc_numConv_decToFloat() is allowed, as the caller then
+// falls back to strtod().
+csc_bool_t isDecOk(uint64_t mant, int exp10, csc_bool_t isNeg)
+{	char buf[60];
+	double val, good;
+	sprintf(buf, "%s%llue%d", isNeg?"-":"", (unsigned long long)mant, exp10);
+	good = strtod(buf, NULL);
+	if (!csc_numConv_decToFloat(mant, exp10, isNeg, &val))
+		return csc_TRUE;
+	return memcmp(&val, &good, sizeof(double)) == 0;
+}
+
+
+// Does reading the JSON number 'str' give the same as strtod()?
+csc_bool_t isJsonFloat(const char *str)
+{	char buf[100];
+	csc_json_t *js;
+	csc_jsonErr_t errNum;
+	double val, good;
+	sprintf(buf, "{\"n\":%s}", str);
+	js = csc_json_newParseStr(buf);
+	val = csc_json_getFloat(js, "n", &errNum);
+	csc_json_free(js);
+	good = strtod(str, NULL);
+	return errNum==csc_jsonErr_Ok && memcmp(&val, &good, sizeof(double))==0;
+}
+
+
+// Is the JSON object 'str' written out as 'good'?
+csc_bool_t isJsonWritten(const char *str, const char *good)
+{	csc_json_t *js = csc_json_newParseStr(str);
+	csc_str_t *out = csc_str_new(NULL);
+	csc_bool_t isOk;
+	csc_json_writeCstr(js, out);
+	isOk = csc_streq(csc_str_charr(out), good);
+	csc_str_free(out);
+	csc_json_free(js);
+	return isOk;
+}
+
+
+// A simple random number generator, so that every run is the same.
+uint64_t randState = 88172645463325252ULL;
+uint64_t rand64()
+{	randState ^= randState << 13;
+	randState ^= randState >> 7;
+	randState ^= randState << 17;
+	return randState;
+}
+
+
+int main(int argc, char **argv)
+{	char buf[csc_numConv_FloatLen+1];
+	csc_json_t *js;
+	csc_jsonWriter_t *jw;
+	csc_jsonErr_t errNum;
+	csc_bool_t isOk;
+	uint64_t bits;
+	double val;
+	int i;
+	fout = fopen("csc_testOut.txt", "a"); assert(fout);
+
+// csc_numConv_fmtInt().
+	printPassFail("intZero", isIntStr(0, "0"));
+	printPassFail("intMinusOne", isIntStr(-1, "-1"));
+	printPassFail("intTen", isIntStr(10, "10"));
+	printPassFail("intMax", isIntStr(INT64_MAX, "9223372036854775807"));
+	printPassFail("intMin", isIntStr(INT64_MIN, "-9223372036854775808"));
+	printPassFail("int2Pow53", isIntStr(9007199254740993LL, "9007199254740993"));
+	printPassFail("int1e18", isIntStr(1000000000000000000LL, "1000000000000000000"));
+	printPassFail("int1e18Less1", isIntStr(999999999999999999LL, "999999999999999999"));
+
+// csc_numConv_fmtFloat().
+	printPassFail("floatZero", csc_numConv_fmtFloat(buf,0.0)==1 && csc_streq(buf,"0"));
+	printPassFail("floatNegZero", csc_numConv_fmtFloat(buf,-0.0)==2 && csc_streq(buf,"-0"));
+	printPassFail("floatTenth", csc_numConv_fmtFloat(buf,0.1)==3 && csc_streq(buf,"0.1"));
+	printPassFail("floatWhole", csc_numConv_fmtFloat(buf,100.0)==3 && csc_streq(buf,"100"));
+	printPassFail("floatMinSub", isFloatRoundTrip(5e-324));
+	printPassFail("floatMinNorm", isFloatRoundTrip(DBL_MIN));
+	printPassFail("floatMaxSub", isFloatRoundTrip(DBL_MIN - 5e-324));
+	printPassFail("floatMax", isFloatRoundTrip(DBL_MAX));
+	printPassFail("float2Pow53Less1", isFloatRoundTrip(9007199254740991.0));
+	printPassFail("float2Pow53", isFloatRoundTrip(9007199254740992.0));
+	printPassFail("float2Pow53Plus2", isFloatRoundTrip(9007199254740994.0));
+	printPassFail("float1e23", isFloatRoundTrip(1e23));
+	printPassFail("floatThird", isFloatRoundTrip(1.0/3));
+	printPassFail("floatNeg", isFloatRoundTrip(-2.5e-300));
+	isOk = csc_TRUE;
+	for (i=0; i<200000 && isOk; i++)
+	{	bits = rand64();
+		memcpy(&val, &bits, sizeof(val));
+		if (isfinite(val))
+			isOk = isFloatRoundTrip(val);
+	}
+	printPassFail("floatRandom", isOk);
+
+// Infinities and NaNs are written as such, but only the JSON writers
+// guard against writing them.
+	printPassFail("floatInf", csc_numConv_fmtFloat(buf,INFINITY)==3 && csc_streq(buf,"inf"));
+	printPassFail("floatNegInf", csc_numConv_fmtFloat(buf,-INFINITY)==4 && csc_streq(buf,"-inf"));
+	csc_numConv_fmtFloat(buf, NAN);
+	printPassFail("floatNan", strstr(buf,"nan")!=NULL);
+
+// csc_numConv_decToFloat().
+	printPassFail("decZero", isDecOk(0, 0, csc_FALSE));
+	printPassFail("decNegZero", isDecOk(0, 5, csc_TRUE));
+	printPassFail("decMinSub", isDecOk(5, -324, csc_FALSE));
+	printPassFail("decBelowMinSub", isDecOk(2, -324, csc_FALSE));
+	printPassFail("decHalfMinSub", isDecOk(24703282292062327ULL, -340, csc_FALSE));
+	printPassFail("decOverHalfMinSub", isDecOk(24703282292062328ULL, -340, csc_FALSE));
+	printPassFail("decMax", isDecOk(17976931348623157ULL, 292, csc_FALSE));
+	printPassFail("decOverMax", isDecOk(17976931348623159ULL, 292, csc_FALSE));
+	printPassFail("dec2Pow53Plus1", isDecOk(9007199254740993ULL, 0, csc_FALSE));
+	printPassFail("dec19Digits", isDecOk(9999999999999999999ULL, 0, csc_FALSE));
+	printPassFail("dec19DigitsExp", isDecOk(1234567890123456789ULL, -300, csc_TRUE));
+	printPassFail("dec20Digits", isDecOk(18446744073709551615ULL, 0, csc_FALSE));
+	printPassFail("dec20DigitsExp", isDecOk(18446744073709551615ULL, 280, csc_FALSE));
+	printPassFail("dec1e400", isDecOk(1, 400, csc_FALSE));
+	printPassFail("dec1eMinus400", isDecOk(1, -400, csc_FALSE));
+	isOk = csc_TRUE;
+	for (i=0; i<200000 && isOk; i++)
+		isOk = isDecOk(rand64() >> (rand64()%64), (int)(rand64()%700) - 350, rand64()%2);
+	printPassFail("decRandom", isOk);
+
+// Numbers read from JSON.
+	printPassFail("jsonMinSub", isJsonFloat("5e-324"));
+	printPassFail("jsonMax", isJsonFloat("1.7976931348623157e308"));
+	printPassFail("json2Pow53Plus1", isJsonFloat("9007199254740993.0"));
+	printPassFail("json19Digits", isJsonFloat("0.1234567890123456789"));
+	printPassFail("json20Digits", isJsonFloat("12345678901234567890"));
+	printPassFail("jsonLongDigits", isJsonFloat("2.22507385850720113605740979670913197593481954635164564e-308"));
+	printPassFail("json1e400", isJsonFloat("1E400"));
+	printPassFail("jsonMinus1e400", isJsonFloat("-1e400"));
+	js = csc_json_newParseStr("{\"min\":-9223372036854775808,\"max\":9223372036854775807}");
+	isOk =  csc_json_getInt64(js, "min", &errNum)==INT64_MIN && errNum==csc_jsonErr_Ok
+		 && csc_json_getInt64(js, "max", &errNum)==INT64_MAX && errNum==csc_jsonErr_Ok;
+	csc_json_free(js);
+	printPassFail("jsonInt64Limits", isOk);
+
+// Numbers written to JSON.
+	printPassFail("jsonWriteNums",
+		isJsonWritten("{\"a\":0.1,\"b\":-9223372036854775808,\"c\":5e-324}",
+					  "{\"a\":0.1,\"b\":-9223372036854775808,\"c\":5e-324}"));
+	printPassFail("jsonWriteInf", isJsonWritten("{\"g\":1E400,\"h\":-1e400}", "{\"g\":null,\"h\":null}"));
+	jw = csc_jsonWriter_new();
+	csc_jsonWriter_beginArr(jw);
+	csc_jsonWriter_float(jw, 0.1);
+	csc_jsonWriter_float(jw, INFINITY);
+	csc_jsonWriter_float(jw, -INFINITY);
+	csc_jsonWriter_float(jw, NAN);
+	csc_jsonWriter_int(jw, INT64_MIN);
+	csc_jsonWriter_endArr(jw);
+	printPassFail("jsonWriterNums",
+		csc_streq(csc_jsonWriter_buf(jw,NULL), "[0.1,null,null,null,-9223372036854775808]"));
+	csc_jsonWriter_free(jw);
+
+	printPassFail("free", csc_mck_nchunks()==0);
+	fclose(fout);
+	exit(0);
+}
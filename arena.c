@@ -0,0 +1,130 @@
+// Author: Dr Stephen Braithwaite.
+// This work is licensed under a Creative Commons Attribution-ShareAlike 4.0 International License.
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "std.h"
+#include "alloc.h"
+#include "arena.h"
+
+#define DefaultBlkSize 4096
+#define MaxBlkSize (1024*1024)
+#define Align 16
+
+
+typedef struct blk_s
+{   struct blk_s *next;
+    char pad[Align - sizeof(struct blk_s*)];   // The data is aligned.
+} blk_t;
+
+
+typedef struct onFree_s
+{   struct onFree_s *next;
+    void (*fn)(void *context);
+    void *context;
+} onFree_t;
+
+
+typedef struct csc_arena_t
+{   blk_t *blks;
+    char *p;       // The next free byte in the current block.
+    char *end;     // The end of the current block.
+    size_t blkSize;   // Of the next block.
+    onFree_t *onFrees;
+} csc_arena_t;
+
+
+csc_arena_t *csc_arena_new(size_t blkSize)
+{   csc_arena_t *arena = csc_allocOne(csc_arena_t);
+    arena->blks = NULL;
+    arena->p = NULL;
+    arena->end = NULL;
+    arena->blkSize = blkSize>0 ? blkSize : DefaultBlkSize;
+    arena->onFrees = NULL;
+    return arena;
+}
+
+
+// Gets 'size' bytes at a multiple of 'align', which is a power of two no
+// more than Align.
+static void *arenaGet(csc_arena_t *arena, size_t size, size_t align)
+{   blk_t *blk;
+    char *p;
+ 
+// Usually there is room in the current block.
+    if (arena->p != NULL)
+    {   p = (char*)(((uintptr_t)arena->p + align-1) & ~(uintptr_t)(align-1));
+        if (p<=arena->end && size<=(size_t)(arena->end-p))
+        {   arena->p = p + size;
+            return p;
+        }
+    }
+ 
+// A large request gets a block of its own, behind the current one, so
+// that the space left in the current one is not lost.
+    if (size > arena->blkSize/4)
+    {   blk = csc_ck_malloc(sizeof(blk_t) + size);
+        if (arena->blks == NULL)
+        {   blk->next = NULL;
+            arena->blks = blk;
+        }
+        else
+        {   blk->next = arena->blks->next;
+            arena->blks->next = blk;
+        }
+        return blk + 1;
+    }
+ 
+// Otherwise start a new block, and make the next one bigger.
+    blk = csc_ck_malloc(sizeof(blk_t) + arena->blkSize);
+    blk->next = arena->blks;
+    arena->blks = blk;
+    p = (char*)(blk + 1);
+    arena->p = p + size;
+    arena->end = p + arena->blkSize;
+    if (arena->blkSize < MaxBlkSize)
+        arena->blkSize *= 2;
+    return p;
+}
+
+
+void *csc_arena_alloc(csc_arena_t *arena, size_t size)
+{   return arenaGet(arena, size, Align);
+}
+
+
+// Strings need no alignment, so are packed together.
+char *csc_arena_strn(csc_arena_t *arena, const char *str, size_t len)
+{   char *s = arenaGet(arena, len+1, 1);
+    memcpy(s, str, len);
+    s[len] = '\0';
+    return s;
+}
+
+
+char *csc_arena_str(csc_arena_t *arena, const char *str)
+{   return csc_arena_strn(arena, str, strlen(str));
+}
+
+
+void csc_arena_onFree(csc_arena_t *arena, void (*fn)(void *context), void *context)
+{   onFree_t *of = csc_arena_alloc(arena, sizeof(onFree_t));
+    of->fn = fn;
+    of->context = context;
+    of->next = arena->onFrees;
+    arena->onFrees = of;
+}
+
+
+void csc_arena_free(csc_arena_t *arena)
+{   blk_t *blk, *next;
+    for (onFree_t *of=arena->onFrees; of!=NULL; of=of->next)
+        of->fn(of->context);
+    for (blk=arena->blks; blk!=NULL; blk=next)
+    {   next = blk->next;
+        free(blk);
+    }
+    free(arena);
+}
@@ -0,0 +1,42 @@
+// Author: Dr Stephen Braithwaite.
+// This work is licensed under a Creative Commons Attribution-ShareAlike 4.0 International License.
+
+#ifndef csc_ARENA_H
+#define csc_ARENA_H 1
+
+#include <stddef.h>
+#include "std.h"
+
+// An arena hands out space by moving a pointer through large blocks, and
+// frees all of it at once.  It suits many small objects that live and die
+// together, such as the nodes of a parsed document.
+
+typedef struct csc_arena_t csc_arena_t;
+
+
+// Create an arena that takes blocks from the heap, starting with one of
+// 'blkSize' bytes, or of a default size if 'blkSize' is zero, and
+// doubling in size up to a megabyte.
+csc_arena_t *csc_arena_new(size_t blkSize);
+
+// Get 'size' bytes from 'arena', aligned for any type.  The space is
+// valid until csc_arena_free().  A request for more than a quarter of the
+// next block gets a block of its own.
+void *csc_arena_alloc(csc_arena_t *arena, size_t size);
+
+// Copy the 'len' bytes at 'str' into 'arena' and add a '\0'.  Strings are
+// not aligned, so take no more space than they need.
+char *csc_arena_strn(csc_arena_t *arena, const char *str, size_t len);
+
+// Copy the string 'str' into 'arena'.
+char *csc_arena_str(csc_arena_t *arena, const char *str);
+
+// Arrange for 'fn'('context') to be called when 'arena' is freed, e.g. to
+// free something on the heap that belongs with what is in the arena.
+// These are called in the reverse order to which they were registered.
+void csc_arena_onFree(csc_arena_t *arena, void (*fn)(void *context), void *context);
+
+// Free 'arena' and everything allocated from it.
+void csc_arena_free(csc_arena_t *arena);
+
+#endif
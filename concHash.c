@@ -0,0 +1,286 @@
+// Author: Dr Stephen Braithwaite.
+// This work is licensed under a Creative Commons Attribution-ShareAlike 4.0 International License.
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <pthread.h>
+
+#include "std.h"
+#include "alloc.h"
+#include "concHash.h"
+
+/* Both are powers of two, and the table is never smaller than the number
+ * of stripes, so the stripe of a chain is the low bits of its hash value
+ * whatever the table size.
+ */
+#define NStripes 64
+#define InitTblSize 256
+#define CacheLineLen 64
+
+
+typedef struct node_t
+{   struct node_t *next;
+    void *data;
+    csc_ulong hash_val;
+} node_t;
+
+
+/* Each stripe is padded to a whole number of cache lines, so that threads
+ * locking neighbouring stripes do not contend for a line.  The stripes are
+ * allocated on a cache line boundary for the same reason.
+ */
+typedef union
+{   pthread_rwlock_t lock;
+    char pad[(sizeof(pthread_rwlock_t)+CacheLineLen-1)/CacheLineLen*CacheLineLen];
+} stripe_t;
+
+
+typedef struct csc_concHash_t
+{   stripe_t *stripes;
+    node_t **table;
+    csc_ulong tblsize;
+    csc_ulong count;
+    int offset;
+    int (*cmp)(void*,void*);
+    csc_ulong (*hval)(void*);
+    void (*free_rec)(void*);
+} csc_concHash_t;
+
+
+#define stripeOf(h,hash_val)  (&(h)->stripes[(hash_val) & (NStripes-1)].lock)
+
+
+/* malloc() does not align to a cache line, so the stripes come from
+ * posix_memalign().  They are freed with stripesFree().
+ */
+static stripe_t *stripesNew(void)
+{   void *p;
+    if (posix_memalign(&p, CacheLineLen, NStripes*sizeof(stripe_t)) != 0)
+    {   fprintf(stderr, "Error: Out of Memory!\n");
+        abort();
+    }
+    for (int i=0; i<NStripes; i++)
+        pthread_rwlock_init(&((stripe_t*)p)[i].lock, NULL);
+    return p;
+}
+
+
+/* The stripes are not from the memory checker, so bypass the free() macro.
+ */
+static void stripesFree(stripe_t *stripes)
+{   for (int i=0; i<NStripes; i++)
+        pthread_rwlock_destroy(&stripes[i].lock);
+    (free)(stripes);
+}
+
+
+csc_concHash_t *csc_concHash_new(int offset, int (*cmp)(void*,void*),
+                        csc_ulong (*hval)(void*), void (*free_rec)(void*) )
+{   csc_concHash_t *h;
+    h = csc_allocOne(csc_concHash_t);
+    h->stripes = stripesNew();
+    h->tblsize = InitTblSize;
+    h->table = (node_t**)csc_ck_calloc(h->tblsize * sizeof(node_t*));
+    h->count = 0;
+    h->offset = offset;
+    assert(cmp!=NULL);
+    h->cmp = cmp;
+    assert(hval!=NULL);
+    h->hval = hval;
+    assert(free_rec!=NULL);
+    h->free_rec = free_rec;
+    return h;
+}
+
+
+/* Doubles the table if it has reached an average chain length of 2.
+ * Takes every stripe in order, so that no thread is in the table.
+ */
+static void resize(csc_concHash_t *h, csc_ulong tblsize)
+{   node_t **table, *pt, *next;
+    csc_ulong ndx;
+    int i;
+ 
+    for (i=0; i<NStripes; i++)
+        pthread_rwlock_wrlock(&h->stripes[i].lock);
+ 
+/* Another thread may have resized first. */
+    if (h->tblsize == tblsize)
+    {   table = (node_t**)csc_ck_calloc(tblsize * 2 * sizeof(node_t*));
+        for (csc_ulong j=0; j<tblsize; j++)
+        {   for (pt=h->table[j]; pt!=NULL; pt=next)
+            {   next = pt->next;
+                ndx = pt->hash_val & (tblsize*2-1);
+                pt->next = table[ndx];
+                table[ndx] = pt;
+            }
+        }
+        free(h->table);
+        h->table = table;
+        h->tblsize = tblsize * 2;
+    }
+ 
+    for (i=NStripes-1; i>=0; i--)
+        pthread_rwlock_unlock(&h->stripes[i].lock);
+}
+
+
+/* Returns the link to the first node with key 'key', or NULL.  The
+ * stripe must be locked.
+ */
+static node_t **find(csc_concHash_t *h, void *key, csc_ulong hash_val)
+{   node_t **ppt;
+    int offset = h->offset;
+    int (*cmp)(void*,void*) = h->cmp;
+ 
+    ppt = &h->table[hash_val & (h->tblsize-1)];
+    for ( ; *ppt!=NULL; ppt=&(*ppt)->next)
+    {   if ((*ppt)->hash_val==hash_val && cmp(((char*)(*ppt)->data)+offset, key)==0)
+            return ppt;
+    }
+    return NULL;
+}
+
+
+static int insert(csc_concHash_t *h, void *rec, csc_bool_t isExclusive)
+{   csc_ulong hash_val = h->hval((char*)rec + h->offset);
+    pthread_rwlock_t *lock = stripeOf(h, hash_val);
+    csc_ulong ndx, tblsize, count;
+    node_t *pt;
+ 
+/* Allocate outside the lock. */
+    pt = csc_allocOne(node_t);
+    pt->data = rec;
+    pt->hash_val = hash_val;
+ 
+    pthread_rwlock_wrlock(lock);
+    if (isExclusive && find(h, (char*)rec + h->offset, hash_val) != NULL)
+    {   pthread_rwlock_unlock(lock);
+        free(pt);
+        return csc_FALSE;
+    }
+    ndx = hash_val & (h->tblsize-1);
+    pt->next = h->table[ndx];
+    h->table[ndx] = pt;
+    tblsize = h->tblsize;
+    pthread_rwlock_unlock(lock);
+ 
+    count = __sync_add_and_fetch(&h->count, 1);
+    if (count > tblsize*2)
+        resize(h, tblsize);
+    return csc_TRUE;
+}
+
+
+void csc_concHash_add(csc_concHash_t *h, void *rec)
+{   insert(h, rec, csc_FALSE);
+}
+
+
+int csc_concHash_addex(csc_concHash_t *h, void *rec)
+{   return insert(h, rec, csc_TRUE);
+}
+
+
+void *csc_concHash_get(csc_concHash_t *h, void *key)
+{   csc_ulong hash_val = h->hval(key);
+    pthread_rwlock_t *lock = stripeOf(h, hash_val);
+    node_t **ppt;
+    void *rec;
+ 
+    pthread_rwlock_rdlock(lock);
+    ppt = find(h, key, hash_val);
+    rec = ppt!=NULL ? (*ppt)->data : NULL;
+    pthread_rwlock_unlock(lock);
+    return rec;
+}
+
+
+int csc_concHash_getFn(csc_concHash_t *h, void *key,
+                       void (*fn)(void *rec, void *context), void *context)
+{   csc_ulong hash_val = h->hval(key);
+    pthread_rwlock_t *lock = stripeOf(h, hash_val);
+    node_t **ppt;
+ 
+    pthread_rwlock_rdlock(lock);
+    ppt = find(h, key, hash_val);
+    if (ppt != NULL)
+        fn((*ppt)->data, context);
+    pthread_rwlock_unlock(lock);
+    return ppt != NULL;
+}
+
+
+void *csc_concHash_out(csc_concHash_t *h, void *key)
+{   csc_ulong hash_val = h->hval(key);
+    pthread_rwlock_t *lock = stripeOf(h, hash_val);
+    node_t **ppt, *pt;
+    void *rec;
+ 
+    pthread_rwlock_wrlock(lock);
+    ppt = find(h, key, hash_val);
+    if (ppt == NULL)
+    {   pthread_rwlock_unlock(lock);
+        return NULL;
+    }
+    pt = *ppt;
+    *ppt = pt->next;
+    pthread_rwlock_unlock(lock);
+ 
+    __sync_sub_and_fetch(&h->count, 1);
+    rec = pt->data;
+    free(pt);
+    return rec;
+}
+
+
+int csc_concHash_del(csc_concHash_t *h, void *key)
+{   void *p;
+    p = csc_concHash_out(h, key);
+    if (p == NULL)
+        return csc_FALSE;
+    else
+    {   h->free_rec(p);
+        return csc_TRUE;
+    }
+}
+
+
+csc_ulong csc_concHash_count(csc_concHash_t *h)
+{   return __sync_add_and_fetch(&h->count, 0);
+}
+
+
+void csc_concHash_forEach(csc_concHash_t *h,
+                          void (*fn)(void *rec, void *context), void *context)
+{   node_t *pt;
+ 
+/* Chain j belongs to stripe j mod NStripes. */
+    for (int i=0; i<NStripes; i++)
+    {   pthread_rwlock_rdlock(&h->stripes[i].lock);
+        for (csc_ulong j=i; j<h->tblsize; j+=NStripes)
+        {   for (pt=h->table[j]; pt!=NULL; pt=pt->next)
+                fn(pt->data, context);
+        }
+        pthread_rwlock_unlock(&h->stripes[i].lock);
+    }
+}
+
+
+void csc_concHash_free(csc_concHash_t *h)
+{   node_t *pt, *next;
+ 
+    for (csc_ulong i=0; i<h->tblsize; i++)
+    {   for (pt=h->table[i]; pt!=NULL; pt=next)
+        {   next = pt->next;
+            h->free_rec(pt->data);
+            free(pt);
+        }
+    }
+    stripesFree(h->stripes);
+    free(h->table);
+    free(h);
+}
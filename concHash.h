@@ -0,0 +1,82 @@
+// Author: Dr Stephen Braithwaite.
+// This work is licensed under a Creative Commons Attribution-ShareAlike 4.0 International License.
+
+#ifndef csc_CONCHASH_H
+#define csc_CONCHASH_H 1
+#include "std.h"
+
+typedef struct csc_concHash_t csc_concHash_t;
+
+
+csc_concHash_t *csc_concHash_new(int offset, int (*cmp)(void*,void*),
+                unsigned long (*hval)(void*), void (*free_rec)(void*) );
+/*  This function allocates and initializes a hash table that may be used
+ * from many threads at once.  The arguments are the same as for
+ * csc_hash_new().
+ *
+ *  Resolution is by chaining.  The chains are divided among 64 stripes,
+ * each with its own read/write lock, so threads working on different
+ * stripes do not wait for each other, and lookups on the same stripe
+ * proceed together.  A chain's stripe does not change when the table
+ * grows, which takes all the locks.
+ */
+
+int csc_concHash_addex(csc_concHash_t *hash, void *rec);
+/*  If a key matching 'rec' already exists in 'hash' then this
+ * function will return csc_FALSE.  Otherwise it will add 'rec' to 'hash'
+ * and return csc_TRUE.  The test and the add are one atomic step.
+ */
+
+void csc_concHash_add(csc_concHash_t *hash, void *rec);
+/*  This function will add 'rec' to 'hash' regardless of whether
+ * there are matching keys.
+ */
+
+void *csc_concHash_get(csc_concHash_t *hash, void *key);
+/*  If no record with a key of 'key' exists in 'hash', this function will
+ * return NULL.  Otherwise it will return a pointer to the last added
+ * record with a key of 'key'.  The table holds no lock on the record
+ * once this returns, so the caller must know that no other thread will
+ * remove and free it while it is in use.  If records may be removed, use
+ * csc_concHash_getFn() instead.
+ */
+
+int csc_concHash_getFn(csc_concHash_t *hash, void *key,
+                       void (*fn)(void *rec, void *context), void *context);
+/*  If a record with a key of 'key' exists in 'hash', this function calls
+ * 'fn'() with it and 'context' while its stripe is locked for reading,
+ * and returns csc_TRUE.  Otherwise it returns csc_FALSE.  'fn'() may read
+ * the record or copy from it, but must not call the table.
+ */
+
+void *csc_concHash_out(csc_concHash_t *hash, void *key);
+/*  If no record with a key of 'key' exists in 'hash', this function will
+ * return NULL.  Otherwise it will return a pointer to the last added record
+ * with a key of 'key' (LIFO).  This function removes the record from 'hash'
+ * but it does not free it.
+ */
+
+int csc_concHash_del(csc_concHash_t *hash, void *key);
+/*  If no record with a key of 'key' exists in 'hash', this function
+ * will return csc_FALSE.  Otherwise it will remove the last added record
+ * with a key of 'key', free it and return csc_TRUE.
+ */
+
+unsigned long csc_concHash_count(csc_concHash_t *hash);
+/*  Returns the number of records in 'hash'.
+ */
+
+void csc_concHash_forEach(csc_concHash_t *hash,
+                          void (*fn)(void *rec, void *context), void *context);
+/*  Calls 'fn'() with every record in 'hash' and 'context'.  Each stripe is
+ * locked for reading while its records are visited, so records added or
+ * removed meanwhile by other threads may or may not be seen.  'fn'() must
+ * not call the table.
+ */
+
+void csc_concHash_free(csc_concHash_t *hash);
+/*  This function will free any records remaining in 'hash' and free the
+ * space associated with the table.  No other thread may be using it.
+ */
+
+#endif
@@ -0,0 +1,329 @@
+// Author: Dr Stephen Braithwaite.
+// This work is licensed under a Creative Commons Attribution-ShareAlike 4.0 International License.
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <assert.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "std.h"
+#include "alloc.h"
+#include "flatHash.h"
+
+#define GroupSize 16
+#define InitSlots 32
+
+/* Control bytes.  A full slot holds the 7 low bits of the mixed hash. */
+#define CtrlEmpty   ((csc_uchar)0x80)
+#define CtrlDeleted ((csc_uchar)0xFE)
+
+
+typedef struct csc_flatHash_t
+{   csc_uchar *ctrl;
+    void **slots;
+    csc_ulong nSlots;
+    csc_ulong groupMask;
+    csc_ulong count;
+    csc_ulong nDeleted;
+    csc_ulong growAt;
+    int offset;
+    int (*cmp)(void*,void*);
+    csc_ulong (*hval)(void*);
+    void (*free_rec)(void*);
+} csc_flatHash_t;
+
+
+/* The hash value selects both a group and a 7 bit tag, so its bits
+ * must all depend on all the bits of the key.  This is the finaliser
+ * from MurmurHash3.
+ */
+static inline uint64_t mixHash(uint64_t x)
+{   x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+
+/* Returns a bit mask of the control bytes in a group that equal 'ch'. */
+static inline csc_uint groupMatch(const csc_uchar *ctrl, csc_uchar ch)
+{
+#ifdef __SSE2__
+    __m128i grp = _mm_loadu_si128((const __m128i*)ctrl);
+    return (csc_uint)_mm_movemask_epi8(_mm_cmpeq_epi8(grp, _mm_set1_epi8((char)ch)));
+#else
+    csc_uint match = 0;
+    for (int i=0; i<GroupSize; i++)
+    {   if (ctrl[i] == ch)
+            match |= 1u << i;
+    }
+    return match;
+#endif
+}
+
+
+/* Returns a bit mask of the slots in a group that are empty or deleted. */
+static inline csc_uint groupMatchFree(const csc_uchar *ctrl)
+{
+#ifdef __SSE2__
+    return (csc_uint)_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)ctrl));
+#else
+    csc_uint match = 0;
+    for (int i=0; i<GroupSize; i++)
+    {   if (ctrl[i] & 0x80)
+            match |= 1u << i;
+    }
+    return match;
+#endif
+}
+
+
+static void tableAlloc(csc_flatHash_t *h, csc_ulong nSlots)
+{   h->nSlots = nSlots;
+    h->groupMask = nSlots/GroupSize - 1;
+    h->growAt = nSlots - nSlots/8;
+    h->nDeleted = 0;
+    h->ctrl = csc_allocMany(csc_uchar, nSlots);
+    memset(h->ctrl, CtrlEmpty, nSlots);
+    h->slots = csc_allocMany(void*, nSlots);
+}
+
+
+/* Returns the first free slot on the probe sequence for 'mixed'. */
+static csc_ulong findFree(csc_flatHash_t *h, uint64_t mixed)
+{   csc_ulong group = (mixed >> 7) & h->groupMask;
+    csc_ulong step = 0;
+    csc_uint match;
+ 
+    while ((match = groupMatchFree(h->ctrl + group*GroupSize)) == 0)
+        group = (group + ++step) & h->groupMask;
+    return group*GroupSize + __builtin_ctz(match);
+}
+
+
+/* Returns the slot holding a record with key 'key', or -1. */
+static long findKey(csc_flatHash_t *h, void *key, uint64_t mixed)
+{   csc_ulong group = (mixed >> 7) & h->groupMask;
+    csc_uchar h2 = (csc_uchar)(mixed & 0x7F);
+    csc_ulong step = 0;
+    csc_ulong slot;
+    csc_uchar *ctrl;
+    csc_uint match;
+    int offset = h->offset;
+    int (*cmp)(void*,void*) = h->cmp;
+ 
+    for (;;)
+    {   ctrl = h->ctrl + group*GroupSize;
+        for (match=groupMatch(ctrl,h2); match!=0; match&=match-1)
+        {   slot = group*GroupSize + __builtin_ctz(match);
+            if (cmp((char*)h->slots[slot]+offset, key) == 0)
+                return (long)slot;
+        }
+ 
+/* A group with an empty slot ends every probe sequence through it. */
+        if (groupMatch(ctrl, CtrlEmpty) != 0)
+            return -1;
+        group = (group + ++step) & h->groupMask;
+    }
+}
+
+
+static void tableResize(csc_flatHash_t *h, csc_ulong nSlots)
+{   csc_uchar *oldCtrl = h->ctrl;
+    void **oldSlots = h->slots;
+    csc_ulong oldNSlots = h->nSlots;
+    csc_ulong slot;
+    uint64_t mixed;
+    void *rec;
+ 
+    tableAlloc(h, nSlots);
+    for (csc_ulong i=0; i<oldNSlots; i++)
+    {   if ((oldCtrl[i] & 0x80) == 0)
+        {   rec = oldSlots[i];
+            mixed = mixHash(h->hval((char*)rec + h->offset));
+            slot = findFree(h, mixed);
+            h->ctrl[slot] = (csc_uchar)(mixed & 0x7F);
+            h->slots[slot] = rec;
+        }
+    }
+    free(oldCtrl);
+    free(oldSlots);
+}
+
+
+static void tableInsert(csc_flatHash_t *h, void *rec, uint64_t mixed)
+{   csc_ulong slot;
+ 
+/* Make room.  Grow if live records would be over half the limit,
+ * otherwise just clear out the deleted slots.
+ */
+    if (h->count + h->nDeleted >= h->growAt)
+    {   if (h->count >= h->growAt/2)
+            tableResize(h, h->nSlots*2);
+        else
+            tableResize(h, h->nSlots);
+    }
+ 
+    slot = findFree(h, mixed);
+    if (h->ctrl[slot] == CtrlDeleted)
+        h->nDeleted--;
+    h->ctrl[slot] = (csc_uchar)(mixed & 0x7F);
+    h->slots[slot] = rec;
+    h->count++;
+}
+
+
+csc_flatHash_t *csc_flatHash_new(int offset, int (*cmp)(void*,void*),
+                        csc_ulong (*hval)(void*), void (*free_rec)(void*) )
+{   csc_flatHash_t *h;
+    h = csc_allocOne(csc_flatHash_t);
+    h->count = 0;
+    tableAlloc(h, InitSlots);
+    h->offset = offset;
+    assert(cmp!=NULL);
+    h->cmp = cmp;
+    assert(hval!=NULL);
+    h->hval = hval;
+    assert(free_rec!=NULL);
+    h->free_rec = free_rec;
+    return h;
+}
+
+
+void csc_flatHash_add(csc_flatHash_t *h, void *rec)
+{   tableInsert(h, rec, mixHash(h->hval((char*)rec + h->offset)));
+}
+
+
+int csc_flatHash_addex(csc_flatHash_t *h, void *rec)
+{   void *key = (char*)rec + h->offset;
+    uint64_t mixed = mixHash(h->hval(key));
+ 
+    if (findKey(h, key, mixed) >= 0)
+        return csc_FALSE;
+    tableInsert(h, rec, mixed);
+    return csc_TRUE;
+}
+
+
+void *csc_flatHash_get(csc_flatHash_t *h, void *key)
+{   long slot = findKey(h, key, mixHash(h->hval(key)));
+    if (slot < 0)
+        return NULL;
+    else
+        return h->slots[slot];
+}
+
+
+void *csc_flatHash_out(csc_flatHash_t *h, void *key)
+{   long slot = findKey(h, key, mixHash(h->hval(key)));
+    csc_uchar *grpCtrl;
+ 
+    if (slot < 0)
+        return NULL;
+ 
+/* If the group still has an empty slot then no probe sequence has ever
+ * passed through it, and the slot can be made empty again.
+ */
+    grpCtrl = h->ctrl + (slot/GroupSize)*GroupSize;
+    if (groupMatch(grpCtrl, CtrlEmpty) != 0)
+        h->ctrl[slot] = CtrlEmpty;
+    else
+    {   h->ctrl[slot] = CtrlDeleted;
+        h->nDeleted++;
+    }
+    h->count--;
+    return h->slots[slot];
+}
+
+
+int csc_flatHash_del(csc_flatHash_t *h, void *key)
+{   void *p;
+    p = csc_flatHash_out(h, key);
+    if (p == NULL)
+        return csc_FALSE;
+    else
+    {   h->free_rec(p);
+        return csc_TRUE;
+    }
+}
+
+
+csc_ulong csc_flatHash_count(csc_flatHash_t *h)
+{   return h->count;
+}
+
+
+void csc_flatHash_free(csc_flatHash_t *h)
+{   void (*free_rec)(void*) = h->free_rec;
+    for (csc_ulong i=0; i<h->nSlots; i++)
+    {   if ((h->ctrl[i] & 0x80) == 0)
+            free_rec(h->slots[i]);
+    }
+    free(h->ctrl);
+    free(h->slots);
+    free(h);
+}
+
+
+void csc_flatHash_key_init(csc_flatHash_t *h, csc_flatHash_iter_t *i, void *key)
+{   uint64_t mixed = mixHash(h->hval(key));
+    csc_uchar *ctrl;
+ 
+    i->key = key;
+    i->h2 = (csc_uchar)(mixed & 0x7F);
+    i->group = (mixed >> 7) & h->groupMask;
+    i->step = 0;
+    ctrl = h->ctrl + i->group*GroupSize;
+    i->match = groupMatch(ctrl, i->h2);
+    i->isLast = groupMatch(ctrl, CtrlEmpty) != 0;
+}
+
+void *csc_flatHash_key_next(csc_flatHash_t *h, csc_flatHash_iter_t *i)
+{   int offset = h->offset;
+    int (*cmp)(void*,void*) = h->cmp;
+    csc_ulong slot;
+    csc_uchar *ctrl;
+ 
+    for (;;)
+    {   while (i->match != 0)
+        {   slot = i->group*GroupSize + __builtin_ctz(i->match);
+            i->match &= i->match - 1;
+            if (cmp((char*)h->slots[slot]+offset, i->key) == 0)
+                return h->slots[slot];
+        }
+        if (i->isLast)
+            return NULL;
+        i->group = (i->group + ++i->step) & h->groupMask;
+        ctrl = h->ctrl + i->group*GroupSize;
+        i->match = groupMatch(ctrl, i->h2);
+        i->isLast = groupMatch(ctrl, CtrlEmpty) != 0;
+    }
+}
+
+void csc_flatHash_all_init(csc_flatHash_t *h, csc_flatHash_iter_t *i)
+{   (void)h;
+    i->islot = 0;
+}
+
+void *csc_flatHash_all_next(csc_flatHash_t *h, csc_flatHash_iter_t *i)
+{   csc_ulong islot = i->islot;
+    csc_ulong nSlots = h->nSlots;
+    csc_uchar *ctrl = h->ctrl;
+ 
+    while (islot<nSlots && (ctrl[islot] & 0x80))
+        islot++;
+    if (islot == nSlots)
+    {   i->islot = islot;
+        return NULL;
+    }
+    i->islot = islot + 1;
+    return h->slots[islot];
+}
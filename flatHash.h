@@ -0,0 +1,95 @@
+// Author: Dr Stephen Braithwaite.
+// This work is licensed under a Creative Commons Attribution-ShareAlike 4.0 International License.
+
+#ifndef csc_FLATHASH_H
+#define csc_FLATHASH_H 1
+#include "std.h"
+
+typedef struct csc_flatHash_t csc_flatHash_t;
+
+typedef struct
+{
+/* Innards are private! */
+    void *key;
+    unsigned long group;
+    unsigned long step;
+    unsigned int match;
+    unsigned char h2;
+    unsigned char isLast;
+    unsigned long islot;
+} csc_flatHash_iter_t;
+
+
+csc_flatHash_t *csc_flatHash_new(int offset, int (*cmp)(void*,void*),
+                unsigned long (*hval)(void*), void (*free_rec)(void*) );
+/*  This function allocates and initializes a hash table.  The arguments
+ * are the same as for csc_hash_new(), so a table may be changed from one
+ * to the other by changing the names of the functions.
+ *
+ *  Resolution is by open addressing.  The table is an array of record
+ * pointers in groups of 16, with one control byte per slot that holds 7
+ * bits of the hash value, or marks the slot empty or deleted.  A lookup
+ * compares the 16 control bytes of a group at once (with SSE2 where
+ * available), and only calls 'cmp'() on the few slots that match.  There
+ * is no allocation per record, and no chain to follow.  The table is
+ * grown when it is 7/8 full, at which point 'hval'() is called again for
+ * each record.
+ */
+
+int csc_flatHash_addex(csc_flatHash_t *hash, void *rec);
+/*  If a key matching 'rec' already exists in 'hash' then this
+ * function will return csc_FALSE.  Otherwise it will add 'rec' to 'hash'
+ * and return csc_TRUE.
+ */
+
+void csc_flatHash_add(csc_flatHash_t *hash, void *rec);
+/*  This function will add 'rec' to 'hash' regardless of whether
+ * there are matching keys.
+ */
+
+void *csc_flatHash_get(csc_flatHash_t *hash, void *key);
+/*  If no record with a key of 'key' exists in 'hash', this function will
+ * return NULL.  Otherwise it will return a pointer a record
+ * with a key of 'key'.
+ */
+
+void *csc_flatHash_out(csc_flatHash_t *hash, void *key);
+/*  If no record with a key of 'key' exists in 'hash', this function will
+ * return NULL.  Otherwise it will return a pointer to a record with a key
+ * of 'key'.  Unlike csc_hash_out(), where there are several such records
+ * it is not necessarily the last added.  This function removes the record
+ * from 'hash' but it does not free it.
+ */
+
+int csc_flatHash_del(csc_flatHash_t *hash, void *key);
+/*  If no record with a key of 'key' exists in 'hash', this function
+ * will return csc_FALSE.  Otherwise it will remove a record with a key
+ * of 'key', free it and return csc_TRUE.
+ */
+
+unsigned long csc_flatHash_count(csc_flatHash_t *hash);
+/*  Returns the number of records in 'hash'.
+ */
+
+void csc_flatHash_free(csc_flatHash_t *hash);
+/*  This function will free any records remaining in 'hash' and free the
+ * space associated with the table.
+ */
+
+
+/*  The iterators are as for csc_hash_t.  The table must not be added to or
+ * removed from while an iteration is in progress.
+ */
+
+#define for_flatHash_key(h,i,key,dat,dat_type) \
+    for (csc_flatHash_key_init(h,&i,key); ((dat)=(dat_type)csc_flatHash_key_next(h,&i))!=NULL; )
+
+#define for_flatHash_all(h,i,dat,dat_type) \
+    for (csc_flatHash_all_init(h,&i); ((dat)=(dat_type)csc_flatHash_all_next(h,&i))!=NULL; )
+
+void csc_flatHash_key_init(csc_flatHash_t *h, csc_flatHash_iter_t *i, void *key);
+void *csc_flatHash_key_next(csc_flatHash_t *h, csc_flatHash_iter_t *i);
+void csc_flatHash_all_init(csc_flatHash_t *h, csc_flatHash_iter_t *i);
+void *csc_flatHash_all_next(csc_flatHash_t *h, csc_flatHash_iter_t *i);
+
+#endif
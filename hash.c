@@ -5,13 +5,19 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include <assert.h>
 
 #include "std.h"
 #include "alloc.h"
 
-#define MUL 293
-#define ADD 1
+/* Constants for the hash functions. */
+#define K0 0xa0761d6478bd642fULL
+#define K1 0xe7037ed1a0b428dbULL
+#define K2 0x8ebc6af09c88c6e3ULL
 
 #define for_hash_key(h,i,key,dat,dat_type) \
     for (csc_hash_key_init(h,&i,key); ((dat)=(dat_type)csc_hash_key_next(h,&i))!=NULL; )
@@ -33,10 +39,25 @@ typedef struct csc_hash_t
     unsigned long tblsize;
     unsigned long count;
     unsigned long maxcount;
+    unsigned long mincount;
+    csc_hash_node_t **oldTable;
+    unsigned long oldTblsize;
+    unsigned long rehashNdx;
+    csc_bool_t isIterPaused;
     int offset;
     int (*cmp)(void*,void*);
     unsigned long (*hval)(void*);
+    unsigned long (*hvals)(void*,unsigned long);
+    unsigned long seed;
+    int linkOffset;
     void (*free_rec)(void*);
+    double maxLoad;
+    unsigned long minTblsize;
+    unsigned long nResizes;
+    csc_bool_t isCounting;
+    unsigned long nLookups;
+    unsigned long nProbes;
+    unsigned long nCompares;
 } csc_hash_t;    
 
 
@@ -50,86 +71,341 @@ typedef struct
 } csc_hash_iter_t;
 
 
-csc_hash_t *csc_hash_new(int offset, int (*cmp)(void*,void*),
-                        csc_ulong (*hval)(void*), void (*free_rec)(void*) )
-/*  This function allocates and initializes a hash table.  
- * Resolution is by chaining.  The table will have 'tblsize' elements.  
- * The key field of the record is at position 'offset' from the 
- * beginning of the record.  The function 'cmp'() must be able to 
- * compare two keys and return zero if they compare equal, non zero 
- * otherwise.  The function 'hval'() will generate a hash value from a 
- * key.  The value returned from 'hval'() will be subsequently 
- * subjected to MOD 'tblsize'.  The function 'free_rec'() is able to 
- * dispose of a record.
- */ 
+#define csc_hash_HistLen 8
+
+typedef struct
+{   unsigned long count;
+    unsigned long tblsize;
+    double loadFactor;
+    unsigned long chainHist[csc_hash_HistLen];
+    unsigned long maxChain;
+    unsigned long nResizes;
+    int isRehashing;
+    unsigned long nLookups;
+    unsigned long nProbes;
+    unsigned long nCompares;
+} csc_hash_stats_t;
+
+
+/* Rehashing is incremental.  While it is in progress the old table is
+ * kept, and each add or removal moves a few of its chains across to the
+ * new table, so that no single operation pauses for O(n).  Records in
+ * old table chains not yet moved are still found by lookups.  The table
+ * is shrunk when there are fewer records than 1/16 of the chains.
+ */
+#define InitTblSize 64
+#define RehashStep 4
+
+
+/* Tables are a power of two in size, and the chain is chosen by masking
+ * the hash value.
+ */
+static csc_ulong pow2AtLeast(csc_ulong n)
+{   csc_ulong size = InitTblSize;
+    while (size < n)
+        size *= 2;
+    return size;
+}
+
+
+static inline csc_ulong csc_hash_keyVal(csc_hash_t *h, void *key)
+{   if (h->hvals != NULL)
+        return h->hvals(key, h->seed);
+    else
+        return h->hval(key);
+}
+
+
+/* Returns a different random seed for each table.  The first is read from
+ * the system, and the rest follow from it by the SplitMix64 generator.
+ */
+static csc_ulong csc_hash_newSeed(void)
+{   static uint64_t state = 0;
+    uint64_t x;
+    int fd;
+ 
+    if (state == 0)
+    {   x = 0;
+        fd = open("/dev/urandom", O_RDONLY);
+        if (fd >= 0)
+        {   if (read(fd, &x, sizeof(x)) != sizeof(x))
+                x = 0;
+            close(fd);
+        }
+        x ^= (uint64_t)time(NULL) ^ ((uint64_t)getpid() << 32) ^ (uint64_t)(uintptr_t)&x;
+        __sync_bool_compare_and_swap(&state, 0, x|1);
+    }
+    x = __sync_add_and_fetch(&state, 0x9e3779b97f4a7c15ULL);
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return (csc_ulong)(x ^ (x >> 31));
+}
+
+
+/* The table grows when the load factor reaches 'maxLoad', to a size
+ * that brings it down to half of 'maxLoad', or to a half if that is
+ * less.  It shrinks when the load falls to 1/16 of that.
+ */
+#define DefaultMaxLoad 5.0
+
+static double csc_hash_lowLoad(csc_hash_t *h)
+{   return h->maxLoad<1.0 ? h->maxLoad : 1.0;
+}
+
+
+static csc_ulong csc_hash_sizeFor(csc_hash_t *h, csc_ulong count)
+{   return pow2AtLeast((csc_ulong)(2.0 * count / csc_hash_lowLoad(h)));
+}
+
+
+/* The size to shrink to, which is never below the size reserved. */
+static csc_ulong csc_hash_shrinkSize(csc_hash_t *h)
+{   csc_ulong tblsize = csc_hash_sizeFor(h, h->count);
+    return tblsize>h->minTblsize ? tblsize : h->minTblsize;
+}
+
+
+static void tableSetLimits(csc_hash_t *h)
+{   h->maxcount = (csc_ulong)(h->tblsize * h->maxLoad);
+    if (h->tblsize>InitTblSize && h->tblsize>h->minTblsize)
+        h->mincount = (csc_ulong)(h->tblsize * csc_hash_lowLoad(h) / 16);
+    else
+        h->mincount = 0;
+}
+
+
+static void tableSetSize(csc_hash_t *h, csc_ulong tblsize)
+{   h->table = (csc_hash_node_t**)csc_ck_calloc(tblsize * sizeof(csc_hash_node_t*));
+    h->tblsize = tblsize;
+    tableSetLimits(h);
+}
+
+
+static csc_hash_t *csc_hash_create(int offset, int linkOffset, int (*cmp)(void*,void*),
+                        csc_ulong (*hval)(void*), csc_ulong (*hvals)(void*,csc_ulong),
+                        void (*free_rec)(void*) )
 {   csc_hash_t *h;
     h = csc_allocOne(csc_hash_t);
-    h->tblsize = 40;
     h->count = 0;
-    h->maxcount = h->tblsize * 5;
-    h->table = (csc_hash_node_t**)csc_ck_calloc(h->tblsize * sizeof(csc_hash_node_t*));
+    h->maxLoad = DefaultMaxLoad;
+    h->minTblsize = 0;
+    tableSetSize(h, InitTblSize);
+    h->oldTable = NULL;
+    h->oldTblsize = 0;
+    h->rehashNdx = 0;
+    h->isIterPaused = csc_FALSE;
     h->offset = offset;
     assert(cmp!=NULL);
     h->cmp = cmp;
-    assert(hval!=NULL);
     h->hval = hval;
+    h->hvals = hvals;
+    h->seed = hvals!=NULL ? csc_hash_newSeed() : 0;
+    h->linkOffset = linkOffset;
     assert(free_rec!=NULL);
     h->free_rec = free_rec;
+    h->nResizes = 0;
+    h->isCounting = csc_FALSE;
+    h->nLookups = 0;
+    h->nProbes = 0;
+    h->nCompares = 0;
     return h;
 }
 
 
-static void csc_hash_resize(csc_hash_t *h)
-{   csc_hash_node_t *pt, *next;
-    csc_ulong i_table;
-    csc_hash_node_t **new_table;
-    csc_ulong ndx, new_tblsize, old_tblsize;
+csc_hash_t *csc_hash_new(int offset, int (*cmp)(void*,void*),
+                        csc_ulong (*hval)(void*), void (*free_rec)(void*) )
+/*  This function allocates and initializes a hash table.  
+ * Resolution is by chaining.  The key field of the record is at
+ * position 'offset' from the beginning of the record.  The function
+ * 'cmp'() must be able to compare two keys and return zero if they
+ * compare equal, non zero otherwise.  The function 'hval'() will
+ * generate a hash value from a key.  The low bits of the value returned
+ * from 'hval'() select the chain.  The function 'free_rec'() is able to
+ * dispose of a record.
+ */ 
+{   assert(hval!=NULL);
+    return csc_hash_create(offset, -1, cmp, hval, NULL, free_rec);
+}
+
+
+csc_hash_t *csc_hash_newSeeded(int offset, int (*cmp)(void*,void*),
+                        csc_ulong (*hvals)(void*,csc_ulong), void (*free_rec)(void*) )
+/*  As csc_hash_new(), but 'hvals'() is also given the table's random seed.
+ */ 
+{   assert(hvals!=NULL);
+    return csc_hash_create(offset, -1, cmp, NULL, hvals, free_rec);
+}
+
+
+csc_hash_t *csc_hash_newIntrusive(int offset, int linkOffset, int (*cmp)(void*,void*),
+                        csc_ulong (*hval)(void*), void (*free_rec)(void*) )
+/*  As csc_hash_new(), but each record has a csc_hash_link_t at position
+ * 'linkOffset', which the table uses instead of allocating a node.
+ */ 
+{   assert(hval!=NULL && linkOffset>=0);
+    return csc_hash_create(offset, linkOffset, cmp, hval, NULL, free_rec);
+}
+
+
+/* Moves chain 'ndx' of the old table to the new.  The chain is reversed
+ * first so that records with equal keys stay in LIFO order.
+ */
+static void csc_hash_moveChain(csc_hash_t *h, csc_ulong ndx)
+{   csc_hash_node_t *pt, *next, *rev;
+    csc_ulong newNdx;
+ 
+    rev = NULL;
+    for (pt=h->oldTable[ndx]; pt!=NULL; pt=next)
+    {   next = pt->next;
+        pt->next = rev;
+        rev = pt;
+    }
+    h->oldTable[ndx] = NULL;
+    for (pt=rev; pt!=NULL; pt=next)
+    {   next = pt->next;
+        newNdx = pt->hash_val & (h->tblsize-1);
+        pt->next = h->table[newNdx];
+        h->table[newNdx] = pt;
+    }
+}
+
+
+/* Moves up to 'nChains' chains from the old table to the new. */
+static void csc_hash_rehashStep(csc_hash_t *h, csc_ulong nChains)
+{   csc_ulong nEmpty = nChains * 10;
  
-/* Allocate new table (already zeroed) - on failure give up. */
-    old_tblsize = h->tblsize;
-    new_tblsize = h->maxcount * 2;
-    new_table = (csc_hash_node_t**) csc_ck_calloc(new_tblsize * sizeof(csc_hash_node_t*));
-    if (new_table == 0)
-        return;
+    while (h->oldTable!=NULL && nChains>0)
+    {   if (h->oldTable[h->rehashNdx] == NULL)
+        {   if (--nEmpty == 0)
+                return;
+        }
+        else
+        {   csc_hash_moveChain(h, h->rehashNdx);
+            nChains--;
+        }
  
-/* Transfer all nodes from old table to new. */
-    for (i_table=0; i_table<old_tblsize; i_table++)
-    {   pt = h->table[i_table];
-        while (pt != 0)
-        {   next = pt->next;
-            ndx = pt->hash_val % new_tblsize;
-            pt->next = new_table[ndx];
-            new_table[ndx] = pt;
-            pt = next;
+/* Free the old table once it is empty. */
+        if (++h->rehashNdx == h->oldTblsize)
+        {   free(h->oldTable);
+            h->oldTable = NULL;
+            h->oldTblsize = 0;
+            h->rehashNdx = 0;
         }
     }
+}
+
+
+static void csc_hash_resize(csc_hash_t *h, csc_ulong new_tblsize)
+{ 
+/* Only one rehash at a time, so finish any that is in progress. */
+    while (h->oldTable != NULL)
+        csc_hash_rehashStep(h, h->oldTblsize);
  
-/* Free old, Assign new. */
-    free(h->table);
-    h->table = new_table;
-    h->tblsize = new_tblsize;
-    h->maxcount = 5 * h->tblsize;
+/* Start moving nodes to a new table. */
+    h->oldTable = h->table;
+    h->oldTblsize = h->tblsize;
+    h->rehashNdx = 0;
+    tableSetSize(h, new_tblsize);
+    h->nResizes++;
 }
 
 
-void csc_hash_add(csc_hash_t *h, void *rec)
-/*  This function will add 'rec' to 'h' regardless of whether 
- * there are matching keys.
- */ 
+/* Called before an add or removal. */
+static void csc_hash_beforeChange(csc_hash_t *h, csc_bool_t isAdd)
+{   if (isAdd)
+        h->isIterPaused = csc_FALSE;
+    if (!h->isIterPaused)
+    {   if (h->oldTable != NULL)
+            csc_hash_rehashStep(h, RehashStep);
+        else if (isAdd && h->count >= h->maxcount)
+            csc_hash_resize(h, csc_hash_sizeFor(h, h->count));
+        else if (!isAdd && h->count < h->mincount)
+            csc_hash_resize(h, csc_hash_shrinkSize(h));
+    }
+}
+
+
+/* Returns the link to the first node in the chain at 'ppt' with key
+ * 'key', or NULL.
+ */
+static csc_hash_node_t **csc_hash_findIn(csc_hash_t *h, csc_hash_node_t **ppt,
+                                         void *key, csc_ulong hash_val)
+{   int offset = h->offset;
+    int (*cmp)(void*,void*) = h->cmp;
+    csc_ulong nProbes = 0;
+    csc_ulong nCompares = 0;
+ 
+    for ( ; *ppt!=NULL; ppt=&(*ppt)->next)
+    {   nProbes++;
+        if ((*ppt)->hash_val == hash_val)
+        {   nCompares++;
+            if (cmp(((char*)(*ppt)->data)+offset, key) == 0)
+                break;
+        }
+    }
+    if (h->isCounting)
+    {   h->nProbes += nProbes;
+        h->nCompares += nCompares;
+    }
+    return *ppt!=NULL ? ppt : NULL;
+}
+
+
+/* Returns the link to the first node with key 'key', or NULL. */
+static csc_hash_node_t **csc_hash_find(csc_hash_t *h, void *key, csc_ulong hash_val)
+{   csc_hash_node_t **ppt;
+    csc_ulong ndx;
+ 
+    if (h->isCounting)
+        h->nLookups++;
+ 
+/* Newer records are in the new table. */
+    ppt = csc_hash_findIn(h, &h->table[hash_val & (h->tblsize-1)], key, hash_val);
+    if (ppt != NULL)
+        return ppt;
+ 
+/* Then try the old table, if its chain has not yet moved. */
+    if (h->oldTable != NULL)
+    {   ndx = hash_val & (h->oldTblsize-1);
+        if (ndx >= h->rehashNdx)
+            return csc_hash_findIn(h, &h->oldTable[ndx], key, hash_val);
+    }
+    return NULL;
+}
+
+
+static void csc_hash_insert(csc_hash_t *h, void *rec, csc_ulong hash_val)
 {   csc_ulong ndx;
-    csc_ulong hash_val;
     csc_hash_node_t *pt;
-    
-    hash_val = h->hval((void*)((char*)rec+h->offset));
-    ndx = hash_val % h->tblsize;
-    pt = csc_allocOne(csc_hash_node_t);
+ 
+/* Any older records with the same key must be moved first, so that
+ * those with equal keys are always together in one table.
+ */
+    if (h->oldTable != NULL)
+    {   ndx = hash_val & (h->oldTblsize-1);
+        if (ndx >= h->rehashNdx)
+            csc_hash_moveChain(h, ndx);
+    }
+ 
+    ndx = hash_val & (h->tblsize-1);
+    if (h->linkOffset >= 0)
+        pt = (csc_hash_node_t*)((char*)rec + h->linkOffset);
+    else
+        pt = csc_allocOne(csc_hash_node_t);
     pt->next = h->table[ndx];
     pt->data = rec;
     pt->hash_val = hash_val;
     h->table[ndx] = pt;
- 
-    if (h->count++ == h->maxcount)
-        csc_hash_resize(h);
+    h->count++;
+}
+
+
+void csc_hash_add(csc_hash_t *h, void *rec)
+/*  This function will add 'rec' to 'h' regardless of whether 
+ * there are matching keys.
+ */ 
+{   csc_hash_beforeChange(h, csc_TRUE);
+    csc_hash_insert(h, rec, csc_hash_keyVal(h, (void*)((char*)rec+h->offset)));
 }
 
 
@@ -138,29 +414,13 @@ int csc_hash_addex(csc_hash_t *h, void *rec)
  * function will return csc_FALSE.  Otherwise it will add 'rec' to 'hash' 
  * and return csc_TRUE.
  */
-{   csc_ulong ndx;
-    csc_ulong hash_val;
-    csc_hash_node_t *pt, **headp;
-    int (*cmp)(void*,void*) = h->cmp;
-    int offset = h->offset;
-    void *key = (char*)rec + offset;
+{   csc_ulong hash_val;
+    void *key = (char*)rec + h->offset;
  
-    hash_val = h->hval(key);
-    ndx = hash_val % h->tblsize;
-    headp = &h->table[ndx];
-    for (pt=*headp; pt!=NULL; pt=pt->next)
-    {   if (pt->hash_val==hash_val && cmp(((char*)pt->data)+offset, key)==0)
-            break;
-    }
-    if (pt == NULL)
-    {   pt = csc_allocOne(csc_hash_node_t);
-        pt->next = h->table[ndx];
-        pt->data = rec;
-        pt->hash_val = hash_val;
-        h->table[ndx] = pt;
- 
-        if (h->count++ == h->maxcount)
-            csc_hash_resize(h);
+    csc_hash_beforeChange(h, csc_TRUE);
+    hash_val = csc_hash_keyVal(h, key);
+    if (csc_hash_find(h, key, hash_val) == NULL)
+    {   csc_hash_insert(h, rec, hash_val);
         return csc_TRUE;
     }
     else
@@ -171,24 +431,15 @@ int csc_hash_addex(csc_hash_t *h, void *rec)
 void *csc_hash_get(csc_hash_t *h, void *key)
 /*  If no record with a key of 'key' exists in 'h', this function will
  * return NULL.  Otherwise it will return a pointer to any record
- * with a key of 'key' (LIFO).
+ * with a key of 'key' (LIFO).  This does not change the table.
  */ 
-{   csc_ulong ndx;
-    csc_ulong hash_val;
-    csc_hash_node_t *pt;
-    int offset = h->offset;
-    int (*cmp)(void*,void*) = h->cmp;
+{   csc_hash_node_t **ppt;
  
-    hash_val = h->hval(key);
-    ndx = hash_val % h->tblsize;
-    for (pt=h->table[ndx]; pt!=NULL; pt=pt->next)
-    {   if (pt->hash_val==hash_val && cmp(((char*)pt->data)+offset, key)==0)
-            break;
-    }
-    if (pt == NULL)
+    ppt = csc_hash_find(h, key, csc_hash_keyVal(h, key));
+    if (ppt == NULL)
         return NULL;
     else
-        return pt->data;
+        return (*ppt)->data;
 }
 
 
@@ -199,26 +450,18 @@ void *csc_hash_out(csc_hash_t *h, void *key)
  * but it does not free it.
  */   
 {   csc_hash_node_t *pt, **ppt;
-    csc_ulong ndx;
-    csc_ulong hash_val;
     void *rec;
-    int offset = h->offset;
-    int (*cmp)(void*,void*) = h->cmp;
  
-    hash_val = h->hval(key);
-    ndx = hash_val % h->tblsize;
-    ppt = &h->table[ndx];
-    for (pt=*ppt; pt!=NULL; pt=pt->next)
-    {   if (pt->hash_val==hash_val && cmp(((char*)pt->data)+offset, key)==0)
-            break;
-        ppt = &pt->next;
-    }
-    if (pt == NULL)
+    csc_hash_beforeChange(h, csc_FALSE);
+    ppt = csc_hash_find(h, key, csc_hash_keyVal(h, key));
+    if (ppt == NULL)
         return NULL;
     else
-    {   rec = pt->data;
+    {   pt = *ppt;
+        rec = pt->data;
         *ppt = pt->next;
-        free(pt);
+        if (h->linkOffset < 0)
+            free(pt);
         h->count--;
         return rec;
     }
@@ -236,57 +479,268 @@ int csc_hash_del(csc_hash_t *h, void *key)
         return csc_FALSE;
     else
     {   h->free_rec(p);
-        h->count--;
         return csc_TRUE;
     }
 }
 
 
-void csc_hash_free(csc_hash_t *h)
-/*  This function will free any records remaining in 'h' and free the 
- * space associated with the table.
+/* Makes the table large enough for 'count' records without growing, at
+ * the load that growing would give it, and finishes the rehash now rather
+ * than spreading it over later calls.
+ */
+static void csc_hash_grow(csc_hash_t *h, csc_ulong count)
+{   csc_ulong tblsize = csc_hash_sizeFor(h, count);
+    if (tblsize > h->tblsize)
+        csc_hash_resize(h, tblsize);
+    while (h->oldTable != NULL)
+        csc_hash_rehashStep(h, h->oldTblsize);
+}
+
+
+void csc_hash_reserve(csc_hash_t *h, csc_ulong count)
+/*  Makes 'h' large enough for 'count' records, and stops it from
+ * shrinking below that.
+ */
+{   csc_hash_grow(h, count);
+    h->minTblsize = h->tblsize;
+    tableSetLimits(h);
+}
+
+
+csc_hash_t *csc_hash_newSized(int offset, int (*cmp)(void*,void*),
+                        csc_ulong (*hval)(void*), void (*free_rec)(void*),
+                        csc_ulong expectedCount )
+/*  As csc_hash_new(), but the table starts large enough for
+ * 'expectedCount' records.
  */ 
+{   csc_hash_t *h = csc_hash_new(offset, cmp, hval, free_rec);
+    csc_hash_reserve(h, expectedCount);
+    return h;
+}
+
+
+void csc_hash_addBulk(csc_hash_t *h, void **recs, csc_ulong nRecs)
+/*  Adds the 'nRecs' records in 'recs' to 'h', as csc_hash_add().
+ */
+{   int offset = h->offset;
+    h->isIterPaused = csc_FALSE;
+    csc_hash_grow(h, h->count + nRecs);
+    for (csc_ulong i=0; i<nRecs; i++)
+        csc_hash_insert(h, recs[i], csc_hash_keyVal(h, (char*)recs[i]+offset));
+}
+
+
+int csc_hash_setMaxLoad(csc_hash_t *h, double maxLoad)
+/*  Sets the load factor at which 'h' grows.
+ */
+{   if (maxLoad <= 0)
+        return csc_FALSE;
+    h->maxLoad = maxLoad;
+    tableSetLimits(h);
+    return csc_TRUE;
+}
+
+
+static void csc_hash_freeTable(csc_hash_t *h, csc_hash_node_t **table, csc_ulong size)
 {   csc_ulong i;
     csc_hash_node_t *pt, *next;
-    csc_ulong size = h->tblsize;
-    csc_hash_node_t **table = h->table;
-    void (*free_rec)(void*) = h->free_rec;
  
     for (i=0; i<size; i++)
     {   pt = table[i];
         while (pt != 0)
         {   next = pt->next;
-            free_rec(pt->data);
-            free(pt);
+            h->free_rec(pt->data);
+            if (h->linkOffset < 0)
+                free(pt);
             pt = next;
         }
         table[i] = 0;
     }
     free(table);
+}
+
+
+void csc_hash_free(csc_hash_t *h)
+/*  This function will free any records remaining in 'h' and free the 
+ * space associated with the table.
+ */ 
+{   csc_hash_freeTable(h, h->table, h->tblsize);
+    if (h->oldTable != NULL)
+        csc_hash_freeTable(h, h->oldTable, h->oldTblsize);
     free(h);
 }
 
 
+static void csc_hash_statChains(csc_hash_stats_t *st, csc_hash_node_t **table,
+                                csc_ulong from, csc_ulong to)
+{   csc_hash_node_t *pt;
+    csc_ulong len;
+ 
+    for (csc_ulong i=from; i<to; i++)
+    {   len = 0;
+        for (pt=table[i]; pt!=NULL; pt=pt->next)
+            len++;
+        st->chainHist[len<csc_hash_HistLen ? len : csc_hash_HistLen-1]++;
+        if (len > st->maxChain)
+            st->maxChain = len;
+    }
+}
+
+
+void csc_hash_getStats(csc_hash_t *h, csc_hash_stats_t *st)
+/*  Fills in 'st' with statistics on 'h'.  This visits every chain.
+ */
+{   memset(st, 0, sizeof(*st));
+    st->count = h->count;
+    st->tblsize = h->tblsize;
+    st->loadFactor = (double)h->count / h->tblsize;
+    st->nResizes = h->nResizes;
+    st->isRehashing = h->oldTable != NULL;
+    csc_hash_statChains(st, h->table, 0, h->tblsize);
+    if (h->oldTable != NULL)
+        csc_hash_statChains(st, h->oldTable, h->rehashNdx, h->oldTblsize);
+    st->nLookups = h->nLookups;
+    st->nProbes = h->nProbes;
+    st->nCompares = h->nCompares;
+}
+
+
+void csc_hash_setCounting(csc_hash_t *h, csc_bool_t isOn)
+/*  Turns the lookup counters on or off, and zeroes them.
+ */
+{   h->isCounting = isOn;
+    h->nLookups = 0;
+    h->nProbes = 0;
+    h->nCompares = 0;
+}
+
+
+void csc_hash_printStats(csc_hash_t *h, FILE *fout)
+/*  Prints the statistics on 'h' to 'fout'.
+ */
+{   csc_hash_stats_t st;
+    csc_hash_getStats(h, &st);
+    fprintf( fout, "count=%lu tblsize=%lu load=%.2f maxChain=%lu resizes=%lu%s\n"
+           , st.count, st.tblsize, st.loadFactor, st.maxChain, st.nResizes
+           , st.isRehashing ? " (rehashing)" : "");
+    fprintf(fout, "chains:");
+    for (int i=0; i<csc_hash_HistLen; i++)
+        fprintf(fout, " %s%d=%lu", i==csc_hash_HistLen-1?">=":"", i, st.chainHist[i]);
+    fprintf(fout, "\n");
+    if (h->isCounting && st.nLookups>0)
+    {   fprintf( fout, "lookups=%lu probes/lookup=%.2f compares/lookup=%.2f\n"
+               , st.nLookups
+               , (double)st.nProbes/st.nLookups
+               , (double)st.nCompares/st.nLookups);
+    }
+}
+
+
+static inline uint64_t hashMum(uint64_t a, uint64_t b)
+/*  Multiplies and folds the two halves of the product together.
+ */
+{
+#ifdef __SIZEOF_INT128__
+    __uint128_t r = (__uint128_t)a * b;
+    return (uint64_t)r ^ (uint64_t)(r >> 64);
+#else
+    uint64_t r = a * b;
+    return r ^ (r >> 32) ^ ((a ^ b) >> 29);
+#endif
+}
+
+
+static inline uint64_t hashRead64(const uint8_t *p)
+{   uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+
+static inline uint64_t hashRead32(const uint8_t *p)
+{   uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+
+csc_ulong csc_hash_bytesSeed(const void *buf, size_t len, csc_ulong seed)
+/*  Hashes 'len' bytes at 'buf', 16 at a time.  The running hash, which
+ * depends on the seed, goes into both sides of every multiply, so no
+ * input that an attacker can choose without knowing the seed makes a
+ * side zero and loses the seed.
+ */
+{   const uint8_t *p = buf;
+    uint64_t h = (uint64_t)seed ^ hashMum((uint64_t)seed ^ K0, K1);
+    uint64_t a, b;
+    size_t n = len;
+ 
+    while (n > 16)
+    {   h = hashMum(hashRead64(p) ^ K1 ^ h, hashRead64(p+8) ^ K2 ^ h);
+        p += 16;
+        n -= 16;
+    }
+ 
+/* The last 1 to 16 bytes, read as two words that may overlap. */
+    if (n >= 8)
+    {   a = hashRead64(p);
+        b = hashRead64(p+n-8);
+    }
+    else if (n >= 4)
+    {   a = hashRead32(p);
+        b = hashRead32(p+n-4);
+    }
+    else if (n > 0)
+    {   a = ((uint64_t)p[0] << 16) | ((uint64_t)p[n>>1] << 8) | p[n-1];
+        b = 0;
+    }
+    else
+        a = b = 0;
+ 
+    return (csc_ulong)hashMum(K1 ^ len, hashMum(a ^ K1 ^ h, b ^ K2 ^ h));
+}
+
+
+csc_ulong csc_hash_strSeed(void *str, csc_ulong seed)
+{   return csc_hash_bytesSeed(str, strlen(str), seed);
+}
+
+
+csc_ulong csc_hash_StrPtSeed(void *pt, csc_ulong seed)
+{   char *str = *(char**)pt;
+    return csc_hash_bytesSeed(str, strlen(str), seed);
+}
+
+
+csc_ulong csc_hash_intSeed(csc_ulong val, csc_ulong seed)
+{   return (csc_ulong)hashMum(hashMum((uint64_t)val ^ K0 ^ seed, (uint64_t)seed ^ K1), K2);
+}
+
+
+csc_ulong csc_hash_ptrSeed(void *pt, csc_ulong seed)
+{   return csc_hash_intSeed((csc_ulong)(uintptr_t)pt, seed);
+}
+
+
 csc_ulong csc_hash_str(void *arg)
 /*  Creates a hash index from a null terminated string.  (case sensitive).
  */
-{   
-    char *str = arg;
-    csc_ulong sum;
-    int ch;
- 
-    sum=1;
-    while ((ch=*str++) != '\0')
-        sum = (sum+ch+ADD)*MUL;
-    return sum;
+{   return csc_hash_bytesSeed(arg, strlen(arg), 0);
 }
 
 
+/* The iterators pause rehashing until they finish, or until something is
+ * added, so that removing the current record does not move chains
+ * beneath them.  The old table chains are visited after the new.
+ */
+
 void csc_hash_key_init(csc_hash_t *h, csc_hash_iter_t *i, void *key)
 {  
-    i->hash_val = h->hval(key);
-    i->pt = h->table[ i->hash_val % h->tblsize ];
+    i->hash_val = csc_hash_keyVal(h, key);
+    i->pt = h->table[ i->hash_val & (h->tblsize-1) ];
     i->key = key;
+    i->ilst = 0;
+    h->isIterPaused = csc_TRUE;
 }
 
 void *csc_hash_key_next(csc_hash_t *h, csc_hash_iter_t *i)
@@ -295,43 +749,60 @@ void *csc_hash_key_next(csc_hash_t *h, csc_hash_iter_t *i)
     int offset = h->offset;
     void *key = i->key;
     unsigned long hash_val = i->hash_val;
+    csc_ulong ndx;
+ 
+    for (;;)
+    {   for (pt=i->pt; pt!=NULL; pt=pt->next)
+        {   if (pt->hash_val==hash_val && cmp(((char*)pt->data)+offset, key)==0)
+                break;
+        }
+        if (pt != NULL)
+        {   i->pt = pt->next;
+            return pt->data;
+        }
  
-    for (pt=i->pt; pt!=NULL; pt=pt->next)
-    {   if (pt->hash_val==hash_val && cmp(((char*)pt->data)+offset, key)==0)
+/* Go on to the old table chain, if any. */
+        i->pt = NULL;
+        if (i->ilst!=0 || h->oldTable==NULL)
             break;
+        i->ilst = 1;
+        ndx = hash_val & (h->oldTblsize-1);
+        if (ndx >= h->rehashNdx)
+            i->pt = h->oldTable[ndx];
     }
-    if (pt == NULL)
-    {   i->pt = NULL;
-        return NULL;
-    }
-    else
-    {   i->pt = pt->next;
-        return pt->data;
-    }
+    h->isIterPaused = csc_FALSE;
+    return NULL;
 }
 
 void csc_hash_all_init(csc_hash_t *h, csc_hash_iter_t *i)
 {   i->ilst = 0;
     i->pt = NULL;
+    h->isIterPaused = csc_TRUE;
 }
 
 void *csc_hash_all_next(csc_hash_t *h, csc_hash_iter_t *i)
-{   int ilst;
-    int nlst;
-    csc_hash_node_t **table;
+{   csc_ulong ilst;
+    csc_ulong nlst;
     csc_hash_node_t *pt = i->pt;
  
+/* Chains are numbered through the new table and then the old. */
     if (pt == NULL)
     {   ilst = i->ilst;
-        nlst = h->tblsize;
-        table = h->table;
-        while (ilst<nlst && table[ilst]==NULL)
+        nlst = h->tblsize + h->oldTblsize;
+        while (ilst < nlst)
+        {   if (ilst < h->tblsize)
+                pt = h->table[ilst];
+            else
+                pt = h->oldTable[ilst - h->tblsize];
+            if (pt != NULL)
+                break;
             ilst++;
+        }
         i->ilst = ilst;
         if (ilst == nlst)
+        {   h->isIterPaused = csc_FALSE;
             return NULL;
-        else
-            pt = table[ilst];
+        }
     }
  
     i->pt = pt->next;
@@ -341,6 +812,11 @@ void *csc_hash_all_next(csc_hash_t *h, csc_hash_iter_t *i)
 }
 
 
+void csc_hash_iterStop(csc_hash_t *h)
+{   h->isIterPaused = csc_FALSE;
+}
+
+
 csc_ulong csc_hash_StrPt(void *pt)
 {   return csc_hash_str(*(char**)pt);
 }
@@ -354,17 +830,7 @@ int csc_hash_StrPtCmpr(void *pt1, void *pt2)
 csc_ulong csc_hash_ptr(void *pt)
 /*  Creates a hash index from a pointer.
  */
-{   csc_ulong pt_val = (csc_ulong)pt;
-    int n_bytes = sizeof(csc_ulong);
-    csc_ulong hind = 0;
-    int i;
- 
-    for (i=0; i<n_bytes; i++)
-    {   hind = hind * MUL + ADD + ((csc_ulong)255 & pt_val);
-        pt_val >>= 8;  /* Shift right 1 byte. */
-    }
- 
-    return hind;
+{   return csc_hash_intSeed((csc_ulong)(uintptr_t)pt, 0);
 }
 
 
@@ -378,8 +844,8 @@ int csc_hash_PtrCmpr(void *pt1, void *pt2)
 #pragma argsused
 void csc_hash_FreeNothing(void *blk)
 {}
-
-
+ 
+ 
 void csc_hash_FreeBlk(void *blk)
 {   free(blk);
 }
@@ -8,6 +8,13 @@
 typedef struct csc_hash_t csc_hash_t;
 typedef struct csc_hash_node_t csc_hash_node_t;
 
+/* For records in intrusive tables.  Innards are private! */
+typedef struct csc_hash_node_t
+{   struct csc_hash_node_t *next;
+    void *data;
+    unsigned long hash_val;
+} csc_hash_link_t;
+
 typedef struct
 {
 /* Innards are private! */
@@ -25,11 +32,76 @@ csc_hash_t *csc_hash_new(int offset, int (*cmp)(void*,void*),
  * position 'offset' from the beginning of the record.  The function
  * 'cmp'() must be able to compare two keys and return zero if they
  * compare equal, non zero otherwise.  The function 'hval'() will
- * generate a hash value from a key.  The value returned from 'hval'()
- * will be subsequently subjected to MOD (whatever is the tablesize). 
- * The function 'free_rec'() is able to dispose of a record.
+ * generate a hash value from a key.  The table size is a power of two,
+ * and the low bits of the value returned from 'hval'() select the chain,
+ * so they should depend on all of the key.  The function 'free_rec'() is
+ * able to dispose of a record.
+ *
+ *  The table grows when the average chain length reaches 5, and shrinks
+ * when there are fewer records than 1/16 of the chains.  Rehashing is
+ * incremental: a few chains are moved to the new table on each add or
+ * removal, so that no single call pauses to move every record.
+ * csc_hash_get() never changes the table.
  */ 
 
+csc_hash_t *csc_hash_newSeeded(int offset, int (*cmp)(void*,void*),
+                unsigned long (*hvals)(void*,unsigned long), void (*free_rec)(void*) );
+/*  As csc_hash_new(), except that each table gets a random seed, which is
+ * passed to 'hvals'() along with the key.  Use this with the seeded hash
+ * functions below when keys may come from an attacker, who could
+ * otherwise choose keys that all fall in one chain.  e.g:-
+ *
+ *      csc_hash_newSeeded(offsetof(rec_t,name), csc_hash_StrPtCmpr,
+ *                         csc_hash_StrPtSeed, freeRec);
+ */
+
+csc_hash_t *csc_hash_newIntrusive(int offset, int linkOffset, int (*cmp)(void*,void*),
+                unsigned long (*hval)(void*), void (*free_rec)(void*) );
+/*  As csc_hash_new(), except that each record has a csc_hash_link_t at
+ * position 'linkOffset', which the table uses to chain the record.  No
+ * memory is then allocated or freed as records are added and removed,
+ * and a lookup reads each record without first reading a separate node.
+ * A record may be in only one intrusive table for each link it has.
+ * e.g:-
+ *
+ *      typedef struct
+ *      {   char *name;
+ *          csc_hash_link_t link;
+ *      } rec_t;
+ *
+ *      csc_hash_newIntrusive(offsetof(rec_t,name), offsetof(rec_t,link),
+ *                            csc_hash_StrPtCmpr, csc_hash_StrPt, freeRec);
+ */
+
+csc_hash_t *csc_hash_newSized(int offset, int (*cmp)(void*,void*),
+                unsigned long (*hval)(void*), void (*free_rec)(void*),
+                unsigned long expectedCount );
+/*  As csc_hash_new(), except that the table starts large enough to hold
+ * 'expectedCount' records without growing.  This is csc_hash_new()
+ * followed by csc_hash_reserve().
+ */
+
+void csc_hash_reserve(csc_hash_t *hash, unsigned long count);
+/*  Makes 'hash' large enough to hold 'count' records without growing,
+ * moving the existing records at once rather than incrementally.  The
+ * table will not then shrink below this size.
+ */
+
+void csc_hash_addBulk(csc_hash_t *hash, void **recs, unsigned long nRecs);
+/*  Adds the 'nRecs' records in the array 'recs' to 'hash' regardless of
+ * whether there are matching keys, as csc_hash_add().  The table is sized
+ * once for all of them, and they are then linked into their chains in a
+ * single pass with no further checks for growth.
+ */
+
+int csc_hash_setMaxLoad(csc_hash_t *hash, double maxLoad);
+/*  Sets the load factor (records per chain) at which 'hash' grows.  When
+ * it grows it goes to half this load, or to a half if that is less.  The
+ * default is 5, which saves memory.  A value below 1 gives shorter chains
+ * and faster lookups at the cost of more memory.  Returns csc_FALSE if
+ * 'maxLoad' is not positive.
+ */
+
 int csc_hash_addex(csc_hash_t *hash, void *rec);
 /*  If a key matching 'rec' already exists in 'hash' then this 
  * function will return csc_FALSE.  Otherwise it will add 'rec' to 'hash' 
@@ -66,6 +138,49 @@ void csc_hash_free(csc_hash_t *hash);
  */ 
 
 
+#define csc_hash_HistLen 8
+
+typedef struct
+{   unsigned long count;        /* Number of records. */
+    unsigned long tblsize;      /* Number of chains. */
+    double loadFactor;          /* count / tblsize. */
+    unsigned long chainHist[csc_hash_HistLen];
+                                /* chainHist[n] is the number of chains of
+                                 * length n, and the last element counts
+                                 * all the longer chains too. */
+    unsigned long maxChain;     /* Length of the longest chain. */
+    unsigned long nResizes;     /* Times the table has grown or shrunk. */
+    int isRehashing;            /* A rehash is in progress. */
+    unsigned long nLookups;     /* Lookups by get, addex and out. */
+    unsigned long nProbes;      /* Nodes visited by those lookups. */
+    unsigned long nCompares;    /* Calls to 'cmp'() by those lookups. */
+} csc_hash_stats_t;
+
+void csc_hash_getStats(csc_hash_t *hash, csc_hash_stats_t *stats);
+/*  Fills in 'stats' for 'hash'.  This visits every chain, so it takes
+ * time in proportion to the size of the table.  Long chains with a low
+ * load factor, or many compares per lookup, point to a poor hash
+ * function or to many records with equal keys.
+ */
+
+void csc_hash_setCounting(csc_hash_t *hash, csc_bool_t isOn);
+/*  Turns the lookup, probe and compare counters on or off, and zeroes
+ * them.  They are off by default.  While they are on, csc_hash_get()
+ * writes to the table.
+ */
+
+void csc_hash_printStats(csc_hash_t *hash, FILE *fout);
+/*  Prints the statistics for 'hash' to 'fout' in a few lines of text.
+ */
+
+
+
+/*  While an iteration is in progress, rehashing is paused so that the
+ * current record may be removed.  It resumes when an iteration finishes
+ * or when a record is added.  A loop that is left early, by break or
+ * return, leaves rehashing paused, so removals neither move chains nor
+ * shrink the table.  Call csc_hash_iterStop() after leaving it.
+ */
 
 #define for_hash_key(h,i,key,dat,dat_type) \
     for (csc_hash_key_init(h,&i,key); ((dat)=(dat_type)csc_hash_key_next(h,&i))!=NULL; )
@@ -77,14 +192,45 @@ void csc_hash_key_init(csc_hash_t *h, csc_hash_iter_t *i, void *key);
 void *csc_hash_key_next(csc_hash_t *h, csc_hash_iter_t *i);
 void csc_hash_all_init(csc_hash_t *h, csc_hash_iter_t *i);
 void *csc_hash_all_next(csc_hash_t *h, csc_hash_iter_t *i);
+void csc_hash_iterStop(csc_hash_t *h);
+
+
+#define csc_hash_BytesSeedId 2
+/*  Changes whenever csc_hash_bytesSeed() is changed to give different
+ * values, so that hash values kept in files can be checked.
+ */
 
+unsigned long csc_hash_bytesSeed(const void *buf, size_t len, unsigned long seed);
+/*  Creates a hash value from 'len' bytes at 'buf' and the seed 'seed'.
+ * This reads 16 bytes at a time, and is the basis of the other hash
+ * functions.  Use it in an 'hvals'() for keys that are not strings.
+ */
+
+unsigned long csc_hash_strSeed(void *str, unsigned long seed);
+/*  Creates a hash value from a null terminated string and a seed.
+ */
+
+unsigned long csc_hash_StrPtSeed(void *pt, unsigned long seed);
+/*  As csc_hash_StrPt(), but with a seed.
+ */
+
+unsigned long csc_hash_intSeed(unsigned long val, unsigned long seed);
+/*  Mixes an integer with a seed, so that every bit of the hash value
+ * depends on every bit of both.
+ */
+
+unsigned long csc_hash_ptrSeed(void *pt, unsigned long seed);
+/*  Creates a hash value from a pointer and a seed.
+ */
 
 unsigned long csc_hash_str(void *str);
 /*  Creates a hash index from a null terminated string.  (case sensitive).
+ * This is csc_hash_strSeed() with a seed of zero.
  */
 
 unsigned long csc_hash_ptr(void *pt);
 /*  Creates a hash index from a pointer and returns it.
+ * This is csc_hash_ptrSeed() with a seed of zero.
  */
 
 int csc_hash_PtrCmpr(void *pt1, void *pt2);
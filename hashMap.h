@@ -0,0 +1,211 @@
+// Author: Dr Stephen Braithwaite.
+// This work is licensed under a Creative Commons Attribution-ShareAlike 4.0 International License.
+
+#ifndef csc_HASHMAP_H
+#define csc_HASHMAP_H 1
+
+#include <stdlib.h>
+#include "std.h"
+#include "alloc.h"
+
+// -------------------------------------------------------------------
+// The following generates a hash map from 'keyType' to 'valType' with
+// the keys and values held in the table itself.  'hashFn'(key) must
+// return an unsigned long hash value whose low bits depend on all of
+// the key, e.g. csc_hashMap_mixInt() below or csc_hash_str().  'eqFn'(a,b)
+// must return non zero if two keys are equal.  Both may be macros, and
+// are expanded inline, so there are no calls through function pointers.
+//
+// csc_hashMap_headers(name, ...) declares name_t and its functions, and
+// csc_hashMap_code(name, ...) defines them, e.g:-
+//
+//      #define intEq(a,b) ((a)==(b))
+//      csc_hashMap_headers(idMap, int, conn_t*, csc_hashMap_mixInt, intEq)
+//      csc_hashMap_code(idMap, int, conn_t*, csc_hashMap_mixInt, intEq)
+//
+// name_new() and name_free() construct and destroy a map.  The map does
+// not own what the keys or values point to.
+//
+// name_put() adds 'key' with 'val', or replaces the value if 'key' is
+// already present.  Returns csc_TRUE if the key was new.
+//
+// name_get() returns a pointer to the value for 'key', or NULL.  The
+// pointer is valid until the next name_put().
+//
+// name_del() removes 'key'.  Returns csc_FALSE if it was not present.
+//
+// name_next() iterates over the map.  Set '*iter' to zero, then each call
+// gives the next key and value, until it returns csc_FALSE.  'key' or
+// 'val' may be NULL.  The map must not be changed during an iteration.
+//
+// The table is open addressed with linear probing.  Each slot has a
+// control byte holding 7 bits of the hash value, so most slots that do
+// not hold the key are passed over without calling 'eqFn'.
+// -------------------------------------------------------------------
+
+#define csc_hashMap_InitSize 16
+#define csc_hashMap_Empty ((csc_uchar)0)
+#define csc_hashMap_Deleted ((csc_uchar)1)
+#define csc_hashMap_tag(hv) ((csc_uchar)(0x80 | ((hv) >> (sizeof(csc_ulong)*8-7))))
+
+// Hash value for integer and pointer keys.  This is the finaliser from
+// MurmurHash3.
+static inline csc_ulong csc_hashMap_mixInt(csc_ulong x)
+{   uint64_t h = x;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return (csc_ulong)h;
+}
+
+#define csc_hashMap_headers(name, keyType, valType, hashFn, eqFn)              \
+                                                                               \
+typedef struct                                                                 \
+{   csc_uchar *ctrl;                                                           \
+    keyType *keys;                                                             \
+    valType *vals;                                                             \
+    csc_ulong mask;                                                            \
+    csc_ulong count;                                                           \
+    csc_ulong nDeleted;                                                        \
+} name ## _t;                                                                  \
+                                                                               \
+name ## _t *name ## _new(void);                                                \
+void name ## _free(name ## _t *map);                                           \
+csc_bool_t name ## _put(name ## _t *map, keyType key, valType val);            \
+valType *name ## _get(name ## _t *map, keyType key);                           \
+csc_bool_t name ## _del(name ## _t *map, keyType key);                         \
+csc_ulong name ## _count(name ## _t *map);                                     \
+csc_bool_t name ## _next( name ## _t *map, csc_ulong *iter                     \
+                        , keyType *key, valType *val);                         \
+                                                                               \
+
+
+
+#define csc_hashMap_code(name, keyType, valType, hashFn, eqFn)                 \
+                                                                               \
+name ## _t *name ## _new(void)                                                 \
+{   name ## _t *map = csc_allocOne(name ## _t);                                \
+    map->mask = csc_hashMap_InitSize - 1;                                      \
+    map->count = 0;                                                            \
+    map->nDeleted = 0;                                                         \
+    map->ctrl = csc_ck_calloc(csc_hashMap_InitSize);                           \
+    map->keys = csc_allocMany(keyType, csc_hashMap_InitSize);                  \
+    map->vals = csc_allocMany(valType, csc_hashMap_InitSize);                  \
+    return map;                                                                \
+}                                                                              \
+                                                                               \
+void name ## _free(name ## _t *map)                                            \
+{   free(map->ctrl);                                                           \
+    free(map->keys);                                                           \
+    free(map->vals);                                                           \
+    free(map);                                                                 \
+}                                                                              \
+                                                                               \
+static long name ## _find(name ## _t *map, keyType key, csc_ulong hv)          \
+{   csc_ulong slot = hv & map->mask;                                           \
+    csc_uchar tag = csc_hashMap_tag(hv);                                       \
+    csc_uchar c;                                                               \
+    while ((c = map->ctrl[slot]) != csc_hashMap_Empty)                         \
+    {   if (c == tag && eqFn(map->keys[slot], key))                            \
+            return (long)slot;                                                 \
+        slot = (slot+1) & map->mask;                                           \
+    }                                                                          \
+    return -1;                                                                 \
+}                                                                              \
+                                                                               \
+static void name ## _resize(name ## _t *map, csc_ulong size)                   \
+{   csc_uchar *ctrl = map->ctrl;                                               \
+    keyType *keys = map->keys;                                                 \
+    valType *vals = map->vals;                                                 \
+    csc_ulong oldSize = map->mask + 1;                                         \
+    csc_ulong hv, slot;                                                        \
+    map->mask = size - 1;                                                      \
+    map->nDeleted = 0;                                                         \
+    map->ctrl = csc_ck_calloc(size);                                           \
+    map->keys = csc_allocMany(keyType, size);                                  \
+    map->vals = csc_allocMany(valType, size);                                  \
+    for (csc_ulong i=0; i<oldSize; i++)                                        \
+    {   if (ctrl[i] & 0x80)                                                    \
+        {   hv = hashFn(keys[i]);                                              \
+            slot = hv & map->mask;                                             \
+            while (map->ctrl[slot] != csc_hashMap_Empty)                       \
+                slot = (slot+1) & map->mask;                                   \
+            map->ctrl[slot] = csc_hashMap_tag(hv);                             \
+            map->keys[slot] = keys[i];                                         \
+            map->vals[slot] = vals[i];                                         \
+        }                                                                      \
+    }                                                                          \
+    free(ctrl);                                                                \
+    free(keys);                                                                \
+    free(vals);                                                                \
+}                                                                              \
+                                                                               \
+csc_bool_t name ## _put(name ## _t *map, keyType key, valType val)             \
+{   csc_ulong hv = hashFn(key);                                                \
+    csc_ulong size = map->mask + 1;                                            \
+    csc_ulong slot;                                                            \
+    long found = name ## _find(map, key, hv);                                  \
+    if (found >= 0)                                                            \
+    {   map->vals[found] = val;                                                \
+        return csc_FALSE;                                                      \
+    }                                                                          \
+    if (map->count + map->nDeleted >= size - size/8)                           \
+        name ## _resize(map, map->count >= size/2 ? size*2 : size);            \
+    slot = hv & map->mask;                                                     \
+    while (map->ctrl[slot] & 0x80)                                             \
+        slot = (slot+1) & map->mask;                                           \
+    if (map->ctrl[slot] == csc_hashMap_Deleted)                                \
+        map->nDeleted--;                                                       \
+    map->ctrl[slot] = csc_hashMap_tag(hv);                                     \
+    map->keys[slot] = key;                                                     \
+    map->vals[slot] = val;                                                     \
+    map->count++;                                                              \
+    return csc_TRUE;                                                           \
+}                                                                              \
+                                                                               \
+valType *name ## _get(name ## _t *map, keyType key)                            \
+{   long slot = name ## _find(map, key, hashFn(key));                          \
+    return slot<0 ? NULL : &map->vals[slot];                                   \
+}                                                                              \
+                                                                               \
+csc_bool_t name ## _del(name ## _t *map, keyType key)                          \
+{   long slot = name ## _find(map, key, hashFn(key));                          \
+    if (slot < 0)                                                              \
+        return csc_FALSE;                                                      \
+    if (map->ctrl[(slot+1) & map->mask] == csc_hashMap_Empty)                  \
+        map->ctrl[slot] = csc_hashMap_Empty;                                   \
+    else                                                                       \
+    {   map->ctrl[slot] = csc_hashMap_Deleted;                                 \
+        map->nDeleted++;                                                       \
+    }                                                                          \
+    map->count--;                                                              \
+    return csc_TRUE;                                                           \
+}                                                                              \
+                                                                               \
+csc_ulong name ## _count(name ## _t *map)                                      \
+{   return map->count;                                                         \
+}                                                                              \
+                                                                               \
+csc_bool_t name ## _next( name ## _t *map, csc_ulong *iter                     \
+                        , keyType *key, valType *val)                          \
+{   csc_ulong i = *iter;                                                       \
+    csc_ulong size = map->mask + 1;                                            \
+    while (i<size && !(map->ctrl[i] & 0x80))                                   \
+        i++;                                                                   \
+    if (i == size)                                                             \
+    {   *iter = i;                                                             \
+        return csc_FALSE;                                                      \
+    }                                                                          \
+    if (key != NULL)                                                           \
+        *key = map->keys[i];                                                   \
+    if (val != NULL)                                                           \
+        *val = map->vals[i];                                                   \
+    *iter = i + 1;                                                             \
+    return csc_TRUE;                                                           \
+}                                                                              \
+                                                                               \
+
+
+#endif
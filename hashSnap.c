@@ -0,0 +1,306 @@
+// Author: Dr Stephen Braithwaite.
+// This work is licensed under a Creative Commons Attribution-ShareAlike 4.0 International License.
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "std.h"
+#include "alloc.h"
+#include "hash.h"
+#include "hashSnap.h"
+
+/* The file is laid out as follows, with all offsets from the start of the
+ * file, so that it may be mapped at any address:-
+ *
+ *      header_t
+ *      slot_t[nSlots]      open addressed with linear probing.
+ *      entries             each is entry_t, key, value, padded to 8.
+ */
+
+#define Magic "CSCHSNP1"
+#define Version 2
+
+
+typedef struct
+{   char magic[8];
+    uint32_t version;
+    uint32_t isBigEndian;
+    uint32_t hashId;      // csc_hash_BytesSeedId of the writer.
+    uint32_t hashBits;    // Bits in the hash values it made.
+    uint64_t nSlots;
+    uint64_t count;
+    uint64_t seed;
+    uint64_t slotsOff;
+    uint64_t fileSize;
+} header_t;
+
+
+typedef struct
+{   uint64_t hash;
+    uint64_t entryOff;    // Zero if the slot is empty.
+} slot_t;
+
+
+typedef struct
+{   uint32_t keyLen;
+    uint32_t valLen;
+} entry_t;
+
+
+typedef struct csc_hashSnap_t
+{   const char *base;
+    size_t size;
+    const header_t *hdr;
+    const slot_t *slots;
+} csc_hashSnap_t;
+
+
+static uint32_t isBigEndian(void)
+{   uint32_t one = 1;
+    return *(char*)&one == 0;
+}
+
+
+// Syncs the directory holding 'path', so that a rename into it is on
+// disk.
+static void syncDir(const char *path)
+{   const char *slash = strrchr(path, '/');
+    char *dir;
+    int fd;
+    if (slash == NULL)
+        dir = csc_alloc_str(".");
+    else if (slash == path)
+        dir = csc_alloc_str("/");
+    else
+    {   dir = csc_allocMany(char, slash-path+1);
+        memcpy(dir, path, slash-path);
+        dir[slash-path] = '\0';
+    }
+    fd = open(dir, O_RDONLY);
+    if (fd >= 0)
+    {   fsync(fd);
+        close(fd);
+    }
+    free(dir);
+}
+
+
+int csc_hashSnap_write(csc_hash_t *hash, const char *path,
+                const void *(*getKey)(void *rec, size_t *len),
+                const void *(*getVal)(void *rec, size_t *len) )
+{   static const char zeros[8] = {0};
+    csc_hash_iter_t iter;
+    header_t hdr;
+    slot_t *slots;
+    void **slotRecs;
+    entry_t ent;
+    const void *key, *val, *key2;
+    size_t keyLen, valLen, keyLen2;
+    uint64_t nRecs, nSlots, off, hv, i;
+    char *tmpPath;
+    void *rec;
+    FILE *fp;
+    int fd, isOk;
+ 
+// Size the slots for a load factor of at most a half.
+    nRecs = 0;
+    for_hash_all(hash, iter, rec, void*)
+        nRecs++;
+    nSlots = 16;
+    while (nSlots < nRecs*2)
+        nSlots *= 2;
+    slots = csc_ck_calloc(nSlots * sizeof(slot_t));
+    slotRecs = csc_allocMany(void*, nSlots);
+ 
+// Open a temporary file of a unique name in the same directory, so that
+// writers of the same snapshot do not write over each other's files.
+    tmpPath = csc_alloc_str3(path, ".", "XXXXXX");
+    fd = mkstemp(tmpPath);
+    fp = NULL;
+    if (fd >= 0)
+    {   fchmod(fd, 0644);
+        fp = fdopen(fd, "wb");
+        if (fp == NULL)
+        {   close(fd);
+            unlink(tmpPath);
+        }
+    }
+    if (fp == NULL)
+    {   free(slots);
+        free(slotRecs);
+        free(tmpPath);
+        return csc_FALSE;
+    }
+ 
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, Magic, sizeof(hdr.magic));
+    hdr.version = Version;
+    hdr.isBigEndian = isBigEndian();
+    hdr.hashId = csc_hash_BytesSeedId;
+    hdr.hashBits = sizeof(csc_ulong) * 8;
+    hdr.nSlots = nSlots;
+    hdr.seed = csc_hash_intSeed((csc_ulong)time(NULL), (csc_ulong)getpid());
+    hdr.slotsOff = sizeof(header_t);
+ 
+// Write the entries after space for the header and slots, filling in
+// the slots as we go.
+    off = hdr.slotsOff + nSlots*sizeof(slot_t);
+    isOk = fseek(fp, (long)off, SEEK_SET) == 0;
+    for_hash_all(hash, iter, rec, void*)
+    {   if (!isOk)
+            continue;
+        key = getKey(rec, &keyLen);
+        val = getVal(rec, &valLen);
+        if (keyLen>UINT32_MAX || valLen>UINT32_MAX)
+        {   isOk = csc_FALSE;
+            continue;
+        }
+        hv = csc_hash_bytesSeed(key, keyLen, hdr.seed);
+ 
+// Skip duplicates.  The first found is the last added.
+        for (i=hv&(nSlots-1); slots[i].entryOff!=0; i=(i+1)&(nSlots-1))
+        {   if (slots[i].hash == hv)
+            {   key2 = getKey(slotRecs[i], &keyLen2);
+                if (keyLen2==keyLen && memcmp(key2, key, keyLen)==0)
+                    break;
+            }
+        }
+        if (slots[i].entryOff != 0)
+            continue;
+ 
+        slots[i].hash = hv;
+        slots[i].entryOff = off;
+        slotRecs[i] = rec;
+        ent.keyLen = (uint32_t)keyLen;
+        ent.valLen = (uint32_t)valLen;
+        isOk = fwrite(&ent, sizeof(ent), 1, fp) == 1
+            && fwrite(key, 1, keyLen, fp) == keyLen
+            && fwrite(val, 1, valLen, fp) == valLen
+            && fwrite(zeros, 1, (8 - (keyLen+valLen)%8) % 8, fp) == (8 - (keyLen+valLen)%8) % 8;
+        off += sizeof(ent) + (keyLen+valLen+7)/8*8;
+        hdr.count++;
+    }
+    hdr.fileSize = off;
+ 
+// Then the header and slots.
+    isOk = isOk
+        && fseek(fp, 0, SEEK_SET) == 0
+        && fwrite(&hdr, sizeof(hdr), 1, fp) == 1
+        && fwrite(slots, sizeof(slot_t), nSlots, fp) == nSlots;
+ 
+// Make sure that the file is on disk before it replaces the old one, and
+// then that the rename is.
+    isOk = isOk
+        && fflush(fp) == 0
+        && fsync(fd) == 0;
+    if (fclose(fp) != 0)
+        isOk = csc_FALSE;
+    if (isOk)
+        isOk = rename(tmpPath, path) == 0;
+    if (isOk)
+        syncDir(path);
+    else
+        unlink(tmpPath);
+ 
+    free(slots);
+    free(slotRecs);
+    free(tmpPath);
+    return isOk;
+}
+
+
+csc_hashSnap_t *csc_hashSnap_open(const char *path)
+{   csc_hashSnap_t *snap;
+    const header_t *hdr;
+    struct stat st;
+    void *base;
+    int fd;
+ 
+    fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return NULL;
+    if (fstat(fd, &st)!=0 || st.st_size<(off_t)sizeof(header_t))
+    {   close(fd);
+        return NULL;
+    }
+    base = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED)
+        return NULL;
+ 
+// Check the header.
+    hdr = base;
+    if (  memcmp(hdr->magic, Magic, sizeof(hdr->magic)) != 0
+       || hdr->version != Version
+       || hdr->isBigEndian != isBigEndian()
+       || hdr->hashId != csc_hash_BytesSeedId
+       || hdr->hashBits != sizeof(csc_ulong)*8
+       || hdr->fileSize != (uint64_t)st.st_size
+       || hdr->nSlots == 0
+       || (hdr->nSlots & (hdr->nSlots-1)) != 0
+       || hdr->slotsOff + hdr->nSlots*sizeof(slot_t) > hdr->fileSize
+       )
+    {   munmap(base, st.st_size);
+        return NULL;
+    }
+ 
+    snap = csc_allocOne(csc_hashSnap_t);
+    snap->base = base;
+    snap->size = st.st_size;
+    snap->hdr = hdr;
+    snap->slots = (const slot_t*)((const char*)base + hdr->slotsOff);
+    return snap;
+}
+
+
+const void *csc_hashSnap_get(csc_hashSnap_t *snap, const void *key, size_t keyLen,
+                size_t *valLen)
+{   const header_t *hdr = snap->hdr;
+    uint64_t mask = hdr->nSlots - 1;
+    uint64_t hv = csc_hash_bytesSeed(key, keyLen, hdr->seed);
+    const slot_t *slot;
+    const entry_t *ent;
+    const char *keyPt;
+    uint64_t i = hv & mask;
+ 
+// A damaged file might have no empty slot, so give up after all are seen.
+    for (uint64_t n=0; n<=mask; n++, i=(i+1)&mask)
+    {   slot = &snap->slots[i];
+        if (slot->entryOff == 0)
+            return NULL;
+        if (slot->hash != hv || slot->entryOff + sizeof(entry_t) > snap->size)
+            continue;
+ 
+// Check the key, and that the entry lies within the file.
+        ent = (const entry_t*)(snap->base + slot->entryOff);
+        keyPt = (const char*)(ent + 1);
+        if (  ent->keyLen == keyLen
+           && slot->entryOff + sizeof(entry_t) + (uint64_t)ent->keyLen + ent->valLen <= snap->size
+           && memcmp(keyPt, key, keyLen) == 0
+           )
+        {   if (valLen != NULL)
+                *valLen = ent->valLen;
+            return keyPt + keyLen;
+        }
+    }
+    return NULL;
+}
+
+
+csc_ulong csc_hashSnap_count(csc_hashSnap_t *snap)
+{   return (csc_ulong)snap->hdr->count;
+}
+
+
+void csc_hashSnap_close(csc_hashSnap_t *snap)
+{   munmap((void*)snap->base, snap->size);
+    free(snap);
+}
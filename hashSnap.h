@@ -0,0 +1,56 @@
+// Author: Dr Stephen Braithwaite.
+// This work is licensed under a Creative Commons Attribution-ShareAlike 4.0 International License.
+
+#ifndef csc_HASHSNAP_H
+#define csc_HASHSNAP_H 1
+#include <stddef.h>
+#include "std.h"
+#include "hash.h"
+
+typedef struct csc_hashSnap_t csc_hashSnap_t;
+
+
+int csc_hashSnap_write(csc_hash_t *hash, const char *path,
+                const void *(*getKey)(void *rec, size_t *len),
+                const void *(*getVal)(void *rec, size_t *len) );
+/*  Writes the records of 'hash' to the file 'path' as a snapshot, which
+ * may later be opened with csc_hashSnap_open().  'getKey'() and 'getVal'()
+ * are given a record and return a pointer to the bytes of its key or
+ * value, setting '*len' to their number.  Include the '\0' in the length
+ * if a string is to be read back as a string.  Where several records have
+ * the same key, only the last added is kept.
+ *
+ *  The file is written under a unique temporary name in the same
+ * directory, synced to disk, and then renamed, so a process that has the
+ * old snapshot open is not disturbed, and after a crash the file is
+ * either the old snapshot or the new.  It is readable by all.  Returns
+ * csc_FALSE on failure, including a key or value longer than 4GB.
+ */
+
+csc_hashSnap_t *csc_hashSnap_open(const char *path);
+/*  Maps the snapshot 'path' into memory, read only, and returns a handle
+ * to look up keys in it.  Nothing is read or built, so this takes the
+ * same time whatever the size of the file.  Pages are read in as lookups
+ * touch them, and are shared through the page cache with any other
+ * process that has the file open, including forked workers.  Returns
+ * NULL if the file cannot be opened or is not a snapshot, or if it was
+ * written by a version of the library that hashes keys differently.
+ */
+
+const void *csc_hashSnap_get(csc_hashSnap_t *snap, const void *key, size_t keyLen,
+                size_t *valLen);
+/*  Looks up the key of 'keyLen' bytes at 'key'.  If it is present, returns
+ * a pointer to its value in the mapped file, and sets '*valLen' to its
+ * length if 'valLen' is not NULL.  Otherwise returns NULL.  The value is
+ * valid until csc_hashSnap_close().
+ */
+
+unsigned long csc_hashSnap_count(csc_hashSnap_t *snap);
+/*  Returns the number of keys in 'snap'.
+ */
+
+void csc_hashSnap_close(csc_hashSnap_t *snap);
+/*  Unmaps the file and frees 'snap'.
+ */
+
+#endif
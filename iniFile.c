@@ -10,13 +10,14 @@
 #include "std.h"
 #include "alloc.h"
 #include "hash.h"
+#include "flatHash.h"
 #include "iniFile.h"
 
 #define MaxLineLen 255
 
 
 typedef struct csc_ini_t
-{   csc_hash_t *hash;
+{   csc_flatHash_t *hash;
 } csc_ini_t;    
 
 
@@ -37,14 +38,14 @@ static void freeIniRec(void *recVp)
 
 csc_ini_t *csc_ini_new(void)
 {   csc_ini_t *ini = csc_allocOne(csc_ini_t);
-    ini->hash = csc_hash_new((int)offsetof(iniRec_t,ident),
-                            csc_hash_StrPtCmpr, csc_hash_StrPt, freeIniRec);
+    ini->hash = csc_flatHash_new((int)offsetof(iniRec_t,ident),
+                                csc_hash_StrPtCmpr, csc_hash_StrPt, freeIniRec);
     return ini;
 }
 
 
 void csc_ini_free(csc_ini_t *ini)
-{   csc_hash_free(ini->hash);
+{   csc_flatHash_free(ini->hash);
     free(ini);
 }
 
@@ -55,7 +56,7 @@ const char *csc_ini_getStr(const csc_ini_t *ini, const char *section, const char
  
 // Look for the key in the hash table.
     key = csc_alloc_str3(section, "%", ident);
-    iniRec_t *rec = csc_hash_get(ini->hash, &key);
+    iniRec_t *rec = csc_flatHash_get(ini->hash, &key);
     free(key);
  
 // Return result.
@@ -72,7 +73,7 @@ char *csc_ini_getAllocStr(const csc_ini_t *ini, const char *section, const char
  
 // Look for the key in the hash table.
     key = csc_alloc_str3(section, "%", ident);
-    iniRec_t *rec = csc_hash_get(ini->hash, &key);
+    iniRec_t *rec = csc_flatHash_get(ini->hash, &key);
     free(key);
  
 // Return result.
@@ -183,7 +184,7 @@ int csc_ini_read(csc_ini_t *ini, const char *iniFilePath)
             rec = csc_allocOne(iniRec_t);
             rec->ident = csc_alloc_str3(section, "%", lineP);
             rec->value = csc_alloc_str(valueP);
-            csc_hash_addex(ini->hash, (void *)rec);
+            csc_flatHash_addex(ini->hash, (void *)rec);
  
         }  // if
     } // while
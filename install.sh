@@ -17,8 +17,8 @@ else
 fi
 
 cp std.h isvalid.h iniFile.h logger.h netCli.h netSrv.h \
-   servBase.h fileProperties.h cstr.h alloc.h list.h \
-   hash.h signal.h dynArray.h json.h $INCDIR
+   servBase.h fileProperties.h cstr.h alloc.h arena.h list.h \
+   hash.h flatHash.h hashMap.h concHash.h hashSnap.h signal.h dynArray.h numConv.h json.h $INCDIR
 cp libCscNet.a $LIBDIR
 
 
@@ -3,244 +3,556 @@
 
 #include <stdio.h>
 #include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <math.h>
 #include <ctype.h>
 #include <assert.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#ifdef __SSE2__
+#include <immintrin.h>
+#endif
 
 #include "std.h"
 #include "alloc.h"
-#include "isvalid.h"
+#include "arena.h"
+#include "hash.h"
+#include "numConv.h"
 #include "dynArray.h"
 #include "json.h"
 
-#define MaxIntLen 22
-#define MaxFloatLen 44
+// A string this long or shorter is kept in its value, not pointed to.
+#define ShortStrLen 14
+
+// The type of a value holding a short string.
+#define TypeShortStr 0x80
 
+// An object with this many members gets a hashed index of their names
+// when it is first searched.
+#define MinIndexed 16
+
+// A value is 16 bytes, with its type in the last byte.  A short string
+// fills the bytes before it.
 typedef union val_u
-{   int iVal;
-    double fVal;
-    csc_bool_t bVal;
-    char *sVal;
-    csc_json_t *oVal;
-    csc_jsonArr_t *aVal;
+{   struct
+    {   union
+        {   int64_t iVal;
+            double fVal;
+            csc_bool_t bVal;
+            char *sVal;
+            csc_json_t *oVal;
+            csc_jsonArr_t *aVal;
+        };
+        char pad[7];
+        csc_uchar type;     // A csc_jsonType_t, or TypeShortStr.
+    };
+    char str[ShortStrLen+1];
 } val_t;
 
-typedef struct elem_s
-{   csc_jsonType_t type;
-    char *name;
+// A member of an object.  Array elements have no name, so are just values.
+typedef struct memb_s
+{   char *name;
     val_t val;
-} elem_t;
+} memb_t;
+
+// A hashed index of the names of the first 'nEls' members of an object.
+// A slot holds the index of a member plus one, or zero if empty.  As other
+// threads may be reading it, an index is kept until its object is freed,
+// linked by 'next' to the older indexes of its object, or for an object
+// in an arena, to all the indexes of its document.
+typedef struct keyNdx_s
+{   struct keyNdx_s *next;
+    int nEls;
+    csc_uint mask;
+    int slots[];
+} keyNdx_t;
+
+// What all the objects and arrays of a document in an arena share.  A
+// parse error is kept here, rather than in every object and array.
+typedef struct jsonDoc_s
+{   csc_arena_t *arena;
+    char *errStr;       // NULL if no error.
+    int errPos;
+    int errLinePos;
+    keyNdx_t *keyNdxs;
+} jsonDoc_t;
 
+// An object or array has its elements, names and strings on the heap, or
+// in an arena that holds its whole document.
 typedef struct csc_json_s
-{   elem_t *els;  
+{   memb_t *els;
     int nEls;
     int mEls;
-    csc_jsonErr_t errNum;
-    char *errStr;
-    int errPos;
-    int errLinePos;
+    jsonDoc_t *doc;     // NULL if on the heap.
+    keyNdx_t *keyNdx;   // NULL until a large object is searched.
 } csc_json_t;
 
+typedef struct csc_jsonArr_s
+{   val_t *els;
+    int nEls;
+    int mEls;
+    jsonDoc_t *doc;     // NULL if on the heap.
+} csc_jsonArr_t;
+
+#define arenaOf(js) ((js)->doc==NULL ? NULL : (js)->doc->arena)
+
 typedef void (*writeStr_t)(void *context, const char *str);
 
 
-static void elem_free(elem_t *el)
-{
-// Free the value.
-    if (el->type == csc_jsonType_String)
-    {   free(el->val.sVal);
+static csc_jsonType_t valType(const val_t *v)
+{   if (v->type == TypeShortStr)
+        return csc_jsonType_String;
+    else
+        return v->type;
+}
+
+
+static const char *valStr(const val_t *v)
+{   if (v->type == TypeShortStr)
+        return v->str;
+    else
+        return v->sVal;
+}
+
+
+static void val_free(val_t *v)
+{   if (v->type == csc_jsonType_String)
+    {   free(v->sVal);
+    }
+    else if (v->type == csc_jsonType_Obj)
+    {   csc_json_free(v->oVal);
+    }
+    else if (v->type == csc_jsonType_Arr)
+    {   csc_jsonArr_free(v->aVal);
     }
-    else if (el->type == csc_jsonType_Obj) 
-    {   csc_json_free(el->val.oVal);
-    }   
-    else if (el->type == csc_jsonType_Arr) 
-    {   csc_jsonArr_free(el->val.aVal);
-    }   
- 
-// Free the name.
-    if (el->name != NULL)
-        free(el->name);
 }
 
 
-csc_json_t *csc_json_new()
-{   csc_json_t *js = csc_allocOne(csc_json_t);
+static void keyNdx_freeAll(keyNdx_t *ndx)
+{   keyNdx_t *next;
+    for ( ; ndx!=NULL; ndx=next)
+    {   next = ndx->next;
+        free(ndx);
+    }
+}
+
+
+static void jsonDoc_freeNdxs(void *context)
+{   keyNdx_freeAll(((jsonDoc_t*)context)->keyNdxs);
+}
+
+
+static jsonDoc_t *jsonDoc_new()
+{   csc_arena_t *arena = csc_arena_new(0);
+    jsonDoc_t *doc = csc_arena_alloc(arena, sizeof(jsonDoc_t));
+    doc->arena = arena;
+    doc->errStr = NULL;
+    doc->errPos = 0;
+    doc->errLinePos = 0;
+    doc->keyNdxs = NULL;
+    csc_arena_onFree(arena, jsonDoc_freeNdxs, doc);
+    return doc;
+}
+
+
+static csc_json_t *jsonNew(jsonDoc_t *doc)
+{   csc_json_t *js;
+    if (doc == NULL)
+        js = csc_allocOne(csc_json_t);
+    else
+        js = csc_arena_alloc(doc->arena, sizeof(csc_json_t));
     js->els = NULL;
     js->nEls = 0;
     js->mEls = 0;
-    js->errNum = csc_jsonErr_Ok;
-    js->errStr = NULL;
-    js->errPos = 0;
-    js->errLinePos = 0;
+    js->doc = doc;
+    js->keyNdx = NULL;
     return js;
 }
+csc_json_t *csc_json_new()
+{   return jsonNew(NULL);
+}
+csc_json_t *csc_json_newArena()
+{   return jsonNew(jsonDoc_new());
+}
+
+
+static csc_jsonArr_t *jsonArrNew(jsonDoc_t *doc)
+{   csc_jsonArr_t *jas;
+    if (doc == NULL)
+        jas = csc_allocOne(csc_jsonArr_t);
+    else
+        jas = csc_arena_alloc(doc->arena, sizeof(csc_jsonArr_t));
+    jas->els = NULL;
+    jas->nEls = 0;
+    jas->mEls = 0;
+    jas->doc = doc;
+    return jas;
+}
 csc_jsonArr_t *csc_jsonArr_new()
-{   return (csc_jsonArr_t*)csc_json_new();
+{   return jsonArrNew(NULL);
 }
 
 
 void csc_json_free(csc_json_t *js)
-{   elem_t *els = js->els;
-    
+{   memb_t *els = js->els;
+ 
+// A document in an arena is freed all at once.
+    if (js->doc != NULL)
+    {   csc_arena_free(js->doc->arena);
+        return;
+    }
+ 
 // Free the elements.
     if (els != NULL)
     {
     // Free stuff from each element.
         int nEls = js->nEls;
         for (int i=0; i<nEls; i++)
-        {   elem_free(&els[i]);
+        {   free(els[i].name);
+            val_free(&els[i].val);
         }
  
     // Free the elements.
         free(els);
     }
- 
-// Release error messages.
-    if (js->errStr)
-        free(js->errStr);
+    keyNdx_freeAll(js->keyNdx);
  
 // Free the object.
     free(js);
 }
 void csc_jsonArr_free(csc_jsonArr_t *jas)
-{   csc_json_free((csc_json_t*)jas);
+{   val_t *els = jas->els;
+    if (jas->doc != NULL)
+    {   csc_arena_free(jas->doc->arena);
+        return;
+    }
+    if (els != NULL)
+    {   int nEls = jas->nEls;
+        for (int i=0; i<nEls; i++)
+            val_free(&els[i]);
+        free(els);
+    }
+    free(jas);
+}
+
+
+// Copies a string to the heap or to 'arena'.
+static char *jsonStr(csc_arena_t *arena, const char *str)
+{   if (arena == NULL)
+        return csc_alloc_str(str);
+    else
+        return csc_arena_str(arena, str);
 }
 
 
-static void csc_json_setErr(csc_json_t *js, const char *errMsg, int errPos, int errLinePos)
-{   if (js->errStr)
-        free(js->errStr);
-    js->errStr = csc_alloc_str(errMsg);
-    js->errNum = csc_jsonErr_BadParse;
-    js->errPos = errPos;
-    js->errLinePos = errLinePos;
+static void jsonDoc_setErr(jsonDoc_t *doc, const char *errMsg, int errPos, int errLinePos)
+{   doc->errStr = csc_arena_str(doc->arena, errMsg);
+    doc->errPos = errPos;
+    doc->errLinePos = errLinePos;
 }
 int csc_json_getErrPos(const csc_json_t *js)
-{   return js->errPos;
+{   return js->doc==NULL ? 0 : js->doc->errPos;
 }
 int csc_json_getErrLinePos(const csc_json_t *js)
-{   return js->errLinePos;
+{   return js->doc==NULL ? 0 : js->doc->errLinePos;
 }
 const char *csc_json_getErrStr(const csc_json_t *js)
-{   return js->errStr;
+{   return js->doc==NULL ? NULL : js->doc->errStr;
 }
 
 
-static void csc_json_addVal(csc_json_t *js, csc_jsonType_t type, const char *name, val_t val)
-{   
-// Make the element.
-    elem_t *el;
+// Makes room for 'mEls' elements of 'elSize' bytes, of which 'nEls' are
+// in use.  In an arena, the old elements are left where they are.
+static void *growEls(void *els, int nEls, int mEls, size_t elSize, jsonDoc_t *doc)
+{   void *newEls;
+    if (doc == NULL)
+        return csc_ck_ralloc(els, mEls*elSize);
+    newEls = csc_arena_alloc(doc->arena, mEls*elSize);
+    if (nEls > 0)
+        memcpy(newEls, els, nEls*elSize);
+    return newEls;
+}
+
+
+// Adds a member to 'js' and returns its value to be filled in.
+static val_t *jsonAddMemb(csc_json_t *js, const char *name)
+{   memb_t *el;
  
 // Expand the dynamic array if needed.
     if (js->nEls == js->mEls)
     {   js->mEls = js->mEls * 2 + 10;
-        js->els = csc_ck_ralloc(js->els, js->mEls*sizeof(elem_t));
+        js->els = growEls(js->els, js->nEls, js->mEls, sizeof(memb_t), js->doc);
     }
  
 // Assign the element.
     el = &js->els[js->nEls++];
-    el->type = type;
-    el->val = val;
-    if (name == NULL)
-        el->name = NULL;
-    else
-        el->name = csc_alloc_str(name);
+    el->name = name==NULL ? NULL : jsonStr(arenaOf(js), name);
+    return &el->val;
+}
+
+
+// Adds an element to 'jas' and returns it to be filled in.
+static val_t *jsonApndVal(csc_jsonArr_t *jas)
+{   if (jas->nEls == jas->mEls)
+    {   jas->mEls = jas->mEls * 2 + 10;
+        jas->els = growEls(jas->els, jas->nEls, jas->mEls, sizeof(val_t), jas->doc);
+    }
+    return &jas->els[jas->nEls++];
 }
 
 
-static elem_t *findByName(const csc_json_t *js, const char *name)
-{   elem_t *els = js->els;
+// Indexes the members of 'js' and returns the index.  Other threads may be
+// doing the same, so the first to finish has its index used.
+static keyNdx_t *keyNdx_add(csc_json_t *js)
+{   keyNdx_t *old = js->keyNdx;
+    keyNdx_t *ndx;
+    csc_uint nSlots, i;
     int nEls = js->nEls;
-    int i;
-    for (i=0; i<nEls; i++)
+ 
+// Build the index with a load of at most a half.
+    nSlots = 32;
+    while (nSlots < (csc_uint)nEls*2)
+        nSlots *= 2;
+    ndx = csc_ck_calloc(sizeof(keyNdx_t) + nSlots*sizeof(int));
+    ndx->nEls = nEls;
+    ndx->mask = nSlots - 1;
+    for (int j=0; j<nEls; j++)
+    {   char *name = js->els[j].name;
+        if (name == NULL)
+            continue;
+        i = csc_hash_str(name) & ndx->mask;
+        while (ndx->slots[i]!=0 && !csc_streq(js->els[ndx->slots[i]-1].name, name))
+            i = (i+1) & ndx->mask;
+        if (ndx->slots[i] == 0)   // Keep the first of duplicate names.
+            ndx->slots[i] = j + 1;
+    }
+ 
+// Publish it.
+    ndx->next = old;
+    if (!__sync_bool_compare_and_swap(&js->keyNdx, old, ndx))
+    {   free(ndx);
+        return js->keyNdx;
+    }
+    if (js->doc != NULL)
+    {   do
+            ndx->next = js->doc->keyNdxs;
+        while (!__sync_bool_compare_and_swap(&js->doc->keyNdxs, ndx->next, ndx));
+    }
+    return ndx;
+}
+
+
+// Returns the index of the first member called 'name' among those in
+// 'ndx', or -1.
+static int keyNdx_find(const keyNdx_t *ndx, const memb_t *els, const char *name)
+{   csc_uint i = csc_hash_str((void*)name) & ndx->mask;
+    int j;
+    while ((j=ndx->slots[i]) != 0)
+    {   if (csc_streq(els[j-1].name, name))
+            return j - 1;
+        i = (i+1) & ndx->mask;
+    }
+    return -1;
+}
+
+
+static val_t *findByName(const csc_json_t *js, const char *name)
+{   memb_t *els = js->els;
+    int nEls = js->nEls;
+    keyNdx_t *ndx;
+    int i = 0;
+ 
+// A large object is searched through its index, and then the members
+// added since it was made.  It is remade when they are as many again.
+    if (nEls >= MinIndexed)
+    {   ndx = __sync_fetch_and_add(&((csc_json_t*)js)->keyNdx, 0);
+        if (ndx==NULL || nEls-ndx->nEls > ndx->nEls)
+            ndx = keyNdx_add((csc_json_t*)js);
+        i = keyNdx_find(ndx, els, name);
+        if (i >= 0)
+            return &els[i].val;
+        i = ndx->nEls;
+    }
+    for ( ; i<nEls; i++)
     {   char *eName = els[i].name;
         if (eName!=NULL && csc_streq(eName, name))
             break;
     }
     if (i < nEls)
-        return &els[i];
+        return &els[i].val;
     else
         return NULL;
 }
 
 
-static elem_t *findByIndex(const csc_json_t *js, int ndx)
-{   if (ndx<0 || ndx>js->nEls)
+static val_t *findByIndex(const csc_json_t *js, int ndx)
+{   if (ndx<0 || ndx>=js->nEls)
+        return NULL;
+    else
+        return &js->els[ndx].val;
+}
+
+
+static val_t *findArrByIndex(const csc_jsonArr_t *jas, int ndx)
+{   if (ndx<0 || ndx>=jas->nEls)
         return NULL;
     else
-        return &js->els[ndx];
+        return &jas->els[ndx];
 }
 
 
+static void setNull(val_t *v)
+{   v->type = csc_jsonType_Null;
+}
 void csc_json_addNull(csc_json_t *js, const char *name)
-{   val_t v;
-    v.bVal = csc_FALSE;
-    csc_json_addVal(js, csc_jsonType_Null, name, v);
+{   setNull(jsonAddMemb(js, name));
 }
 void csc_jsonArr_apndNull(csc_jsonArr_t *jas)
-{   csc_json_addNull((csc_json_t*)jas, NULL);
+{   setNull(jsonApndVal(jas));
 }
 
 
+static void setBool(val_t *v, csc_bool_t val)
+{   v->bVal = val;
+    v->type = csc_jsonType_Bool;
+}
 void csc_json_addBool(csc_json_t *js, const char *name, csc_bool_t val)
-{   val_t v;
-    v.bVal = val;
-    csc_json_addVal(js, csc_jsonType_Bool, name, v);
+{   setBool(jsonAddMemb(js, name), val);
 }
 void csc_jsonArr_apndBool(csc_jsonArr_t *jas, csc_bool_t val)
-{   csc_json_addBool((csc_json_t*)jas, NULL, val);
+{   setBool(jsonApndVal(jas), val);
 }
 
 
+static void setInt(val_t *v, int64_t val)
+{   v->iVal = val;
+    v->type = csc_jsonType_Int;
+}
 void csc_json_addInt(csc_json_t *js, const char *name, int val)
-{   val_t v;
-    v.iVal = val;
-    csc_json_addVal(js, csc_jsonType_Int, name, v);
+{   setInt(jsonAddMemb(js, name), val);
 }
 void csc_jsonArr_apndInt(csc_jsonArr_t *jas, int val)
-{   csc_json_addInt((csc_json_t*)jas, NULL, val);
+{   setInt(jsonApndVal(jas), val);
+}
+void csc_json_addInt64(csc_json_t *js, const char *name, int64_t val)
+{   setInt(jsonAddMemb(js, name), val);
+}
+void csc_jsonArr_apndInt64(csc_jsonArr_t *jas, int64_t val)
+{   setInt(jsonApndVal(jas), val);
 }
 
 
+static void setFloat(val_t *v, double val)
+{   v->fVal = val;
+    v->type = csc_jsonType_Float;
+}
 void csc_json_addFloat(csc_json_t *js, const char *name, double val)
-{   val_t v;
-    v.fVal = val;
-    csc_json_addVal(js, csc_jsonType_Float, name, v);
+{   setFloat(jsonAddMemb(js, name), val);
 }
 void csc_jsonArr_apndFloat(csc_jsonArr_t *jas, double val)
-{   csc_json_addFloat((csc_json_t*)jas, NULL, val);
+{   setFloat(jsonApndVal(jas), val);
 }
 
 
-void csc_json_addStr(csc_json_t *js, const char *name, const char *val)
-{   val_t v;
-    if (val == NULL)
-        v.sVal = NULL;
+// Sets 'v' to the 'len' bytes at 'str', copied to the heap or 'arena'.  In
+// an arena, elements are never freed or overwritten until the document is,
+// so a short string is copied into 'v' itself.  On the heap it is not, as
+// the elements move when more are added.
+static void setStrn(val_t *v, csc_arena_t *arena, const char *str, size_t len)
+{   if (arena!=NULL && len<=ShortStrLen)
+    {   memcpy(v->str, str, len);
+        v->str[len] = '\0';
+        v->type = TypeShortStr;
+        return;
+    }
+    else if (arena == NULL)
+    {   v->sVal = csc_allocMany(char, len+1);
+        memcpy(v->sVal, str, len);
+        v->sVal[len] = '\0';
+    }
+    else
+        v->sVal = csc_arena_strn(arena, str, len);
+    v->type = csc_jsonType_String;
+}
+static void setStr(val_t *v, csc_arena_t *arena, const char *val)
+{   if (val == NULL)
+    {   v->sVal = NULL;
+        v->type = csc_jsonType_String;
+    }
     else
-        v.sVal = csc_alloc_str(val);
-    csc_json_addVal(js, csc_jsonType_String, name, v);
+        setStrn(v, arena, val, strlen(val));
+}
+void csc_json_addStr(csc_json_t *js, const char *name, const char *val)
+{   setStr(jsonAddMemb(js, name), arenaOf(js), val);
 }
 void csc_jsonArr_apndStr(csc_jsonArr_t *jas, const char *val)
-{   csc_json_addStr((csc_json_t*)jas, NULL, val);
+{   setStr(jsonApndVal(jas), arenaOf(jas), val);
+}
+
+
+// An object or array in an arena takes ownership of a child from
+// elsewhere by freeing it with the arena.
+static void jsonFreeObj(void *context)
+{   csc_json_free((csc_json_t*)context);
+}
+static void jsonFreeArr(void *context)
+{   csc_jsonArr_free((csc_jsonArr_t*)context);
 }
 
 
+static void setObj(val_t *v, jsonDoc_t *doc, csc_json_t *val)
+{   if (doc!=NULL && val->doc!=doc)
+        csc_arena_onFree(doc->arena, jsonFreeObj, val);
+    v->oVal = val;
+    v->type = csc_jsonType_Obj;
+}
 void csc_json_addObj(csc_json_t *js, const char *name, csc_json_t *val)
-{   val_t v;
-    v.oVal = val;
-    csc_json_addVal(js, csc_jsonType_Obj, name, v);
+{   setObj(jsonAddMemb(js, name), js->doc, val);
 }
 void csc_jsonArr_apndObj(csc_jsonArr_t *jas, csc_json_t *val)
-{   csc_json_addObj((csc_json_t*)jas, NULL, val);
+{   setObj(jsonApndVal(jas), jas->doc, val);
 }
 
 
+static void setArr(val_t *v, jsonDoc_t *doc, csc_jsonArr_t *val)
+{   if (doc!=NULL && val->doc!=doc)
+        csc_arena_onFree(doc->arena, jsonFreeArr, val);
+    v->aVal = val;
+    v->type = csc_jsonType_Arr;
+}
 void csc_json_addArr(csc_json_t *js, const char *name, csc_jsonArr_t *val)
-{   val_t v;
-    v.aVal = val;
-    csc_json_addVal(js, csc_jsonType_Arr, name, v);
+{   setArr(jsonAddMemb(js, name), js->doc, val);
 }
 void csc_jsonArr_apndArr(csc_jsonArr_t *jas, csc_jsonArr_t *val)
-{   csc_json_addArr((csc_json_t*)jas, NULL, val);
+{   setArr(jsonApndVal(jas), jas->doc, val);
+}
+
+
+csc_json_t *csc_json_addNewObj(csc_json_t *js, const char *name)
+{   csc_json_t *child = jsonNew(js->doc);
+    csc_json_addObj(js, name, child);
+    return child;
+}
+csc_json_t *csc_jsonArr_apndNewObj(csc_jsonArr_t *jas)
+{   csc_json_t *child = jsonNew(jas->doc);
+    csc_jsonArr_apndObj(jas, child);
+    return child;
+}
+
+
+csc_jsonArr_t *csc_json_addNewArr(csc_json_t *js, const char *name)
+{   csc_jsonArr_t *child = jsonArrNew(js->doc);
+    csc_json_addArr(js, name, child);
+    return child;
+}
+csc_jsonArr_t *csc_jsonArr_apndNewArr(csc_jsonArr_t *jas)
+{   csc_jsonArr_t *child = jsonArrNew(jas->doc);
+    csc_jsonArr_apndArr(jas, child);
+    return child;
 }
 
 
@@ -248,44 +560,41 @@ int csc_json_length(const csc_json_t *js)
 {   return js->nEls;
 }
 int csc_jsonArr_length(const csc_jsonArr_t *jas)
-{   return csc_json_length((csc_json_t*)jas);
+{   return jas->nEls;
 }
 
 
-csc_jsonType_t csc_json_getType(const csc_json_t *js, const char *name)
-{   elem_t *el = findByName(js, name);
-    if (el == NULL)
+static csc_jsonType_t getType(const val_t *v)
+{   if (v == NULL)
         return csc_jsonType_Missing;
     else
-        return el->type;
+        return valType(v);
+}
+csc_jsonType_t csc_json_getType(const csc_json_t *js, const char *name)
+{   return getType(findByName(js, name));
 }
 csc_jsonType_t csc_json_ndxType(const csc_json_t *js, int ndx)
-{   elem_t *el = findByIndex(js, ndx);
-    if (el == NULL)
-        return csc_jsonType_Missing;
-    else
-        return el->type;
+{   return getType(findByIndex(js, ndx));
 }
 csc_jsonType_t csc_jsonArr_getType(const csc_jsonArr_t *jas, int ndx)
-{   return csc_json_ndxType((const csc_json_t *)jas, ndx);
+{   return getType(findArrByIndex(jas, ndx));
 }
 const char *csc_json_ndxName(const csc_json_t *js, int ndx)
-{   elem_t *el = findByIndex(js, ndx);
-    if (el == NULL)
+{   if (ndx<0 || ndx>=js->nEls)
         return NULL;
     else
-        return el->name;
+        return js->els[ndx].name;
 }
 
 
-static int getBool(const elem_t *el,  csc_jsonErr_t *errNum)
+static int getBool(const val_t *el,  csc_jsonErr_t *errNum)
 {   if (el == NULL)
     {   *errNum = csc_jsonErr_Missing;
         return csc_FALSE;
     }
     else if (el->type == csc_jsonType_Bool)
     {   *errNum = csc_jsonErr_Ok;
-        return el->val.bVal;
+        return el->bVal;
     }
     else if (el->type == csc_jsonType_Null)
     {   *errNum = csc_jsonErr_Null;
@@ -303,18 +612,18 @@ csc_bool_t csc_json_ndxBool(const csc_json_t *js, int ndx, csc_jsonErr_t *errNum
 {   return getBool(findByIndex(js,ndx), errNum);
 }
 csc_bool_t csc_jsonArr_getBool(const csc_jsonArr_t *jas, int ndx, csc_jsonErr_t *errNum)
-{   return csc_json_ndxBool((csc_json_t*)jas, ndx, errNum);
+{   return getBool(findArrByIndex(jas,ndx), errNum);
 }
 
 
-static int getInt(const elem_t *el,  csc_jsonErr_t *errNum)
+static int64_t getInt64(const val_t *el,  csc_jsonErr_t *errNum)
 {   if (el == NULL)
     {   *errNum = csc_jsonErr_Missing;
         return 0;
     }
     else if (el->type == csc_jsonType_Int)
     {   *errNum = csc_jsonErr_Ok;
-        return el->val.iVal;
+        return el->iVal;
     }
     else if (el->type == csc_jsonType_Null)
     {   *errNum = csc_jsonErr_Null;
@@ -325,6 +634,25 @@ static int getInt(const elem_t *el,  csc_jsonErr_t *errNum)
         return 0;
     }
 }
+int64_t csc_json_getInt64(const csc_json_t *js, const char *name, csc_jsonErr_t *errNum)
+{   return getInt64(findByName(js,name), errNum);
+}
+int64_t csc_json_ndxInt64(const csc_json_t *js, int ndx, csc_jsonErr_t *errNum)
+{   return getInt64(findByIndex(js,ndx), errNum);
+}
+int64_t csc_jsonArr_getInt64(const csc_jsonArr_t *jas, int ndx, csc_jsonErr_t *errNum)
+{   return getInt64(findArrByIndex(jas,ndx), errNum);
+}
+
+
+static int getInt(const val_t *el,  csc_jsonErr_t *errNum)
+{   int64_t val = getInt64(el, errNum);
+    if (val<INT_MIN || val>INT_MAX)
+    {   *errNum = csc_jsonErr_OutOfRange;
+        return 0;
+    }
+    return (int)val;
+}
 int csc_json_getInt(const csc_json_t *js, const char *name, csc_jsonErr_t *errNum)
 {   return getInt(findByName(js,name), errNum);
 }
@@ -332,22 +660,22 @@ int csc_json_ndxInt(const csc_json_t *js, int ndx, csc_jsonErr_t *errNum)
 {   return getInt(findByIndex(js,ndx), errNum);
 }
 int csc_jsonArr_getInt(const csc_jsonArr_t *jas, int ndx, csc_jsonErr_t *errNum)
-{   return csc_json_ndxInt((csc_json_t*)jas, ndx, errNum);
+{   return getInt(findArrByIndex(jas,ndx), errNum);
 }
 
 
-static double getFloat(const elem_t *el,  csc_jsonErr_t *errNum)
+static double getFloat(const val_t *el,  csc_jsonErr_t *errNum)
 {   if (el == NULL)
     {   *errNum = csc_jsonErr_Missing;
         return 0;
     }
     else if (el->type == csc_jsonType_Int)
     {   *errNum = csc_jsonErr_Ok;
-        return el->val.iVal;
+        return el->iVal;
     }
     else if (el->type == csc_jsonType_Float)
     {   *errNum = csc_jsonErr_Ok;
-        return el->val.fVal;
+        return el->fVal;
     }
     else if (el->type == csc_jsonType_Null)
     {   *errNum = csc_jsonErr_Null;
@@ -365,18 +693,18 @@ double csc_json_ndxFloat(const csc_json_t *js, int ndx, csc_jsonErr_t *errNum)
 {   return getFloat(findByIndex(js,ndx), errNum);
 }
 double csc_jsonArr_getFloat(const csc_jsonArr_t *jas, int ndx, csc_jsonErr_t *errNum)
-{   return csc_json_ndxFloat((csc_json_t*)jas, ndx, errNum);
+{   return getFloat(findArrByIndex(jas,ndx), errNum);
 }
 
 
-static const char *getStr(const elem_t *el,  csc_jsonErr_t *errNum)
+static const char *getStr(const val_t *el,  csc_jsonErr_t *errNum)
 {   if (el == NULL)
     {   *errNum = csc_jsonErr_Missing;
         return NULL;
     }
-    else if (el->type == csc_jsonType_String)
+    else if (valType(el) == csc_jsonType_String)
     {   *errNum = csc_jsonErr_Ok;
-        return el->val.sVal;
+        return valStr(el);
     }
     else if (el->type == csc_jsonType_Null)
     {   *errNum = csc_jsonErr_Null;
@@ -394,18 +722,18 @@ const char *csc_json_ndxStr(const csc_json_t *js, int ndx, csc_jsonErr_t *errNum
 {   return getStr(findByIndex(js,ndx), errNum);
 }
 const char *csc_jsonArr_getStr(const csc_jsonArr_t *jas, int ndx, csc_jsonErr_t *errNum)
-{   return csc_json_ndxStr((csc_json_t*)jas, ndx, errNum);
+{   return getStr(findArrByIndex(jas,ndx), errNum);
 }
 
 
-static const csc_json_t *getObj(const elem_t *el,  csc_jsonErr_t *errNum)
+static const csc_json_t *getObj(const val_t *el,  csc_jsonErr_t *errNum)
 {   if (el == NULL)
     {   *errNum = csc_jsonErr_Missing;
         return NULL;
     }
     else if (el->type == csc_jsonType_Obj)
     {   *errNum = csc_jsonErr_Ok;
-        return el->val.oVal;
+        return el->oVal;
     }
     else if (el->type == csc_jsonType_Null)
     {   *errNum = csc_jsonErr_Null;
@@ -423,18 +751,18 @@ const csc_json_t *csc_json_ndxObj(const csc_json_t *js, int ndx, csc_jsonErr_t *
 {   return getObj(findByIndex(js,ndx), errNum);
 }
 const csc_json_t *csc_jsonArr_getObj(const csc_jsonArr_t *jas, int ndx, csc_jsonErr_t *errNum)
-{   return csc_json_ndxObj((csc_json_t*)jas, ndx, errNum);
+{   return getObj(findArrByIndex(jas,ndx), errNum);
 }
 
 
-static const csc_jsonArr_t *getArr(const elem_t *el,  csc_jsonErr_t *errNum)
+static const csc_jsonArr_t *getArr(const val_t *el,  csc_jsonErr_t *errNum)
 {   if (el == NULL)
     {   *errNum = csc_jsonErr_Missing;
         return NULL;
     }
     else if (el->type == csc_jsonType_Arr)
     {   *errNum = csc_jsonErr_Ok;
-        return el->val.aVal;
+        return el->aVal;
     }
     else if (el->type == csc_jsonType_Null)
     {   *errNum = csc_jsonErr_Null;
@@ -452,23 +780,26 @@ const csc_jsonArr_t *csc_json_ndxArr(const csc_json_t *js, int ndx, csc_jsonErr_
 {   return getArr(findByIndex(js,ndx), errNum);
 }
 const csc_jsonArr_t *csc_jsonArr_getArr(const csc_jsonArr_t *jas, int ndx, csc_jsonErr_t *errNum)
-{   return csc_json_ndxArr((csc_json_t*)jas, ndx, errNum);
+{   return getArr(findArrByIndex(jas,ndx), errNum);
 }
 
 
-static void writeInt(writeStr_t writer, void *context, int val)
-{   char buf[MaxIntLen+1];
-    sprintf(buf, "%d", val);
+static void writeInt(writeStr_t writer, void *context, int64_t val)
+{   char buf[csc_numConv_IntLen+1];
+    csc_numConv_fmtInt(buf, val);
     writer(context, buf);
 }
 
+// Writes the fewest digits that read back as the same double.
+// JSON has no infinities or NaNs, so these are written as null.
 static void writeFloat(writeStr_t writer, void *context, double val)
-{   char buf[MaxFloatLen+1];
-    sprintf(buf, "%16g", val);
-    char *p = buf;
-    while (*p == ' ')
-        p++;
-    writer(context, p);
+{   char buf[csc_numConv_FloatLen+1];
+    if (!isfinite(val))
+    {   writer(context, "null");
+        return;
+    }
+    csc_numConv_fmtFloat(buf, val);
+    writer(context, buf);
 }
 
 static void writeBool(writeStr_t writer, void *context, csc_bool_t val)
@@ -524,19 +855,19 @@ static void writeStr(writeStr_t writer, void *context, const char *val)
 static void writeArr(writeStr_t writer, void *context, const csc_jsonArr_t *jas);
 static void writeObj(writeStr_t writer, void *context, const csc_json_t *js);
 
-static void writeEl(writeStr_t writer, void *context, const elem_t *el)
+static void writeEl(writeStr_t writer, void *context, const val_t *el)
 {   if (el->type == csc_jsonType_Bool)
-        writeBool(writer, context, el->val.bVal);
+        writeBool(writer, context, el->bVal);
     else if (el->type == csc_jsonType_Int)
-        writeInt(writer, context, el->val.iVal);
+        writeInt(writer, context, el->iVal);
     else if (el->type == csc_jsonType_Float)
-        writeFloat(writer, context, el->val.fVal);
-    else if (el->type == csc_jsonType_String)
-        writeStr(writer, context, el->val.sVal);
+        writeFloat(writer, context, el->fVal);
+    else if (valType(el) == csc_jsonType_String)
+        writeStr(writer, context, valStr(el));
     else if (el->type == csc_jsonType_Obj)
-        writeObj(writer, context, el->val.oVal);
+        writeObj(writer, context, el->oVal);
     else if (el->type == csc_jsonType_Arr)
-        writeArr(writer, context, el->val.aVal);
+        writeArr(writer, context, el->aVal);
     else
         writer(context, "null");
 }
@@ -544,14 +875,13 @@ static void writeEl(writeStr_t writer, void *context, const elem_t *el)
 static void writeObj(writeStr_t writer, void *context, const csc_json_t *js)
 {
 	int nEls = js->nEls;
-    elem_t *els = js->els;
+    memb_t *els = js->els;
     writer(context, "{");
     for (int i=0; i<nEls; i++)
     {   
-		writer(context, "\"");
-        writer(context, els[i].name);
-        writer(context, "\":");
-        writeEl(writer, context, &els[i]);
+        writeStr(writer, context, els[i].name);
+        writer(context, ":");
+        writeEl(writer, context, &els[i].val);
         if (i < nEls-1)
 		{
             writer(context, ",");
@@ -561,9 +891,8 @@ static void writeObj(writeStr_t writer, void *context, const csc_json_t *js)
 }
 
 static void writeArr(writeStr_t writer, void *context, const csc_jsonArr_t *jas)
-{   csc_json_t *js = (csc_json_t*)jas;
-    int nEls = js->nEls;
-    elem_t *els = js->els;
+{   int nEls = jas->nEls;
+    val_t *els = jas->els;
     writer(context, "[");
     for (int i=0; i<nEls; i++)
     {   writeEl(writer, context, &els[i]);
@@ -592,598 +921,1849 @@ void csc_json_writeCstr(const csc_json_t *js, csc_str_t *cstr)
 
 
 
-typedef int (*readCharAnyFunc_t)(void *context);
+// A writer puts what is written in its buffer.  If it writes to a string
+// or file descriptor, the buffer is passed on when a whole value has been
+// written, or when it is full.
+#define WriterBufSize 4096
+#define InitNest 16
+
+// What is known of each object or array being written.
+#define NestIsArr 1
+#define NestHasEls 2
+
+struct csc_jsonWriter_s
+{   char *buf;              // Always has room for a '\0' after 'len' bytes.
+    size_t len;
+    size_t max;
+    csc_str_t *cstr;        // Where it goes, or NULL.
+    int fd;                 // Where it goes, or -1.
+    csc_bool_t isErr;       // Writing to 'fd' failed.
+    csc_uchar *nest;
+    int nNest;
+    int mNest;
+    csc_bool_t isKeyed;     // A key awaits its value.
+};
+
+
+static csc_jsonWriter_t *jsonWriter_new(csc_str_t *cstr, int fd)
+{   csc_jsonWriter_t *jw = csc_allocOne(csc_jsonWriter_t);
+    jw->max = WriterBufSize;
+    jw->buf = csc_allocMany(char, jw->max);
+    jw->len = 0;
+    jw->cstr = cstr;
+    jw->fd = fd;
+    jw->isErr = csc_FALSE;
+    jw->mNest = InitNest;
+    jw->nest = csc_allocMany(csc_uchar, jw->mNest);
+    jw->nNest = 0;
+    jw->isKeyed = csc_FALSE;
+    return jw;
+}
+csc_jsonWriter_t *csc_jsonWriter_new()
+{   return jsonWriter_new(NULL, -1);
+}
+csc_jsonWriter_t *csc_jsonWriter_newStr(csc_str_t *cstr)
+{   return jsonWriter_new(cstr, -1);
+}
+csc_jsonWriter_t *csc_jsonWriter_newFd(int fd)
+{   return jsonWriter_new(NULL, fd);
+}
+
+
+// Passes the buffer on to the string or file descriptor, if there is one.
+static void jsonWriter_out(csc_jsonWriter_t *jw)
+{   const char *p = jw->buf;
+    size_t n = jw->len;
+    ssize_t nOut;
+    if (jw->cstr != NULL)
+    {   jw->buf[jw->len] = '\0';
+        csc_str_append(jw->cstr, jw->buf);
+    }
+    else if (jw->fd >= 0)
+    {   while (n>0 && !jw->isErr)
+        {   nOut = write(jw->fd, p, n);
+            if (nOut > 0)
+            {   p += nOut;
+                n -= nOut;
+            }
+            else if (nOut<0 && errno==EINTR)
+                continue;
+            else
+                jw->isErr = csc_TRUE;
+        }
+    }
+    else
+        return;
+    jw->len = 0;
+}
 
 
-// Class to that can read single chars from a string.
-typedef struct readCharStr_s
-{   const char *str;
-    const char *p;
-} readCharStr_t;
-static readCharStr_t *readCharStr_new(const char *str)
-{   readCharStr_t *rcs = csc_allocOne(readCharStr_t);
-    rcs->str = str;
-    rcs->p = str;
-}
-static void readCharStr_free(readCharStr_t *rcs)
-{   free(rcs);
-}
-static int readCharStr_getc(readCharStr_t *rcs)
-{   int ch = *rcs->p++;
-    if (ch == '\0')
-    {   rcs->p--;
-        return EOF;
+static void jsonWriter_put(csc_jsonWriter_t *jw, const char *str, size_t len)
+{   size_t max = jw->max;
+    if (jw->len+len >= max)
+    {   jsonWriter_out(jw);
+        while (jw->len+len >= max)
+            max *= 2;
+        if (max != jw->max)
+        {   jw->max = max;
+            jw->buf = csc_ck_ralloc(jw->buf, max);
+        }
     }
+    memcpy(jw->buf+jw->len, str, len);
+    jw->len += len;
+}
+
+static inline void jsonWriter_putCh(csc_jsonWriter_t *jw, char ch)
+{   if (jw->len+1 < jw->max)
+        jw->buf[jw->len++] = ch;
     else
-        return ch;
+        jsonWriter_put(jw, &ch, 1);
 }
 
-// Class to that can read single chars from whatever.
-typedef struct readCharAny_s
-{   readCharAnyFunc_t readChar;
-    void *context;
-} readCharAny_t;
-static readCharAny_t *readCharAny_new(readCharAnyFunc_t readChar, void *context)
-{   readCharAny_t *rca = csc_allocOne(readCharAny_t);
-    rca->readChar = readChar;
-    rca->context = context;
+
+// Writes the 'len' bytes at 'str' in quotes, escaping quotes, backslashes
+// and control characters.
+static void jsonWriter_quoted(csc_jsonWriter_t *jw, const char *str, size_t len)
+{   static const char hex[] = "0123456789abcdef";
+    const char *end = str + len;
+    const char *run;
+    char esc[6];
+    csc_uchar ch;
+    int n;
+    jsonWriter_putCh(jw, '\"');
+    for (;;)
+    {   run = str;
+        while (str<end && (csc_uchar)*str>=0x20 && *str!='\"' && *str!='\\')
+            str++;
+        jsonWriter_put(jw, run, str-run);
+        if (str == end)
+            break;
+        ch = *str++;
+        esc[0] = '\\';
+        n = 2;
+        switch (ch)
+        {   case '\"':  esc[1] = '\"';  break;
+            case '\\': esc[1] = '\\'; break;
+            case '\n':  esc[1] = 'n';  break;
+            case '\r':  esc[1] = 'r';  break;
+            case '\t':  esc[1] = 't';  break;
+            case '\b':  esc[1] = 'b';  break;
+            case '\f':  esc[1] = 'f';  break;
+            default:
+                memcpy(esc+1, "u00", 3);
+                esc[4] = hex[ch >> 4];
+                esc[5] = hex[ch & 0xF];
+                n = 6;
+        }
+        jsonWriter_put(jw, esc, n);
+    }
+    jsonWriter_putCh(jw, '\"');
+}
+
+
+// Writes the comma before an element of an array, or checks that a key
+// has been written for a member of an object.
+static void jsonWriter_beginVal(csc_jsonWriter_t *jw)
+{   csc_uchar *top;
+    if (jw->nNest == 0)
+        return;
+    top = &jw->nest[jw->nNest-1];
+    if (*top & NestIsArr)
+    {   if (*top & NestHasEls)
+            jsonWriter_putCh(jw, ',');
+        *top |= NestHasEls;
+    }
+    else
+    {   assert(jw->isKeyed);
+        jw->isKeyed = csc_FALSE;
+    }
+}
+
+// After a value, passes on a whole value written at the top level.
+static void jsonWriter_endVal(csc_jsonWriter_t *jw)
+{   if (jw->nNest == 0)
+        jsonWriter_out(jw);
+}
+
+
+static void jsonWriter_begin(csc_jsonWriter_t *jw, char ch, csc_uchar nest)
+{   jsonWriter_beginVal(jw);
+    if (jw->nNest == jw->mNest)
+    {   jw->mNest *= 2;
+        jw->nest = csc_ck_ralloc(jw->nest, jw->mNest);
+    }
+    jw->nest[jw->nNest++] = nest;
+    jsonWriter_putCh(jw, ch);
 }
-static void readCharAny_free(readCharAny_t *rca)
-{   free(rca);
+void csc_jsonWriter_beginObj(csc_jsonWriter_t *jw)
+{   jsonWriter_begin(jw, '{', 0);
 }
-static int readCharAny_getc(readCharAny_t *rca)
-{   return rca->readChar(rca->context);
+void csc_jsonWriter_beginArr(csc_jsonWriter_t *jw)
+{   jsonWriter_begin(jw, '[', NestIsArr);
 }
 
 
-// Reading from a string.
-static int readCharStr(void *context)
-{   return readCharStr_getc((readCharStr_t*)context);
+static void jsonWriter_end(csc_jsonWriter_t *jw, char ch, csc_uchar isArr)
+{   assert(jw->nNest>0 && (jw->nest[jw->nNest-1]&NestIsArr)==isArr && !jw->isKeyed);
+    jw->nNest--;
+    jsonWriter_putCh(jw, ch);
+    jsonWriter_endVal(jw);
+}
+void csc_jsonWriter_endObj(csc_jsonWriter_t *jw)
+{   jsonWriter_end(jw, '}', 0);
 }
+void csc_jsonWriter_endArr(csc_jsonWriter_t *jw)
+{   jsonWriter_end(jw, ']', NestIsArr);
+}
+
 
-// Reading from a file.
-static int readCharFile(void *context)
-{   return getc((FILE*)context);
+void csc_jsonWriter_key(csc_jsonWriter_t *jw, const char *name)
+{   csc_uchar *top;
+    assert(jw->nNest>0 && !(jw->nest[jw->nNest-1]&NestIsArr) && !jw->isKeyed);
+    top = &jw->nest[jw->nNest-1];
+    if (*top & NestHasEls)
+        jsonWriter_putCh(jw, ',');
+    *top |= NestHasEls;
+    jsonWriter_quoted(jw, name, strlen(name));
+    jsonWriter_putCh(jw, ':');
+    jw->isKeyed = csc_TRUE;
 }
 
 
-typedef struct jsonParse_s
-{   char *errStr;
-    csc_jsonErr_t errNo;
-    int charPos;
-    int lineNo;
-    readCharAny_t *rca;
-    int ch;
-} jsonParse_t;
+void csc_jsonWriter_null(csc_jsonWriter_t *jw)
+{   jsonWriter_beginVal(jw);
+    jsonWriter_put(jw, "null", 4);
+    jsonWriter_endVal(jw);
+}
 
-static jsonParse_t *jsonParse_new(readCharAny_t *rca)
-{   jsonParse_t *jsp = csc_allocOne(jsonParse_t);
-    jsp->errStr = NULL;
-    jsp->errNo = csc_jsonErr_Ok;
-    jsp->rca = rca;
-    jsp->ch = ' ';
-    jsp->charPos = 0;
-    jsp->lineNo = 1;
-    return jsp;
+void csc_jsonWriter_bool(csc_jsonWriter_t *jw, csc_bool_t val)
+{   jsonWriter_beginVal(jw);
+    if (val)
+        jsonWriter_put(jw, "true", 4);
+    else
+        jsonWriter_put(jw, "false", 5);
+    jsonWriter_endVal(jw);
 }
 
-static void jsonParse_free(jsonParse_t *jsp)
-{   if (jsp->errStr != NULL)
-        free(jsp->errStr);
-    free(jsp);
+void csc_jsonWriter_int(csc_jsonWriter_t *jw, int64_t val)
+{   char buf[csc_numConv_IntLen+1];
+    jsonWriter_beginVal(jw);
+    jsonWriter_put(jw, buf, csc_numConv_fmtInt(buf, val));
+    jsonWriter_endVal(jw);
 }
 
-static const char *jsonParse_getReason(jsonParse_t *jsp)
-{   return jsp->errStr;
+// JSON has no infinities or NaNs, so these are written as null.
+void csc_jsonWriter_float(csc_jsonWriter_t *jw, double val)
+{   char buf[csc_numConv_FloatLen+1];
+    jsonWriter_beginVal(jw);
+    if (isfinite(val))
+        jsonWriter_put(jw, buf, csc_numConv_fmtFloat(buf, val));
+    else
+        jsonWriter_put(jw, "null", 4);
+    jsonWriter_endVal(jw);
 }
 
-static int jsonParse_nextChar(jsonParse_t *jsp)
-{   int ch;
-    if (jsp->ch != EOF)
-    {   ch = jsp->ch = readCharAny_getc(jsp->rca);
-        if (ch == '\n')
-            jsp->lineNo++;
-        jsp->charPos++;
-    }
-    return ch;
+void csc_jsonWriter_strn(csc_jsonWriter_t *jw, const char *val, size_t len)
+{   jsonWriter_beginVal(jw);
+    jsonWriter_quoted(jw, val, len);
+    jsonWriter_endVal(jw);
 }
 
-static int jsonParse_skipSpace(jsonParse_t *jsp)
-{   int ch = jsp->ch;
-    while(isspace(ch))
-        ch = jsonParse_nextChar(jsp);
-    return ch;
+void csc_jsonWriter_str(csc_jsonWriter_t *jw, const char *val)
+{   if (val == NULL)
+        csc_jsonWriter_null(jw);
+    else
+        csc_jsonWriter_strn(jw, val, strlen(val));
 }
 
-static csc_bool_t jsonParse_readNum(jsonParse_t *jsp, elem_t *el)
-{   csc_bool_t isContinue = csc_TRUE;
-    csc_str_t *numStr = csc_str_new(NULL);
-    const char *nums;
-    csc_bool_t retVal;
- 
-// Assumes that we are looking at the first digit of a number.
-    int ch = jsp->ch;
-    assert(isdigit(ch));
- 
-// Read in a number.
-    while (isContinue)
-    {   switch(ch)
-        {   case '0': case '1': case '2': case '3': case '4':
-            case '5': case '6': case '7': case '8': case '9': 
-            case '-': case '+': case '.': case 'e': case 'E':
-                csc_str_append_ch(numStr, ch);
-                ch = jsonParse_nextChar(jsp);
+
+const char *csc_jsonWriter_buf(csc_jsonWriter_t *jw, size_t *len)
+{   jw->buf[jw->len] = '\0';
+    if (len != NULL)
+        *len = jw->len;
+    return jw->buf;
+}
+
+
+csc_bool_t csc_jsonWriter_flush(csc_jsonWriter_t *jw)
+{   jsonWriter_out(jw);
+    return !jw->isErr;
+}
+
+
+void csc_jsonWriter_reset(csc_jsonWriter_t *jw)
+{   jw->len = 0;
+    jw->isErr = csc_FALSE;
+    jw->nNest = 0;
+    jw->isKeyed = csc_FALSE;
+}
+
+
+void csc_jsonWriter_free(csc_jsonWriter_t *jw)
+{   jsonWriter_out(jw);
+    free(jw->buf);
+    free(jw->nest);
+    free(jw);
+}
+
+
+
+// The parser spends most of its time looking for the end of a run of
+// plain string bytes or of white space, so these are found a block of
+// bytes at a time.  Each finder takes the bytes from 'p' to 'end', and
+// returns the first that ends the run, or 'end'.
+
+// Returns the first quote or backslash.  Tests eight bytes at a time, by
+// the "has a zero byte" trick.
+#define Ones  0x0101010101010101ULL
+#define Highs 0x8080808080808080ULL
+#define hasZeroByte(w) (((w) - Ones) & ~(w) & Highs)
+
+static const char *skipPlainWords(const char *p, const char *end)
+{   uint64_t w;
+    while (end-p >= 8)
+    {   memcpy(&w, p, 8);
+        if (hasZeroByte(w ^ ('\"'*Ones)) | hasZeroByte(w ^ ('\\'*Ones)))
+            break;
+        p += 8;
+    }
+    while (p<end && *p!='\"' && *p!='\\')
+        p++;
+    return p;
+}
+
+#define isJsonSpace(ch) ((ch)==' ' || (ch)=='\n' || (ch)=='\r' || (ch)=='\t')
+
+// Returns the first byte that is not white space.
+static const char *skipSpaceBytes(const char *p, const char *end)
+{   while (p<end && isJsonSpace(*p))
+        p++;
+    return p;
+}
+
+// Parsing a whole buffer, bytes are also classified sixty four at a time
+// into bit masks, bit i for byte i.
+typedef struct
+{   uint64_t quote;         // Double quotes.
+    uint64_t bslash;        // Backslashes.
+    uint64_t struc;         // Braces, brackets, colons and commas.
+    uint64_t space;         // White space.
+} classes_t;
+
+static void classifyBytes(const char *p, classes_t *cl)
+{   uint64_t bit;
+    cl->quote = cl->bslash = cl->struc = cl->space = 0;
+    for (int i=0; i<64; i++)
+    {   bit = (uint64_t)1 << i;
+        switch (p[i])
+        {   case '\"':  cl->quote |= bit;  break;
+            case '\\':  cl->bslash |= bit;  break;
+            case '{': case '}': case '[': case ']': case ':': case ',':
+                cl->struc |= bit;
+                break;
+            case ' ': case '\n': case '\r': case '\t':
+                cl->space |= bit;
                 break;
-            default:
-                isContinue = csc_FALSE;
         }
     }
- 
-// Look at this number.
-    nums = csc_str_charr(numStr);
-    if (csc_isValid_int(nums))
-    {   retVal = csc_TRUE;
-        el->val.iVal = atoi(nums);
-        el->type = csc_jsonType_Int;
+}
+
+#ifdef __SSE2__
+
+// Blocks of bytes, compared a whole block at a time.  Comparing with a
+// byte gives a block of 0xFF where equal, and 0 where not.
+typedef char bytes16_t __attribute__((vector_size(16)));
+typedef char bytes32_t __attribute__((vector_size(32)));
+
+// As skipPlainWords(), but sixteen bytes at a time.
+static const char *skipPlainSse2(const char *p, const char *end)
+{   bytes16_t blk;
+    csc_uint mask;
+    while (end-p >= 16)
+    {   memcpy(&blk, p, 16);
+        mask = _mm_movemask_epi8((__m128i)((blk == '\"') | (blk == '\\')));
+        if (mask != 0)
+            return p + __builtin_ctz(mask);
+        p += 16;
     }
-    else if (csc_isValid_float(nums))
-    {   retVal = csc_TRUE;
-        el->val.fVal = atof(nums);
-        el->type = csc_jsonType_Float;
+    return skipPlainWords(p, end);
+}
+
+// As skipSpaceBytes(), but sixteen bytes at a time.
+static const char *skipSpaceSse2(const char *p, const char *end)
+{   bytes16_t blk;
+    csc_uint mask;
+    while (end-p >= 16)
+    {   memcpy(&blk, p, 16);
+        blk = (blk == ' ') | (blk == '\n') | (blk == '\r') | (blk == '\t');
+        mask = ~_mm_movemask_epi8((__m128i)blk) & 0xFFFF;
+        if (mask != 0)
+            return p + __builtin_ctz(mask);
+        p += 16;
     }
-    else
-    {   retVal = csc_FALSE;
-        el->type = csc_jsonType_Bad;
+    return skipSpaceBytes(p, end);
+}
+
+// As classifyBytes(), but sixteen bytes at a time.  Setting bit 0x20
+// makes '[' into '{' and ']' into '}', and nothing else into either.
+static void classifySse2(const char *p, classes_t *cl)
+{   bytes16_t blk, low;
+    cl->quote = cl->bslash = cl->struc = cl->space = 0;
+    for (int i=0; i<64; i+=16)
+    {   memcpy(&blk, p+i, 16);
+        low = blk | 0x20;
+        cl->quote |= (uint64_t)(_mm_movemask_epi8((__m128i)(blk == '\"')) & 0xFFFF) << i;
+        cl->bslash |= (uint64_t)(_mm_movemask_epi8((__m128i)(blk == '\\')) & 0xFFFF) << i;
+        cl->struc |= (uint64_t)(_mm_movemask_epi8((__m128i)(
+            (low == '{') | (low == '}') | (blk == ':') | (blk == ','))) & 0xFFFF) << i;
+        cl->space |= (uint64_t)(_mm_movemask_epi8((__m128i)(
+            (blk == ' ') | (blk == '\n') | (blk == '\r') | (blk == '\t'))) & 0xFFFF) << i;
     }
- 
-// Free resources.
-    csc_str_free(numStr);
- 
-// Byte.
-    return retVal;
 }
 
- 
-static csc_bool_t jsonParse_readPlainWord(jsonParse_t *jsp, elem_t *el)
-{   csc_str_t *wordStr = csc_str_new(NULL);
-    const char *word;
-    csc_bool_t retVal;
- 
-// Assumes that we are looking at the first character of a word.
-    int ch = jsp->ch;
-    assert(islower(ch));
- 
-// Read in a word.
-    while (islower(ch))
-    {   csc_str_append_ch(wordStr, ch);
-        ch = jsonParse_nextChar(jsp);
+#ifdef __GNUC__
+#define HasAvx2 1
+
+// AVX2 is not assumed by the compiler, so these are only used if the CPU
+// is found to have it.
+
+// As skipPlainWords(), but thirty two bytes at a time.
+__attribute__((target("avx2")))
+static const char *skipPlainAvx2(const char *p, const char *end)
+{   bytes32_t blk;
+    csc_uint mask;
+    while (end-p >= 32)
+    {   memcpy(&blk, p, 32);
+        mask = _mm256_movemask_epi8((__m256i)((blk == '\"') | (blk == '\\')));
+        if (mask != 0)
+            return p + __builtin_ctz(mask);
+        p += 32;
     }
- 
-// Look at this word.
-    word = csc_str_charr(wordStr);
-    if (csc_streq(word,"true"))
-    {   retVal = csc_TRUE;
-        el->val.bVal = csc_TRUE;
-        el->type = csc_jsonType_Bool;
+    return skipPlainSse2(p, end);
+}
+
+// As skipSpaceBytes(), but thirty two bytes at a time.
+__attribute__((target("avx2")))
+static const char *skipSpaceAvx2(const char *p, const char *end)
+{   bytes32_t blk;
+    csc_uint mask;
+    while (end-p >= 32)
+    {   memcpy(&blk, p, 32);
+        blk = (blk == ' ') | (blk == '\n') | (blk == '\r') | (blk == '\t');
+        mask = ~(csc_uint)_mm256_movemask_epi8((__m256i)blk);
+        if (mask != 0)
+            return p + __builtin_ctz(mask);
+        p += 32;
     }
-    else if (csc_streq(word,"false"))
-    {   retVal = csc_TRUE;
-        el->val.bVal = csc_FALSE;
-        el->type = csc_jsonType_Bool;
+    return skipSpaceSse2(p, end);
+}
+
+// As classifySse2(), but thirty two bytes at a time.
+__attribute__((target("avx2")))
+static void classifyAvx2(const char *p, classes_t *cl)
+{   bytes32_t blk, low;
+    cl->quote = cl->bslash = cl->struc = cl->space = 0;
+    for (int i=0; i<64; i+=32)
+    {   memcpy(&blk, p+i, 32);
+        low = blk | 0x20;
+        cl->quote |= (uint64_t)(csc_uint)_mm256_movemask_epi8((__m256i)(blk == '\"')) << i;
+        cl->bslash |= (uint64_t)(csc_uint)_mm256_movemask_epi8((__m256i)(blk == '\\')) << i;
+        cl->struc |= (uint64_t)(csc_uint)_mm256_movemask_epi8((__m256i)(
+            (low == '{') | (low == '}') | (blk == ':') | (blk == ','))) << i;
+        cl->space |= (uint64_t)(csc_uint)_mm256_movemask_epi8((__m256i)(
+            (blk == ' ') | (blk == '\n') | (blk == '\r') | (blk == '\t'))) << i;
     }
-    else if (csc_streq(word,"null"))
-    {   retVal = csc_TRUE;
-        el->type = csc_jsonType_Null;
+}
+#endif
+
+#endif
+
+// The finders used, chosen for the CPU by scanInit().
+static const char *(*skipPlain)(const char *p, const char *end) = skipPlainWords;
+static const char *(*skipSpace)(const char *p, const char *end) = skipSpaceBytes;
+static void (*classify)(const char *p, classes_t *cl) = classifyBytes;
+
+static void scanInit(void)
+{   static volatile csc_bool_t isDone = csc_FALSE;
+    if (isDone)
+        return;
+#ifdef __SSE2__
+    skipPlain = skipPlainSse2;
+    skipSpace = skipSpaceSse2;
+    classify = classifySse2;
+#endif
+#ifdef HasAvx2
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {   skipPlain = skipPlainAvx2;
+        skipSpace = skipSpaceAvx2;
+        classify = classifyAvx2;
+    }
+#endif
+    isDone = csc_TRUE;
+}
+
+
+// The parser works on a block of bytes at a time, scanning it with a
+// pointer.  Parsing a string, the block is the whole string.  Reading a
+// FILE, the block is refilled from the FILE when it is used up.
+#define BlockSize 65536
+#define InitTokSize 256
+
+// What is expected next.
+typedef enum
+{   expect_Obj          // The opening brace of an object.
+,   expect_Key          // A name, or the end of the object.
+,   expect_Colon
+,   expect_MembVal
+,   expect_ArrVal       // A value, or the end of the array.
+,   expect_Next         // A comma, or the end of the object or array.
+} expect_t;
+
+// How parsing stopped.
+typedef enum
+{   run_Done
+,   run_Eof             // Before an object.
+,   run_Error
+,   run_Starved         // Pushed bytes ran out.
+} run_t;
+
+typedef struct jsonParse_s
+{   const char *p;          // The next byte.
+    const char *end;        // The end of the bytes in the block.
+    const char *blk;        // The start of the block.
+    FILE *fin;              // NULL if parsing a string.
+    csc_bool_t isRegFile;   // Bytes read past the object are given back.
+    csc_bool_t isInSitu;    // Strings are decoded in place in the string.
+    csc_bool_t isPush;      // Bytes are pushed to the parser, and may run out.
+    csc_bool_t isStarved;   // They have.
+    char *buf;              // The block, if reading a FILE.
+    long blkPos;            // Bytes before the block.
+    const char *lineMark;   // Lines are counted up to here,
+    int blkLines;           // and there are this many.
+    char *tok;              // Strings, numbers and words are put together here.
+    int tokLen;
+    int tokMax;
+    expect_t expect;
+    csc_bool_t isInStr;     // Part way through a string, which is in 'tok'.
+    csc_uchar *nest;        // Whether each object or array being read is
+    int nNest;              // an array.
+    int mNest;
+} jsonParse_t;
+
+static jsonParse_t *jsonParse_new(const char *str, size_t len, FILE *fin)
+{   jsonParse_t *jsp = csc_allocOne(jsonParse_t);
+    struct stat st;
+    scanInit();
+    jsp->fin = fin;
+    jsp->isInSitu = csc_FALSE;
+    jsp->isPush = csc_FALSE;
+    jsp->isStarved = csc_FALSE;
+    if (fin == NULL)
+    {   jsp->buf = NULL;
+        jsp->isRegFile = csc_FALSE;
+        jsp->blk = jsp->p = str;
+        jsp->end = str + len;
     }
     else
-    {   retVal = csc_FALSE;
-        el->type = csc_jsonType_Bad;
+    {   jsp->buf = csc_allocMany(char, BlockSize);
+        jsp->isRegFile = fstat(fileno(fin),&st)==0 && S_ISREG(st.st_mode);
+        jsp->blk = jsp->p = jsp->end = jsp->buf;
     }
- 
-// Free resources.
-    csc_str_free(wordStr);
- 
-// Byte.
-    return retVal;
+    jsp->blkPos = 0;
+    jsp->lineMark = jsp->blk;
+    jsp->blkLines = 0;
+    jsp->tokMax = InitTokSize;
+    jsp->tok = csc_allocMany(char, jsp->tokMax);
+    jsp->tokLen = 0;
+    jsp->expect = expect_Obj;
+    jsp->isInStr = csc_FALSE;
+    jsp->nest = NULL;
+    jsp->nNest = 0;
+    jsp->mNest = 0;
+    return jsp;
 }
 
+static void jsonParse_free(jsonParse_t *jsp)
+{
+// Give back to a file what was read past the end of the object.
+    if (jsp->isRegFile && jsp->p < jsp->end)
+        fseek(jsp->fin, -(long)(jsp->end - jsp->p), SEEK_CUR);
+    if (jsp->buf != NULL)
+        free(jsp->buf);
+    if (jsp->nest != NULL)
+        free(jsp->nest);
+    free(jsp->tok);
+    free(jsp);
+}
 
-static int jsonParse_readHexStr(jsonParse_t *jsp, char *hexStr, int hexStrMaxLen)
-{   int ch = jsp->ch;
-    int n;
- 
-// Assumes that first hex digit has been read in.
-    assert(isxdigit(ch));
- 
-// Read in the string.
-    n = 0;
-    while (n<hexStrMaxLen && isxdigit(ch))
-    {   hexStr[n++] = ch;
-        ch = jsonParse_nextChar(jsp);
+static int countLines(const char *p, const char *end)
+{   int n = 0;
+    while ((p=memchr(p, '\n', end-p)) != NULL)
+    {   n++;
+        p++;
     }
-    hexStr[n] = '\0';
- 
-// Dont skip past any more hex digits, cos they are a legit in a string.
-    // while (isxdigit(ch))
-    // {    n++;
-    //  ch = jsonParse_nextChar(jsp);
-    // }
- 
-// Bye.
     return n;
 }
 
+// The character position and line number of the next byte, for error
+// messages.  Lines are only counted when they are needed.
+static int jsonParse_charPos(jsonParse_t *jsp)
+{   return (int)(jsp->blkPos + (jsp->p - jsp->blk)) + 1;
+}
 
-static csc_bool_t jsonParse_readString(jsonParse_t *jsp, csc_str_t *str)
-{   csc_bool_t isContinue = csc_TRUE;
-    csc_bool_t isOK = csc_TRUE;
-    csc_bool_t isGetNext;
- 
-// Assumes we have the initial quote of a string.
-    int ch = jsp->ch;
-    assert(ch == '\"');
-    ch = jsonParse_nextChar(jsp);
+static int jsonParse_lineNo(jsonParse_t *jsp)
+{   return jsp->blkLines + countLines(jsp->lineMark, jsp->p) + 1;
+}
+
+// Refills an empty block.  Returns the next byte, or EOF.
+static int jsonParse_fill(jsonParse_t *jsp)
+{   size_t n;
+    int ch;
+    if (jsp->fin == NULL)
+    {   if (jsp->isPush)
+            jsp->isStarved = csc_TRUE;
+        return EOF;
+    }
+    jsp->blkLines += countLines(jsp->lineMark, jsp->end);
+    jsp->blkPos += jsp->end - jsp->blk;
+    if (jsp->isRegFile)
+        n = fread(jsp->buf, 1, BlockSize, jsp->fin);
+    else
+    {
+    // A pipe or socket cannot be given back what is read past the object,
+    // nor should we wait for it, so stop at each closing brace.
+        n = 0;
+        while (n<BlockSize && (ch=getc_unlocked(jsp->fin))!=EOF)
+        {   jsp->buf[n++] = (char)ch;
+            if (ch=='}' || ch=='\n')
+                break;
+        }
+    }
+    jsp->blk = jsp->p = jsp->lineMark = jsp->buf;
+    jsp->end = jsp->buf + n;
+    if (n == 0)
+        return EOF;
+    else
+        return (csc_uchar)*jsp->p;
+}
+
+// Returns the next byte without moving past it, or EOF.
+static inline int jsonParse_peek(jsonParse_t *jsp)
+{   if (jsp->p < jsp->end)
+        return (csc_uchar)*jsp->p;
+    else
+        return jsonParse_fill(jsp);
+}
+
+static int jsonParse_skipSpace(jsonParse_t *jsp)
+{   const char *p;
+    for (;;)
+    {
+    // Most runs of white space are short or empty.
+        p = jsp->p;
+        if (p<jsp->end && !isJsonSpace(*p))
+            return (csc_uchar)*p;
+        p = skipSpace(p, jsp->end);
+        jsp->p = p;
+        if (p < jsp->end)
+            return (csc_uchar)*p;
+        if (jsonParse_fill(jsp) == EOF)
+            return EOF;
+    }
+}
+
+
+static void jsonParse_tokAppend(jsonParse_t *jsp, const char *str, int len)
+{   if (jsp->tokLen+len >= jsp->tokMax)
+    {   while (jsp->tokLen+len >= jsp->tokMax)
+            jsp->tokMax *= 2;
+        jsp->tok = csc_ck_ralloc(jsp->tok, jsp->tokMax);
+    }
+    memcpy(jsp->tok+jsp->tokLen, str, len);
+    jsp->tokLen += len;
+    jsp->tok[jsp->tokLen] = '\0';
+}
+
+static void jsonParse_tokAppendCh(jsonParse_t *jsp, char ch)
+{   jsonParse_tokAppend(jsp, &ch, 1);
+}
+
+// Appends the bytes from the next one for as long as 'isIn'(byte) is true.
+static void jsonParse_tokWhile(jsonParse_t *jsp, int (*isIn)(int ch))
+{   const char *p, *run;
+    jsp->tokLen = 0;
+    jsp->tok[0] = '\0';
+    do
+    {   p = run = jsp->p;
+        while (p<jsp->end && isIn((csc_uchar)*p))
+            p++;
+        jsonParse_tokAppend(jsp, run, (int)(p-run));
+        jsp->p = p;
+    } while (p==jsp->end && jsonParse_fill(jsp)!=EOF);
+}
+
+
+static int isNumCh(int ch)
+{   return (ch>='0' && ch<='9') || ch=='-' || ch=='+' || ch=='.' || ch=='e' || ch=='E';
+}
+
+// The most significant digits that are kept of a number.  The rest only
+// count towards its exponent.
+#define MaxSigDigits 19
+
+// Reads the number 'str', in the forms accepted by csc_isValid_int() and
+// csc_isValid_float().  An integer is read exactly, as 64 bits, and is
+// read as a floating value if it does not fit.
+static csc_bool_t parseNum(const char *str, val_t *el)
+{   const char *p = str;
+    uint64_t mant = 0;
+    int nSig = 0, exp10 = 0, expVal = 0, d;
+    csc_bool_t isNeg, isInt = csc_TRUE, isTrunc = csc_FALSE, hasNum = csc_FALSE, isExpNeg;
+    isNeg = *p == '-';
+    if (isNeg)
+        p++;
  
-// Read in the string.
-    while (isContinue)
-    {   isGetNext = csc_TRUE;
-        if (ch == '\"')
-        {   isContinue = csc_FALSE;
-            jsonParse_nextChar(jsp);
-            isGetNext = csc_FALSE;
+// The digits before and after the point, dropping leading zeros.
+    for (; isdigit(*p); p++)
+    {   hasNum = csc_TRUE;
+        d = *p - '0';
+        if (nSig < MaxSigDigits)
+        {   mant = mant*10 + d;
+            nSig += mant != 0;
         }
-        else if (ch == EOF)
-        {   isContinue = csc_FALSE;
-            isOK = csc_FALSE;
-            isGetNext = csc_FALSE;
+        else
+        {   exp10++;
+            isTrunc |= d != 0;
         }
-        else if (ch == '\\')
-        {   ch = jsonParse_nextChar(jsp);
-            switch(ch)
-            {   case '\"':
-                    csc_str_append_ch(str, ch);
-                    break;
-                case '\\':
-                    csc_str_append_ch(str, ch);
-                    break;
-                case '/':
-                    csc_str_append_ch(str, ch);
-                    break;
-                case 'b':
-                    csc_str_append_ch(str, '\b');
-                    break;
-                case 'f':
-                    csc_str_append_ch(str, '\f');
-                    break;
-                case 'n':
-                    csc_str_append_ch(str, '\n');
-                    break;
-                case 'r':
-                    csc_str_append_ch(str, '\r');
-                    break;
-                case 't':
-                    csc_str_append_ch(str, '\t');
-                    break;
-                case 'u':
-                {   const int HexStrMaxLen = 4;
-                    char hexStr[HexStrMaxLen+1];
-                    ch = jsonParse_nextChar(jsp);
-                    int nHexDigits = jsonParse_readHexStr(jsp, hexStr, HexStrMaxLen);
-                    if (nHexDigits == 4)
-                    {   csc_str_append(str, "$@$");  // TODO: Convert to UTF-8.
-                    }
-                    else
-                    {   csc_str_append(str, "$#$");  // TODO: 
-                    }
-                    isGetNext = csc_FALSE;
-                    break;
-                }
-                case EOF:
-                    isGetNext = csc_FALSE;
-                    break;
-                default:
-                    csc_str_append_ch(str, ch);
-                    break;
+    }
+    if (*p == '.')
+    {   isInt = csc_FALSE;
+        for (p++; isdigit(*p); p++)
+        {   hasNum = csc_TRUE;
+            d = *p - '0';
+            if (nSig < MaxSigDigits)
+            {   mant = mant*10 + d;
+                nSig += mant != 0;
+                exp10--;
             }
+            else
+                isTrunc |= d != 0;
         }
-        else
-        {   csc_str_append_ch(str, ch);
+    }
+ 
+// The exponent.
+    if ((*p=='e' || *p=='E') && hasNum)
+    {   isInt = csc_FALSE;
+        p++;
+        isExpNeg = *p == '-';
+        if (*p=='-' || *p=='+')
+            p++;
+        if (!isdigit(*p))
+            hasNum = csc_FALSE;
+        for (; isdigit(*p); p++)
+        {   if (expVal < 100000)
+                expVal = expVal*10 + (*p - '0');
         }
-        if (isGetNext)
-            ch = jsonParse_nextChar(jsp);
+        exp10 += isExpNeg ? -expVal : expVal;
     }
+    if (*p!='\0' || !hasNum)
+    {   el->type = csc_jsonType_Bad;
+        return csc_FALSE;
+    }
+ 
+// An integer, if it fits.
+    if ( isInt && exp10==0
+       && mant <= (isNeg ? (uint64_t)INT64_MAX+1 : (uint64_t)INT64_MAX)
+       )
+    {   el->iVal = isNeg ? (int64_t)(0 - mant) : (int64_t)mant;
+        el->type = csc_jsonType_Int;
+        return csc_TRUE;
+    }
+ 
+// If digits were dropped, the value lies between 'mant' and the next up,
+// and is only known if they round to the same double.
+    el->type = csc_jsonType_Float;
+    if (csc_numConv_decToFloat(mant, exp10, isNeg, &el->fVal))
+    {   double up;
+        if ( !isTrunc
+           || (csc_numConv_decToFloat(mant+1, exp10, isNeg, &up) && up==el->fVal)
+           )
+            return csc_TRUE;
+    }
+    el->fVal = strtod(str, NULL);
+    return csc_TRUE;
+}
+
+static csc_bool_t jsonParse_readNum(jsonParse_t *jsp, val_t *el)
+{
+// Assumes that we are looking at the first character of a number.
+    assert(isdigit(*jsp->p) || *jsp->p=='-');
  
-    return isOK;
+// Read in a number, and look at it.
+    jsonParse_tokWhile(jsp, isNumCh);
+    return parseNum(jsp->tok, el);
 }
 
+ 
+static int isLowerCh(int ch)
+{   return ch>='a' && ch<='z';
+}
 
-static csc_bool_t jsonParse_readIdent(jsonParse_t *jsp, csc_str_t *str)
-{   csc_bool_t isOK = csc_TRUE;
-    int ch = jsp->ch;
+static csc_bool_t jsonParse_readPlainWord(jsonParse_t *jsp, val_t *el)
+{   const char *word;
  
-// Reset the string.
-    csc_str_assign(str, NULL);
+// Assumes that we are looking at the first character of a word.
+    assert(islower(*jsp->p));
+ 
+// Read in a word.
+    jsonParse_tokWhile(jsp, isLowerCh);
  
-// Get the identifier.
-    if (ch == '\"')
-    {   isOK = jsonParse_readString(jsp, str);
+// Look at this word.
+    word = jsp->tok;
+    if (csc_streq(word,"true"))
+    {   el->bVal = csc_TRUE;
+        el->type = csc_jsonType_Bool;
+        return csc_TRUE;
     }
-    else if (isalpha(ch))
-    {   while (isalnum(ch) || ch=='_')
-        {   csc_str_append_ch(str, ch);
-            ch = jsonParse_nextChar(jsp);
-        }
+    else if (csc_streq(word,"false"))
+    {   el->bVal = csc_FALSE;
+        el->type = csc_jsonType_Bool;
+        return csc_TRUE;
+    }
+    else if (csc_streq(word,"null"))
+    {   el->type = csc_jsonType_Null;
+        return csc_TRUE;
     }
     else
-    {   isOK = csc_FALSE;
+    {   el->type = csc_jsonType_Bad;
+        return csc_FALSE;
     }
- 
-// Return the result.
-    return isOK;
 }
 
 
-static csc_bool_t jsonParse_readStringEl(jsonParse_t *jsp, elem_t *el)
-{   
-// Allocate resources.
-    csc_str_t *str = csc_str_new(NULL);
- 
-// Read in the string.
-    csc_bool_t isOK = jsonParse_readString(jsp, str);
- 
-// Assign the result.
-    if (isOK)
-    {   el->type = csc_jsonType_String;
-        el->val.sVal = csc_str_alloc_charr(str);
+
+
+// Appends the code point 'cp' as UTF-8.
+static void jsonParse_tokAppendUtf8(jsonParse_t *jsp, csc_uint cp)
+{   char buf[4];
+    int n;
+    if (cp < 0x80)
+    {   buf[0] = (char)cp;
+        n = 1;
+    }
+    else if (cp < 0x800)
+    {   buf[0] = (char)(0xC0 | cp>>6);
+        buf[1] = (char)(0x80 | (cp & 0x3F));
+        n = 2;
+    }
+    else if (cp < 0x10000)
+    {   buf[0] = (char)(0xE0 | cp>>12);
+        buf[1] = (char)(0x80 | (cp>>6 & 0x3F));
+        buf[2] = (char)(0x80 | (cp & 0x3F));
+        n = 3;
     }
     else
-    {   el->type = csc_jsonType_Bad;
-        el->val.sVal = NULL;
+    {   buf[0] = (char)(0xF0 | cp>>18);
+        buf[1] = (char)(0x80 | (cp>>12 & 0x3F));
+        buf[2] = (char)(0x80 | (cp>>6 & 0x3F));
+        buf[3] = (char)(0x80 | (cp & 0x3F));
+        n = 4;
     }
- 
-// Free resources.
-    csc_str_free(str);
- 
-// Return the result.
-    return isOK;
+    jsonParse_tokAppend(jsp, buf, n);
 }
 
 
-static csc_json_t *jsonParse_readObj(jsonParse_t *jsp);
-static csc_jsonArr_t *jsonParse_readArr(jsonParse_t *jsp);
+// Reads the four hex digits of a \u escape.
+static csc_bool_t jsonParse_readHex4(jsonParse_t *jsp, csc_uint *val)
+{   int ch;
+    *val = 0;
+    for (int i=0; i<4; i++)
+    {   ch = jsonParse_peek(jsp);
+        if (ch == EOF || !isxdigit(ch))
+            return csc_FALSE;
+        jsp->p++;
+        *val = *val*16 + (isdigit(ch) ? ch-'0' : (tolower(ch)-'a'+10));
+    }
+    return csc_TRUE;
+}
 
 
-static csc_bool_t jsonParse_readElem(jsonParse_t *jsp, elem_t *el)
-{   int ch = jsonParse_skipSpace(jsp);
-    if (islower(ch))
-    {
-        return jsonParse_readPlainWord(jsp, el);
-    }
-    else if (isdigit(ch))
-    {
-        return jsonParse_readNum(jsp, el);
+static csc_bool_t jsonParse_readEscape(jsonParse_t *jsp);
+
+// Reads a \u escape, that follows the 'u'.  A surrogate pair makes one
+// code point.  An unpaired surrogate becomes U+FFFD.
+static csc_bool_t jsonParse_readUnicode(jsonParse_t *jsp)
+{   csc_uint cp, lo;
+    if (!jsonParse_readHex4(jsp, &cp))
+        return csc_FALSE;
+    if (cp>=0xD800 && cp<0xDC00)
+    {   if (jsonParse_peek(jsp) != '\\')
+            cp = 0xFFFD;
+        else
+        {   jsp->p++;
+            if (jsonParse_peek(jsp) != 'u')
+            {   jsonParse_tokAppendUtf8(jsp, 0xFFFD);
+                return jsonParse_readEscape(jsp);
+            }
+            jsp->p++;
+            if (!jsonParse_readHex4(jsp, &lo))
+                return csc_FALSE;
+            if (lo>=0xDC00 && lo<0xE000)
+                cp = 0x10000 + ((cp-0xD800)<<10) + (lo-0xDC00);
+            else
+            {   jsonParse_tokAppendUtf8(jsp, 0xFFFD);
+                cp = lo;
+            }
+        }
     }
-    else if (ch == '\"')
-    {
-        return jsonParse_readStringEl(jsp, el);
+    if (cp>=0xD800 && cp<0xE000)
+        cp = 0xFFFD;
+    jsonParse_tokAppendUtf8(jsp, cp);
+    return csc_TRUE;
+}
+
+
+// Reads an escape sequence, that follows the backslash.
+static csc_bool_t jsonParse_readEscape(jsonParse_t *jsp)
+{   int ch = jsonParse_peek(jsp);
+    if (ch == EOF)
+        return csc_FALSE;
+    jsp->p++;
+    switch(ch)
+    {   case 'b':
+            ch = '\b';
+            break;
+        case 'f':
+            ch = '\f';
+            break;
+        case 'n':
+            ch = '\n';
+            break;
+        case 'r':
+            ch = '\r';
+            break;
+        case 't':
+            ch = '\t';
+            break;
+        case 'u':
+            return jsonParse_readUnicode(jsp);
+        default:   // Quote, backslash and slash stand for themselves.
+            break;
     }
-    else if (ch == '{')
-    {
-        csc_json_t *obj = jsonParse_readObj(jsp);
-		assert(obj != NULL);
-        if (csc_json_getErrStr(obj)==NULL)
-        {
-            el->type = csc_jsonType_Obj; 
-            el->val.oVal = obj;
+    jsonParse_tokAppendCh(jsp, (char)ch);
+    return csc_TRUE;
+}
+
+
+// Reads the rest of a string, after the opening quote and what is
+// already in 'tok'.  If pushed bytes run out, what has been read stays in
+// 'tok', but a part of an escape sequence is left to be read again.
+static csc_bool_t jsonParse_readStrRest(jsonParse_t *jsp)
+{   const char *p, *esc;
+    int ch, escTokLen;
+ 
+// Copy runs of plain characters in one go.
+    for (;;)
+    {   p = skipPlain(jsp->p, jsp->end);
+        jsonParse_tokAppend(jsp, jsp->p, (int)(p-jsp->p));
+        jsp->p = p;
+        ch = jsonParse_peek(jsp);
+        if (ch == '\"')
+        {   jsp->p++;
             return csc_TRUE;
         }
-        else
-        {
-            el->type = csc_jsonType_Obj; 
-            el->val.oVal = obj;
+        else if (ch == EOF)
             return csc_FALSE;
+        else if (ch == '\\')
+        {   esc = jsp->p++;
+            escTokLen = jsp->tokLen;
+            if (!jsonParse_readEscape(jsp) || jsp->isStarved)
+            {   if (jsp->isStarved)
+                {   jsp->p = esc;
+                    jsp->tokLen = escTokLen;
+                    jsp->tok[escTokLen] = '\0';
+                }
+                return csc_FALSE;
+            }
         }
     }
-    else if (ch == '[')
-    {
-        csc_jsonArr_t *arr = jsonParse_readArr(jsp);
-		assert(arr != NULL);
-        if (csc_json_getErrStr((csc_json_t*)arr) == NULL)
-        {
-            el->type = csc_jsonType_Arr; 
-            el->val.aVal = arr;
-            return csc_TRUE;
+}
+
+
+// Starts reading a string, at its opening quote.
+static void jsonParse_beginStr(jsonParse_t *jsp)
+{   jsp->p++;
+    jsp->tokLen = 0;
+    jsp->tok[0] = '\0';
+    jsp->isInStr = csc_TRUE;
+}
+
+
+// As jsonParse_readStrRest(), but reads the whole string and decodes the string in place, and returns a
+// pointer to it, or NULL.  No escape sequence is shorter than what it
+// stands for, so what is written never overtakes what is read, and there
+// is room for the terminating null where the closing quote was.
+static char *jsonParse_readStringInSitu(jsonParse_t *jsp, int *len)
+{   csc_bool_t isMoved = csc_FALSE;
+    csc_bool_t isOk;
+    char *str, *w;
+    const char *p;
+ 
+// Assumes we have the initial quote of a string.
+    assert(*jsp->p == '\"');
+    str = w = (char*)++jsp->p;
+    for (;;)
+    {   p = skipPlain(jsp->p, jsp->end);
+        if (isMoved)
+            jsp->blkLines += countLines(jsp->p, p);
+        if (w != jsp->p)
+            memmove(w, jsp->p, p-jsp->p);
+        w += p - jsp->p;
+        jsp->p = p;
+        if (p == jsp->end)
+            break;
+        jsp->p++;
+        if (*p == '\"')
+        {   *w = '\0';
+            *len = w - str;
+            if (isMoved)
+                jsp->lineMark = jsp->p;
+            return str;
         }
-        else
-        {
-            el->type = csc_jsonType_Arr; 
-            el->val.aVal = arr;
-            return csc_FALSE;
+ 
+    // Decoding changes the lines, so count them up to the first escape,
+    // and then those of each run of plain characters before it is moved.
+        if (!isMoved)
+        {   jsp->blkLines += countLines(jsp->lineMark, p);
+            isMoved = csc_TRUE;
         }
+ 
+    // Decode an escape sequence, and copy it back.  A backslash may escape
+    // a newline.
+        jsp->tokLen = 0;
+        isOk = jsonParse_readEscape(jsp);
+        jsp->blkLines += countLines(p, jsp->p);
+        if (!isOk)
+            break;
+        memcpy(w, jsp->tok, jsp->tokLen);
+        w += jsp->tokLen;
     }
+ 
+// Failed.
+    if (isMoved)
+        jsp->lineMark = jsp->p;
+    return NULL;
+}
+
+
+static int isIdentCh(int ch)
+{   return isalnum(ch) || ch=='_';
+}
+
+// Reads the name of an element, unless it is quoted and not being parsed
+// in place, and sets '*len' to its length.  Returns it in 'tok', or when
+// parsing in place in the string, or NULL if there is no name.
+static const char *jsonParse_readName(jsonParse_t *jsp, int *len)
+{   char *start;
+    if (!jsp->isInSitu)
+    {   jsonParse_tokWhile(jsp, isIdentCh);
+        *len = jsp->tokLen;
+        return jsp->tok;
+    }
+    else if (*jsp->p == '\"')
+        return jsonParse_readStringInSitu(jsp, len);
     else
     {
+    // There is no closing quote to put the null in, so move the name
+    // back over the byte before it, which has been read.  That byte may
+    // be a newline, so count the lines up to the name first.
+        start = (char*)jsp->p;
+        jsp->blkLines += countLines(jsp->lineMark, start);
+        while (jsp->p<jsp->end && isIdentCh(*jsp->p))
+            jsp->p++;
+        memmove(start-1, start, jsp->p-start);
+        ((char*)jsp->p)[-1] = '\0';
+        jsp->lineMark = jsp->p;
+        *len = jsp->p - start;
+        return start - 1;
+    }
+}
+
+
+// Reads a number or word, or a string when parsing in place, and reports
+// it, unless pushed bytes have run out.
+static csc_bool_t jsonParse_readScalar( jsonParse_t *jsp, int ch
+                                      , const csc_jsonSax_t *sax, void *context)
+{   const char *str;
+    val_t val;
+    int len;
+    if (islower(ch))
+    {   if (!jsonParse_readPlainWord(jsp, &val))
+            return csc_FALSE;
+    }
+    else if (isdigit(ch) || ch=='-')
+    {   if (!jsonParse_readNum(jsp, &val))
+            return csc_FALSE;
+    }
+    else if (ch=='\"' && jsp->isInSitu)
+    {   if ((str=jsonParse_readStringInSitu(jsp, &len)) == NULL)
+            return csc_FALSE;
+        if (sax->strVal)
+            sax->strVal(context, str, len);
+        return csc_TRUE;
+    }
+    else
+        return csc_FALSE;
+ 
+// Report the number or word.
+    if (jsp->isStarved)
         return csc_FALSE;
+    if (val.type == csc_jsonType_Int)
+    {   if (sax->intVal)
+            sax->intVal(context, val.iVal);
+    }
+    else if (val.type == csc_jsonType_Float)
+    {   if (sax->floatVal)
+            sax->floatVal(context, val.fVal);
+    }
+    else if (val.type == csc_jsonType_Bool)
+    {   if (sax->boolVal)
+            sax->boolVal(context, val.bVal);
+    }
+    else
+    {   if (sax->nullVal)
+            sax->nullVal(context);
     }
+    return csc_TRUE;
+}
+
+
+static run_t jsonParse_fail( jsonParse_t *jsp, const char *errMsg
+                           , const csc_jsonSax_t *sax, void *context)
+{   if (sax->error)
+        sax->error(context, errMsg, jsonParse_charPos(jsp), jsonParse_lineNo(jsp));
+    return run_Error;
 }
 
 
-static csc_jsonArr_t *jsonParse_readArr(jsonParse_t *jsp)
-{   int isOK = csc_TRUE;    
-    csc_bool_t isContinue = csc_TRUE;
+// Enters an object or array.
+static void jsonParse_nestIn(jsonParse_t *jsp, csc_bool_t isArr)
+{   if (jsp->nNest == jsp->mNest)
+    {   jsp->mNest = jsp->mNest * 2 + 16;
+        jsp->nest = csc_ck_ralloc(jsp->nest, jsp->mNest);
+    }
+    jsp->nest[jsp->nNest++] = isArr;
+}
+
+
+// Reads from where it left off, reporting what is read to 'sax'.  Nested
+// objects and arrays are kept track of in 'jsp->nest', rather than by
+// recursion, so that when pushed bytes run out the parser can stop, and
+// carry on when there are more.  What has been read of a string is kept,
+// and anything else is read again.
+static run_t jsonParse_run(jsonParse_t *jsp, const csc_jsonSax_t *sax, void *context)
+{   const char *mark, *name;
+    csc_bool_t isArr, isOk;
+    int ch, len;
+ 
+    jsp->isStarved = csc_FALSE;
+    for (;;)
+    {   isArr = jsp->nNest>0 && jsp->nest[jsp->nNest-1];
+ 
+    // Carry on reading a string.
+        if (jsp->isInStr)
+        {   isOk = jsonParse_readStrRest(jsp);
+            if (jsp->isStarved)
+                return run_Starved;
+            jsp->isInStr = csc_FALSE;
+            if (jsp->expect == expect_Key)
+            {   if (!isOk)
+                    return jsonParse_fail(jsp, "Expected Ident", sax, context);
+                if (sax->key)
+                    sax->key(context, jsp->tok, jsp->tokLen);
+                jsp->expect = expect_Colon;
+            }
+            else
+            {   if (!isOk)
+                    return jsonParse_fail(jsp, "Expected Element", sax, context);
+                if (sax->strVal)
+                    sax->strVal(context, jsp->tok, jsp->tokLen);
+                jsp->expect = expect_Next;
+            }
+            continue;
+        }
  
-// Allocate resources.
-    csc_jsonArr_t *arr = csc_jsonArr_new();
+        ch = jsonParse_skipSpace(jsp);
+        if (jsp->isStarved)
+            return run_Starved;
+        mark = jsp->p;
+        switch (jsp->expect)
+        {   case expect_Obj:
+                if (ch == EOF)
+                    return run_Eof;
+                else if (ch != '{')
+                {   char errStr[99];
+                    sprintf(errStr, "%s %d", "Expected Opening Brace.  Got char #", ch);
+                    return jsonParse_fail(jsp, errStr, sax, context);
+                }
+                jsp->p++;
+                jsonParse_nestIn(jsp, csc_FALSE);
+                if (sax->beginObj)
+                    sax->beginObj(context);
+                jsp->expect = expect_Key;
+                break;
  
-// Assumes that we are looking at the opening brace of an object.
-    int ch = jsp->ch;
-    assert(ch == '[');
+            case expect_Key:
+                if (ch == '}')
+                    goto endNest;
+                else if (ch!='\"' && !isalpha(ch))
+                    return jsonParse_fail(jsp, "Expected ending brace or new identifier", sax, context);
+                else if (ch=='\"' && !jsp->isInSitu)
+                {   jsonParse_beginStr(jsp);
+                    break;
+                }
+                name = jsonParse_readName(jsp, &len);
+                if (jsp->isStarved)
+                    break;
+                if (name == NULL)
+                    return jsonParse_fail(jsp, "Expected Ident", sax, context);
+                if (sax->key)
+                    sax->key(context, name, len);
+                jsp->expect = expect_Colon;
+                break;
  
-// Look at next character.
-    jsonParse_nextChar(jsp);
-    ch = jsonParse_skipSpace(jsp);
-    while (isContinue)
-    {
-        if (ch == ']')
-        {
-            ch = jsonParse_nextChar(jsp);
-            isContinue = csc_FALSE;
-        }
-        else
-        {
-        // Now we expect an element.
-            ch = jsonParse_skipSpace(jsp);
-            elem_t elem;
-            isOK = jsonParse_readElem(jsp, &elem);
-            if (!isOK)
-            {   csc_json_setErr((csc_json_t*)arr, "Expected Element", jsp->charPos, jsp->lineNo);
+            case expect_Colon:
+                if (ch != ':')
+                    return jsonParse_fail(jsp, "Expected Colon", sax, context);
+                jsp->p++;
+                jsp->expect = expect_MembVal;
                 break;
-            }
  
-        // Add element to the object.
-            csc_json_addVal((csc_json_t*)arr, elem.type, NULL, elem.val);
+            case expect_ArrVal:
+                if (ch == ']')
+                    goto endNest;
+            // Fall through.
+            case expect_MembVal:
+                if (ch == '{')
+                {   jsp->p++;
+                    jsonParse_nestIn(jsp, csc_FALSE);
+                    if (sax->beginObj)
+                        sax->beginObj(context);
+                    jsp->expect = expect_Key;
+                }
+                else if (ch == '[')
+                {   jsp->p++;
+                    jsonParse_nestIn(jsp, csc_TRUE);
+                    if (sax->beginArr)
+                        sax->beginArr(context);
+                    jsp->expect = expect_ArrVal;
+                }
+                else if (ch=='\"' && !jsp->isInSitu)
+                    jsonParse_beginStr(jsp);
+                else if (jsonParse_readScalar(jsp, ch, sax, context))
+                    jsp->expect = expect_Next;
+                else if (!jsp->isStarved)
+                    return jsonParse_fail(jsp, "Expected Element", sax, context);
+                break;
  
-        // Now we expect a comma or an ending bracket.
-            ch = jsonParse_skipSpace(jsp);
-            if (ch == ',')
-            {   jsonParse_nextChar(jsp);
-                ch = jsonParse_skipSpace(jsp);
-            }
-            else if (ch == ']')
-            {
-            }
-            else
-            {   csc_json_setErr((csc_json_t*)arr, "Expected comma or ending brace", jsp->charPos, jsp->lineNo);
+            case expect_Next:
+                if (ch == ',')
+                {   jsp->p++;
+                    jsp->expect = isArr ? expect_ArrVal : expect_Key;
+                }
+                else if (ch == (isArr ? ']' : '}'))
+                    goto endNest;
+                else
+                    return jsonParse_fail(jsp, "Expected comma or ending brace", sax, context);
                 break;
-            }
+        }
  
+    // Ran out of bytes part way through a name, number or word.
+        if (jsp->isStarved)
+        {   jsp->p = mark;
+            return run_Starved;
+        }
+        continue;
+ 
+    // Leave the object or array, and expect what follows it.
+    endNest:
+        jsp->p++;
+        jsp->nNest--;
+        if (isArr)
+        {   if (sax->endArr)
+                sax->endArr(context);
         }
+        else
+        {   if (sax->endObj)
+                sax->endObj(context);
+        }
+        if (jsp->nNest == 0)
+        {   jsp->expect = expect_Obj;
+            return run_Done;
+        }
+        jsp->expect = expect_Next;
     }
- 
-// Return result.
-    return arr;
 }
-            
 
 
-static csc_json_t *jsonParse_readObj(jsonParse_t *jsp)
-{   int isOK = csc_TRUE;    
-    csc_bool_t isContinue = csc_TRUE;
+
+// Objects are built from what the parser reports.  The elements of the
+// objects and arrays being read are gathered on a stack, and when one
+// ends its elements are copied into an array of just the right size.
+typedef struct jsonBuild_s
+{   jsonDoc_t *doc;
+    csc_bool_t isInSitu;    // Names and strings are already in place.
+    csc_json_t *root;
+    memb_t *stack;          // Elements.
+    int nStack;
+    int mStack;
+    struct                  // The objects and arrays being read.
+    {   void *node;
+        csc_bool_t isArr;
+        int base;           // Where its elements start on the stack.
+    } *open;
+    int nOpen;
+    int mOpen;
+    char *name;             // Of the next member, or NULL.
+} jsonBuild_t;
+
+
+static val_t *jsonBuild_push(jsonBuild_t *jb)
+{   memb_t *el;
+    if (jb->nStack == jb->mStack)
+    {   jb->mStack = jb->mStack * 2 + 64;
+        jb->stack = csc_ck_ralloc(jb->stack, jb->mStack*sizeof(memb_t));
+    }
+    el = &jb->stack[jb->nStack++];
+    el->name = jb->name;
+    jb->name = NULL;
+    return &el->val;
+}
+
+
+static void jsonBuild_begin(jsonBuild_t *jb, void *node, csc_bool_t isArr)
+{   if (jb->nOpen == jb->mOpen)
+    {   jb->mOpen = jb->mOpen * 2 + 16;
+        jb->open = csc_ck_ralloc(jb->open, jb->mOpen*sizeof(*jb->open));
+    }
+    jb->open[jb->nOpen].node = node;
+    jb->open[jb->nOpen].isArr = isArr;
+    jb->open[jb->nOpen].base = jb->nStack;
+    jb->nOpen++;
+}
+
+
+static void jsonBuild_beginObj(void *context)
+{   jsonBuild_t *jb = context;
+    csc_json_t *js = jsonNew(jb->doc);
+    if (jb->nOpen == 0)
+        jb->root = js;
+    else
+        setObj(jsonBuild_push(jb), jb->doc, js);
+    jsonBuild_begin(jb, js, csc_FALSE);
+}
+
+
+static void jsonBuild_beginArr(void *context)
+{   jsonBuild_t *jb = context;
+    csc_jsonArr_t *jas = jsonArrNew(jb->doc);
+    setArr(jsonBuild_push(jb), jb->doc, jas);
+    jsonBuild_begin(jb, jas, csc_TRUE);
+}
+
+
+// Gives the object or array being read the elements pushed since it began.
+static void jsonBuild_end(void *context)
+{   jsonBuild_t *jb = context;
+    int base = jb->open[--jb->nOpen].base;
+    int n = jb->nStack - base;
+    if (jb->open[jb->nOpen].isArr)
+    {   csc_jsonArr_t *jas = jb->open[jb->nOpen].node;
+        if (n > 0)
+        {   jas->els = csc_arena_alloc(jb->doc->arena, n*sizeof(val_t));
+            for (int i=0; i<n; i++)
+                jas->els[i] = jb->stack[base+i].val;
+        }
+        jas->nEls = jas->mEls = n;
+    }
+    else
+    {   csc_json_t *js = jb->open[jb->nOpen].node;
+        if (n > 0)
+        {   js->els = csc_arena_alloc(jb->doc->arena, n*sizeof(memb_t));
+            memcpy(js->els, jb->stack+base, n*sizeof(memb_t));
+        }
+        js->nEls = js->mEls = n;
+    }
+    jb->nStack = base;
+}
+
+
+static void jsonBuild_key(void *context, const char *name, int len)
+{   jsonBuild_t *jb = context;
+    if (jb->isInSitu)
+        jb->name = (char*)name;
+    else
+        jb->name = csc_arena_strn(jb->doc->arena, name, len);
+}
+
+
+static void jsonBuild_null(void *context)
+{   setNull(jsonBuild_push(context));
+}
+static void jsonBuild_bool(void *context, csc_bool_t val)
+{   setBool(jsonBuild_push(context), val);
+}
+static void jsonBuild_int(void *context, int64_t val)
+{   setInt(jsonBuild_push(context), val);
+}
+static void jsonBuild_float(void *context, double val)
+{   setFloat(jsonBuild_push(context), val);
+}
+static void jsonBuild_str(void *context, const char *str, int len)
+{   jsonBuild_t *jb = context;
+    val_t *v = jsonBuild_push(jb);
+    if (jb->isInSitu)
+    {   v->sVal = (char*)str;
+        v->type = csc_jsonType_String;
+    }
+    else
+        setStrn(v, jb->doc->arena, str, len);
+}
+
+
+static void jsonBuild_error(void *context, const char *errMsg, int errPos, int errLinePos)
+{   jsonDoc_setErr(((jsonBuild_t*)context)->doc, errMsg, errPos, errLinePos);
+}
+
+
+static const csc_jsonSax_t jsonBuild_sax =
+{   jsonBuild_beginObj
+,   jsonBuild_end
+,   jsonBuild_beginArr
+,   jsonBuild_end
+,   jsonBuild_key
+,   jsonBuild_null
+,   jsonBuild_bool
+,   jsonBuild_int
+,   jsonBuild_float
+,   jsonBuild_str
+,   jsonBuild_error
+};
+
+
+// Starts building an object in a new arena, which then belongs to it.
+static void jsonBuild_init(jsonBuild_t *jb, csc_bool_t isInSitu)
+{   jb->doc = jsonDoc_new();
+    jb->isInSitu = isInSitu;
+    jb->root = NULL;
+    jb->stack = NULL;
+    jb->nStack = jb->mStack = 0;
+    jb->open = NULL;
+    jb->nOpen = jb->mOpen = 0;
+    jb->name = NULL;
+}
+
+
+// Returns the object, once parsing has stopped.  On EOF there is no
+// object.  After an error, what has been read is kept.
+static csc_json_t *jsonBuild_finish(jsonBuild_t *jb, run_t run)
+{   if (run == run_Eof)
+        csc_arena_free(jb->doc->arena);
+    else if (jb->root == NULL)
+        jb->root = jsonNew(jb->doc);
+    while (jb->nOpen > 0)
+        jsonBuild_end(jb);
  
-// Resources.
-    csc_json_t *obj = NULL;
-    csc_str_t *ident = NULL;
+    if (jb->stack != NULL)
+        free(jb->stack);
+    if (jb->open != NULL)
+        free(jb->open);
+    return jb->root;
+}
+
+
+// Maps how parsing stopped to what is returned to the caller.
+static csc_jsonErr_t runErr(run_t run)
+{   if (run == run_Done)
+        return csc_jsonErr_Ok;
+    else if (run == run_Error)
+        return csc_jsonErr_BadParse;
+    else
+        return csc_jsonErr_Missing;
+}
+
+
+// Reads an object into a new arena, which then belongs to the object.
+static csc_json_t *jsonParse_parse(jsonParse_t *jsp)
+{   jsonBuild_t jb;
+    jsonBuild_init(&jb, jsp->isInSitu);
+    return jsonBuild_finish(&jb, jsonParse_run(jsp, &jsonBuild_sax, &jb));
+}
+
+
+// Parsing a whole buffer, the object is first read in two stages.  The
+// first finds, sixty four bytes at a time, where each brace, bracket,
+// colon, comma, real quote and number or word starts, leaving out what is
+// inside strings.  The second builds the object from those places,
+// without looking at the bytes in between.  The places are found a chunk
+// of the buffer at a time, as the second stage needs them.
+#define NdxChunk 16384
+
+typedef struct
+{   const char *buf;
+    size_t len;
+    size_t pos;                 // Bytes indexed.
+    const char **ents;          // Places found in the last chunk,
+    int nEnts;                  // how many,
+    int iEnt;                   // and the next to be read.
+    uint64_t isEscaped;         // Bit 0 if the next block starts escaped.
+    uint64_t inStr;             // All ones if it starts in a string.
+    uint64_t isScalar;          // Bit 0 if it starts in a number or word.
+    struct                      // Strings to finish in place.
+    {   char *at;               // The closing quote, or the opening one
+        csc_bool_t isEscaped;   // if the string must be decoded.
+    } *fix;
+    int nFix;
+    int mFix;
+} jsonNdx_t;
+
+
+// Each bit becomes the XOR of itself and all those below it, so that the
+// bits from an opening quote up to before its closing quote are set.
+static inline uint64_t prefixXor(uint64_t x)
+{   x ^= x << 1;
+    x ^= x << 2;
+    x ^= x << 4;
+    x ^= x << 8;
+    x ^= x << 16;
+    x ^= x << 32;
+    return x;
+}
+
+
+// Returns the bytes escaped by the backslashes in 'bslash', carrying over
+// to the next block in 'ndx->isEscaped'.
+static uint64_t jsonNdx_escaped(jsonNdx_t *ndx, uint64_t bslash)
+{   uint64_t escaped = ndx->isEscaped;
+    int i;
+    ndx->isEscaped = 0;
+    while (bslash != 0)
+    {   i = __builtin_ctzll(bslash);
+        bslash &= bslash - 1;
+        if (escaped>>i & 1)
+            continue;
+        else if (i == 63)
+            ndx->isEscaped = 1;
+        else
+            escaped |= (uint64_t)2 << i;
+    }
+    return escaped;
+}
+
+
+// Finds the places in the 'n' bytes from 'p', which are at most sixty four.
+static void jsonNdx_block(jsonNdx_t *ndx, const char *p, int n)
+{   char pad[64];
+    classes_t cl;
+    uint64_t valid, quote, inStr, scalar, bits;
  
-// Get first character.
-    int ch = jsp->ch;
+// Classify the bytes.  A short block is made up with spaces.
+    if (n == 64)
+    {   classify(p, &cl);
+        valid = ~(uint64_t)0;
+    }
+    else
+    {   memcpy(pad, p, n);
+        memset(pad+n, ' ', 64-n);
+        classify(pad, &cl);
+        valid = ((uint64_t)1 << n) - 1;
+    }
  
-// Check for EOF.
-	if (ch == EOF)
-	{	return NULL;
-	}
+// Find the real quotes, and so what is in strings.
+    quote = cl.quote & ~jsonNdx_escaped(ndx, cl.bslash & valid) & valid;
+    inStr = prefixXor(quote) ^ ndx->inStr;
+    ndx->inStr = (uint64_t)((int64_t)inStr >> 63);
+ 
+// Find where each number or word starts.
+    scalar = ~(cl.struc | cl.space | quote) & ~inStr & valid;
+    bits = scalar & ~(scalar << 1 | ndx->isScalar);
+    ndx->isScalar = scalar >> 63;
+ 
+// Add the places in order.
+    bits |= (cl.struc & ~inStr & valid) | quote;
+    while (bits != 0)
+    {   ndx->ents[ndx->nEnts++] = p + __builtin_ctzll(bits);
+        bits &= bits - 1;
+    }
+}
+
+
+// Finds the places in the next chunk that has any.
+static void jsonNdx_fill(jsonNdx_t *ndx)
+{   size_t end;
+    ndx->nEnts = ndx->iEnt = 0;
+    while (ndx->nEnts==0 && ndx->pos<ndx->len)
+    {   end = ndx->len-ndx->pos > NdxChunk ? ndx->pos+NdxChunk : ndx->len;
+        for (; ndx->pos<end; ndx->pos+=64)
+            jsonNdx_block( ndx, ndx->buf+ndx->pos
+                         , end-ndx->pos > 64 ? 64 : (int)(end-ndx->pos));
+        ndx->pos = end;
+    }
+}
+
+
+// Returns the next place, or NULL at the end of the buffer.
+static const char *jsonNdx_peek(jsonNdx_t *ndx)
+{   if (ndx->iEnt == ndx->nEnts)
+    {   jsonNdx_fill(ndx);
+        if (ndx->nEnts == 0)
+            return NULL;
+    }
+    return ndx->ents[ndx->iEnt];
+}
+
+static const char *jsonNdx_next(jsonNdx_t *ndx)
+{   const char *p = jsonNdx_peek(ndx);
+    if (p != NULL)
+        ndx->iEnt++;
+    return p;
+}
+
+
+// Reads the string whose opening quote is at 'open'.  Returns its bytes
+// in the buffer if there are no escapes, or else decoded in 'jsp->tok',
+// and sets '*len' to its length.  Parsing in place, the string is left to
+// be finished once the whole object has been read.  Returns NULL if the
+// string is bad.
+static const char *jsonNdx_readStr( jsonNdx_t *ndx, jsonParse_t *jsp
+                                  , const char *open, int *len)
+{   const char *close = jsonNdx_next(ndx);
+    csc_bool_t isEscaped;
  
-// Its not EOF, so we need to allocate.
-    obj = csc_json_new();
-    ident = csc_str_new(NULL);
+// Nothing in a string is a place, so the next is its closing quote.
+    if (close == NULL)
+        return NULL;
+    isEscaped = memchr(open+1, '\\', close-open-1) != NULL;
+    if (isEscaped)
+    {   jsp->p = open + 1;
+        jsp->tokLen = 0;
+        jsp->tok[0] = '\0';
+        if (!jsonParse_readStrRest(jsp) || jsp->p!=close+1)
+            return NULL;
+    }
  
-// Is it really an object.
-	if (ch != '{')
-	{	char errStr[99];
-		sprintf(errStr, "%s %d", "Expected Opening Brace.  Got char #", ch);
-		csc_json_setErr(obj, errStr, jsp->charPos, jsp->lineNo);
-		goto cleanup;
-	}
+// Parsing in place, the string will end where it starts now.
+    if (jsp->isInSitu)
+    {   if (ndx->nFix == ndx->mFix)
+        {   ndx->mFix = ndx->mFix * 2 + 64;
+            ndx->fix = csc_ck_ralloc(ndx->fix, ndx->mFix*sizeof(*ndx->fix));
+        }
+        ndx->fix[ndx->nFix].at = (char*)(isEscaped ? open : close);
+        ndx->fix[ndx->nFix].isEscaped = isEscaped;
+        ndx->nFix++;
+        *len = isEscaped ? jsp->tokLen : (int)(close-open-1);
+        return open + 1;
+    }
+    else if (isEscaped)
+    {   *len = jsp->tokLen;
+        return jsp->tok;
+    }
+    else
+    {   *len = (int)(close-open-1);
+        return open + 1;
+    }
+}
+
+
+// Reads the number or word that starts at 'p'.  It must be followed by
+// white space up to the next place.
+static csc_bool_t jsonNdx_readScalar( jsonNdx_t *ndx, jsonParse_t *jsp
+                                    , const char *p, val_t *val)
+{   const char *next;
+    int ch = (csc_uchar)*p;
+    jsp->p = p;
+    if (islower(ch))
+    {   if (!jsonParse_readPlainWord(jsp, val))
+            return csc_FALSE;
+    }
+    else if (isdigit(ch) || ch=='-')
+    {   if (!jsonParse_readNum(jsp, val))
+            return csc_FALSE;
+    }
+    else
+        return csc_FALSE;
+    next = jsonNdx_peek(ndx);
+    if (next == NULL)
+        next = jsp->end;
+    return jsp->p<=next && skipSpace(jsp->p, next)==next;
+}
+
+
+// Builds the object from the places found, with the same grammar as
+// jsonParse_run().  Returns FALSE if anything is not as expected,
+// including what jsonParse_run() allows but is not JSON.
+static csc_bool_t jsonNdx_build(jsonNdx_t *ndx, jsonParse_t *jsp, jsonBuild_t *jb)
+{   const char *p, *str;
+    expect_t expect;
+    csc_bool_t isArr;
+    val_t val;
+    int ch, len;
  
+    if ((p=jsonNdx_next(ndx))==NULL || *p!='{')
+        return csc_FALSE;
+    jsonBuild_beginObj(jb);
+    expect = expect_Key;
+    for (;;)
+    {   if ((p=jsonNdx_next(ndx)) == NULL)
+            return csc_FALSE;
+        ch = *p;
+        isArr = jb->open[jb->nOpen-1].isArr;
+        switch (expect)
+        {   case expect_Key:
+                if (ch == '}')
+                    goto endNest;
+                else if (ch != '\"')
+                    return csc_FALSE;
+                if ((str=jsonNdx_readStr(ndx, jsp, p, &len)) == NULL)
+                    return csc_FALSE;
+                jsonBuild_key(jb, str, len);
+                if ((p=jsonNdx_next(ndx))==NULL || *p!=':')
+                    return csc_FALSE;
+                expect = expect_MembVal;
+                continue;
+ 
+            case expect_ArrVal:
+                if (ch == ']')
+                    goto endNest;
+            // Fall through.
+            case expect_MembVal:
+                if (ch == '{')
+                {   jsonBuild_beginObj(jb);
+                    expect = expect_Key;
+                    continue;
+                }
+                else if (ch == '[')
+                {   jsonBuild_beginArr(jb);
+                    expect = expect_ArrVal;
+                    continue;
+                }
+                else if (ch == '\"')
+                {   if ((str=jsonNdx_readStr(ndx, jsp, p, &len)) == NULL)
+                        return csc_FALSE;
+                    jsonBuild_str(jb, str, len);
+                }
+                else if (jsonNdx_readScalar(ndx, jsp, p, &val))
+                    *jsonBuild_push(jb) = val;
+                else
+                    return csc_FALSE;
+                expect = expect_Next;
+                continue;
  
-// Look at next character.
-    jsonParse_nextChar(jsp);
-    ch = jsonParse_skipSpace(jsp);
-    while (isContinue)
-    {
-        if (ch == '}')
-        {
-            ch = jsonParse_nextChar(jsp);
-            isContinue = csc_FALSE;
+            default:
+                if (ch == ',')
+                {   expect = isArr ? expect_ArrVal : expect_Key;
+                    continue;
+                }
+                else if (ch != (isArr ? ']' : '}'))
+                    return csc_FALSE;
         }
-        else if (ch=='\"' || isalpha(ch))
-        {
-            isOK = jsonParse_readIdent(jsp, ident);
-            if (!isOK)
-            {
-                csc_json_setErr(obj, "Expected Ident", jsp->charPos, jsp->lineNo);
-                break;
-            }
- 
-        // Now we expect a colon.
-            ch = jsonParse_skipSpace(jsp);
-            if (ch != ':')
-            {
-                isOK = csc_FALSE;
-                csc_json_setErr(obj, "Expected Colon", jsp->charPos, jsp->lineNo);
-                break;
-            }
-            jsonParse_nextChar(jsp);
- 
-        // Now we expect an element.
-            ch = jsonParse_skipSpace(jsp);
-            elem_t elem;
-            isOK = jsonParse_readElem(jsp, &elem);
-            if (!isOK)
-            {   csc_json_setErr(obj, "Expected Element", jsp->charPos, jsp->lineNo);
-                break;
-            }
  
-        // Add element to the object.
-            csc_json_addVal(obj, elem.type, csc_str_charr(ident), elem.val);
+    // Leave the object or array.
+    endNest:
+        jsonBuild_end(jb);
+        if (jb->nOpen == 0)
+            return csc_TRUE;
+        expect = expect_Next;
+    }
+}
+
+
+// Reads an object from the whole of 'buf' in two stages, or returns NULL
+// if they cannot, in which case nothing has been changed.
+static csc_json_t *jsonNdx_parse(const char *buf, size_t len, csc_bool_t isInSitu)
+{   jsonParse_t *jsp = jsonParse_new(buf, len, NULL);
+    csc_json_t *js = NULL;
+    jsonBuild_t jb;
+    jsonNdx_t ndx;
+    int strLen;
  
-        // Now we expect a comma or an ending brace.
-            ch = jsonParse_skipSpace(jsp);
-            if (ch == ',')
-            {   jsonParse_nextChar(jsp);
-                ch = jsonParse_skipSpace(jsp);
-            }
-            else if (ch == '}')
-            {
-            }
+// Allocate resources.
+    jsp->isInSitu = isInSitu;
+    jsonBuild_init(&jb, isInSitu);
+    ndx.buf = buf;
+    ndx.len = len;
+    ndx.pos = 0;
+    ndx.ents = csc_allocMany(const char*, NdxChunk);
+    ndx.nEnts = ndx.iEnt = 0;
+    ndx.isEscaped = ndx.inStr = ndx.isScalar = 0;
+    ndx.fix = NULL;
+    ndx.nFix = ndx.mFix = 0;
+ 
+// Build the object, and finish its strings in place.
+    if (jsonNdx_build(&ndx, jsp, &jb))
+    {   for (int i=0; i<ndx.nFix; i++)
+        {   if (!ndx.fix[i].isEscaped)
+                *ndx.fix[i].at = '\0';
             else
-            {   csc_json_setErr(obj, "Expected comma or ending brace", jsp->charPos, jsp->lineNo);
-                break;
+            {   jsp->p = ndx.fix[i].at;
+                jsonParse_readStringInSitu(jsp, &strLen);
             }
- 
-        }
-        else  // No ending brace and no identifier.
-        {   isOK = csc_FALSE;
-            csc_json_setErr( obj, "Expected ending brace or new identifier"
-                           , jsp->charPos, jsp->lineNo
-                           );
-            isContinue = csc_FALSE;
         }
+        js = jsonBuild_finish(&jb, run_Done);
+    }
+    else
+    {   jb.nOpen = 0;
+        jsonBuild_finish(&jb, run_Eof);
     }
  
 // Free resources.
-cleanup:
-    csc_str_free(ident);
- 
-// Return result.
-    return obj;
+    free(ndx.ents);
+    if (ndx.fix != NULL)
+        free(ndx.fix);
+    jsonParse_free(jsp);
+    return js;
 }
 
 
 csc_json_t *csc_json_newParseStr(const char *str)
+{   size_t len = strlen(str);
+ 
+// Try the two stages.
+    csc_json_t *js = jsonNdx_parse(str, len, csc_FALSE);
+    if (js != NULL)
+        return js;
+ 
+// Allocate resources.
+    jsonParse_t *jsp = jsonParse_new(str, len, NULL);
+ 
+// Parse the object, which reports any error.
+    js = jsonParse_parse(jsp);
+ 
+// Free resources.
+    jsonParse_free(jsp);
+ 
+// Return.
+    return js;
+}
+
+
+csc_json_t *csc_json_newParseInSitu(char *buf, size_t len)
 {
+// Try the two stages.
+    csc_json_t *js = jsonNdx_parse(buf, len, csc_TRUE);
+    if (js != NULL)
+        return js;
+ 
 // Allocate resources.
-    readCharStr_t *rcs = readCharStr_new(str);
-    readCharAny_t *rca = readCharAny_new(readCharStr, (void*)rcs);
-    jsonParse_t *jsp = jsonParse_new(rca);
+    jsonParse_t *jsp = jsonParse_new(buf, len, NULL);
+    jsp->isInSitu = csc_TRUE;
  
-// Parse the object.
-    jsonParse_skipSpace(jsp);
-    csc_json_t *js = jsonParse_readObj(jsp);
+// Parse the object, which reports any error.
+    js = jsonParse_parse(jsp);
  
 // Free resources.
     jsonParse_free(jsp);
-    readCharAny_free(rca);
-    readCharStr_free(rcs);
  
 // Return.
     return js;
@@ -1193,22 +2773,141 @@ csc_json_t *csc_json_newParseStr(const char *str)
 csc_json_t *csc_json_newParseFILE(FILE *fin)
 {
 // Allocate resources.
-    readCharAny_t *rca = readCharAny_new(readCharFile, (void*)fin);
-    jsonParse_t *jsp = jsonParse_new(rca);
+    flockfile(fin);
+    jsonParse_t *jsp = jsonParse_new(NULL, 0, fin);
  
 // Parse the object.
-    jsonParse_skipSpace(jsp);
-    csc_json_t *js = jsonParse_readObj(jsp);
+    csc_json_t *js = jsonParse_parse(jsp);
  
 // Free resources.
     jsonParse_free(jsp);
-    readCharAny_free(rca);
+    funlockfile(fin);
  
 // Return.
     return js;
 }
 
 
+csc_jsonErr_t csc_json_saxFILE(FILE *fin, const csc_jsonSax_t *sax, void *context)
+{   csc_jsonErr_t errNum;
+    flockfile(fin);
+    jsonParse_t *jsp = jsonParse_new(NULL, 0, fin);
+    errNum = runErr(jsonParse_run(jsp, sax, context));
+    jsonParse_free(jsp);
+    funlockfile(fin);
+    return errNum;
+}
+
+
+csc_jsonErr_t csc_json_saxStr(const char *str, const csc_jsonSax_t *sax, void *context)
+{   csc_jsonErr_t errNum;
+    jsonParse_t *jsp = jsonParse_new(str, strlen(str), NULL);
+    errNum = runErr(jsonParse_run(jsp, sax, context));
+    jsonParse_free(jsp);
+    return errNum;
+}
+
+
+struct csc_jsonPush_s
+{   jsonParse_t *jsp;       // Its block is the bytes pushed and not yet read.
+    size_t mBuf;
+    const csc_jsonSax_t *sax;
+    void *context;
+    csc_bool_t isBuild;     // Building a csc_json_t with 'jb'.
+    jsonBuild_t jb;
+    csc_json_t *js;         // The object built, until it is taken.
+    csc_bool_t isBegun;     // An object is part way through.
+    csc_jsonErr_t errNum;   // Of the last call to csc_jsonPush_feed().
+};
+
+
+csc_jsonPush_t *csc_jsonPush_new(const csc_jsonSax_t *sax, void *context)
+{   csc_jsonPush_t *jp = csc_allocOne(csc_jsonPush_t);
+    jp->mBuf = 0;
+    jp->jsp = jsonParse_new(NULL, 0, NULL);
+    jp->jsp->isPush = csc_TRUE;
+    jp->isBuild = sax == NULL;
+    if (jp->isBuild)
+    {   jp->sax = &jsonBuild_sax;
+        jp->context = &jp->jb;
+    }
+    else
+    {   jp->sax = sax;
+        jp->context = context;
+    }
+    jp->js = NULL;
+    jp->isBegun = csc_FALSE;
+    jp->errNum = csc_jsonErr_Missing;
+    return jp;
+}
+
+
+csc_jsonErr_t csc_jsonPush_feed(csc_jsonPush_t *jp, const char *bytes, size_t len)
+{   jsonParse_t *jsp = jp->jsp;
+    size_t nKeep;
+    run_t run;
+ 
+// After an error there is nothing more to be read.
+    if (jp->errNum == csc_jsonErr_BadParse)
+        return csc_jsonErr_BadParse;
+ 
+// Move the bytes not yet read to the start of the block, counting those
+// that are dropped, and add the new ones after them.
+    nKeep = jsp->end - jsp->p;
+    if (jsp->buf != NULL)
+    {   jsp->blkPos += jsp->p - jsp->blk;
+        jsp->blkLines += countLines(jsp->lineMark, jsp->p);
+        memmove(jsp->buf, jsp->p, nKeep);
+    }
+    if (nKeep+len > jp->mBuf)
+    {   jp->mBuf = (nKeep+len) * 2 + 1024;
+        jsp->buf = csc_ck_ralloc(jsp->buf, jp->mBuf);
+    }
+    if (len > 0)
+        memcpy(jsp->buf+nKeep, bytes, len);
+    jsp->blk = jsp->p = jsp->lineMark = jsp->buf;
+    jsp->end = jsp->buf + nKeep + len;
+ 
+// Start a new object, dropping the last one if it was not taken.
+    if (!jp->isBegun)
+    {   if (jp->isBuild)
+        {   if (jp->js != NULL)
+                csc_json_free(jp->js);
+            jp->js = NULL;
+            jsonBuild_init(&jp->jb, csc_FALSE);
+        }
+        jp->isBegun = csc_TRUE;
+    }
+ 
+// Read as far as possible.
+    run = jsonParse_run(jsp, jp->sax, jp->context);
+    if (run != run_Starved)
+    {   if (jp->isBuild)
+            jp->js = jsonBuild_finish(&jp->jb, run);
+        jp->isBegun = csc_FALSE;
+    }
+    jp->errNum = runErr(run);
+    return jp->errNum;
+}
+
+
+csc_json_t *csc_jsonPush_takeObj(csc_jsonPush_t *jp)
+{   csc_json_t *js = jp->js;
+    jp->js = NULL;
+    return js;
+}
+
+
+void csc_jsonPush_free(csc_jsonPush_t *jp)
+{   if (jp->isBegun && jp->isBuild)
+        jp->js = jsonBuild_finish(&jp->jb, run_Error);
+    if (jp->js != NULL)
+        csc_json_free(jp->js);
+    jsonParse_free(jp->jsp);
+    free(jp);
+}
+
+
 // void main(int argc, char **argv)
 // {    char *str = "{ name: \"fred\", age: 23, isMale:false, mary:null\n"
 //              ", stats:{ height: 45, weight:35.45}\n"
@@ -1230,30 +2929,6 @@ csc_json_t *csc_json_newParseFILE(FILE *fin)
 // }
 
 
-// void main(int argc, char **argv)
-// {    int ch;
-//  
-//  // Test reading from a string.
-//  {   char *testStr = "Hello from a string.\n";
-//      readCharStr_t *rcs = readCharStr_new(testStr);
-//      readCharAny_t *rca = readCharAny_new(readCharStr, (void*)rcs);
-//      while ((ch=readCharAny_getc(rca)) != EOF)
-//          putchar(ch);
-//      readCharAny_free(rca);
-//      readCharStr_free(rcs);
-//  }
-//  
-//  // Test reading from a stream.
-//  {   readCharAny_t *rca = readCharAny_new(readCharFile, (void*)stdin);
-//      while ((ch=readCharAny_getc(rca)) != EOF)
-//          putchar(ch);
-//      readCharAny_free(rca);
-//  }
-//  
-//  exit(0);
-// }
-
-
 #if 0
 void main(int argc, char **argv)
 {   csc_jsonErr_t errNum;
@@ -1310,3 +2985,4 @@ void main(int argc, char **argv)
     exit(0);
 }
 #endif
+
@@ -1,7 +1,11 @@
 // Author: Dr Stephen Braithwaite.
 // This work is licensed under a Creative Commons Attribution-ShareAlike 4.0 International License.
 
+#ifndef csc_JSON_H
+#define csc_JSON_H 1
+
 #include <stdio.h>
+#include <stdint.h>
 #include "std.h"
 #include "cstr.h"
 
@@ -38,6 +42,12 @@ typedef enum csc_jsonType_e
 // Create an empty JSON object.
 csc_json_t *csc_json_new();
 
+// Create an empty JSON object in an arena.  Its elements and strings, and
+// the objects and arrays made with csc_json_addNewObj() and the like, are
+// allocated from the arena, and csc_json_free() frees them all at once.
+// The objects returned by the parsers are made the same way.
+csc_json_t *csc_json_newArena();
+
 // Create a JSON object by reading one from an input stream.
 // Returns NULL on EOF.
 csc_json_t *csc_json_newParseFILE(FILE *fin);
@@ -46,6 +56,12 @@ csc_json_t *csc_json_newParseFILE(FILE *fin);
 // Returns NULL on EOF.
 csc_json_t *csc_json_newParseStr(const char *str);
 
+// Create a JSON object by reading one from the 'len' bytes at 'buf',
+// without copying its names and strings.  They are decoded in place, so
+// 'buf' is changed, and the object points into it.  'buf' must not be
+// freed or changed until the object has been freed.  Returns NULL on EOF.
+csc_json_t *csc_json_newParseInSitu(char *buf, size_t len);
+
 // ... Error feedback ...
 
 // Gets a description of error.
@@ -74,12 +90,116 @@ void csc_jsonArr_free(csc_jsonArr_t *ja);
 
 //------- Input and output -------------
 
-// Write a JSON object to a string.
+// Write a JSON object to a string.  A float that is infinite or NaN, e.g.
+// from reading 1E400, is written as null.
 void csc_json_writeCstr(const csc_json_t *js, csc_str_t *cstr);
 
-// Write a JSON object to a stream.
+// Write a JSON object to a stream.  As for csc_json_writeCstr().
 void csc_json_writeFILE(const csc_json_t *js, FILE *fout);
 
+// What to do with each thing read from a JSON object, for reading it
+// without building a csc_json_t.  Any of these may be NULL.  Each is
+// given the 'context' passed to the parser.  Names and strings are only
+// valid during the call, and their lengths are in bytes.
+typedef struct csc_jsonSax_s
+{   void (*beginObj)(void *context);
+    void (*endObj)(void *context);
+    void (*beginArr)(void *context);
+    void (*endArr)(void *context);
+    void (*key)(void *context, const char *name, int len);
+    void (*nullVal)(void *context);
+    void (*boolVal)(void *context, csc_bool_t val);
+    void (*intVal)(void *context, int64_t val);
+    void (*floatVal)(void *context, double val);
+    void (*strVal)(void *context, const char *val, int len);
+    void (*error)(void *context, const char *errMsg, int errPos, int errLinePos);
+} csc_jsonSax_t;
+
+// Read one JSON object from an input stream, calling 'sax' with what is in
+// it as it is read, and keeping no more than the object's nesting.
+// Returns csc_jsonErr_Ok if the whole object was read, csc_jsonErr_Missing
+// on EOF, or csc_jsonErr_BadParse on an error, after calling 'sax->error'.
+csc_jsonErr_t csc_json_saxFILE(FILE *fin, const csc_jsonSax_t *sax, void *context);
+
+// Read one JSON object from a string.  As for csc_json_saxFILE().
+csc_jsonErr_t csc_json_saxStr(const char *str, const csc_jsonSax_t *sax, void *context);
+
+// A parser that is given bytes as they arrive, e.g. from a non-blocking
+// socket, rather than reading them itself.
+typedef struct csc_jsonPush_s csc_jsonPush_t;
+
+// Creates a push parser that calls 'sax' with what it reads, or if 'sax'
+// is NULL, builds a csc_json_t.
+csc_jsonPush_t *csc_jsonPush_new(const csc_jsonSax_t *sax, void *context);
+
+// Reads the 'len' bytes at 'bytes', carrying on from where the last call
+// left off.  Bytes may be split anywhere, even part way through a string or
+// number.  Returns csc_jsonErr_Missing if more bytes are needed,
+// csc_jsonErr_Ok if an object has been read, or csc_jsonErr_BadParse on an
+// error, and for every call after it.  Bytes after the end of an object
+// are kept, and the next call, with or without more bytes, reads the next
+// object from them.
+csc_jsonErr_t csc_jsonPush_feed(csc_jsonPush_t *jp, const char *bytes, size_t len);
+
+// Returns the object built, after csc_jsonPush_feed() has returned
+// csc_jsonErr_Ok or csc_jsonErr_BadParse, or NULL.  It then belongs to the
+// caller.  If it is not taken, it is freed when the next object is begun.
+csc_json_t *csc_jsonPush_takeObj(csc_jsonPush_t *jp);
+
+// Frees the parser, and any object it has not given up.
+void csc_jsonPush_free(csc_jsonPush_t *jp);
+
+// A writer of JSON text, called for each thing in turn, for writing
+// without building a csc_json_t.  It keeps track of nesting and commas,
+// and in debug builds asserts that what it is told to write is valid JSON.
+typedef struct csc_jsonWriter_s csc_jsonWriter_t;
+
+// Creates a writer that keeps what is written, for csc_jsonWriter_buf().
+csc_jsonWriter_t *csc_jsonWriter_new();
+
+// Creates a writer that appends to 'cstr' each time a whole value has been
+// written, and when its buffer is full.
+csc_jsonWriter_t *csc_jsonWriter_newStr(csc_str_t *cstr);
+
+// Creates a writer that writes to the file descriptor 'fd' each time a
+// whole value has been written, and when its buffer is full.
+csc_jsonWriter_t *csc_jsonWriter_newFd(int fd);
+
+// Begin and end an object or an array.
+void csc_jsonWriter_beginObj(csc_jsonWriter_t *jw);
+void csc_jsonWriter_endObj(csc_jsonWriter_t *jw);
+void csc_jsonWriter_beginArr(csc_jsonWriter_t *jw);
+void csc_jsonWriter_endArr(csc_jsonWriter_t *jw);
+
+// Write the name of the next member of an object, before its value.
+void csc_jsonWriter_key(csc_jsonWriter_t *jw, const char *name);
+
+// Write a value, as a member of an object after its key, as an element of
+// an array, or on its own.  A NULL 'val', or a float that is infinite or
+// NaN, is written as null.  The 'len'
+// bytes at 'val' need not end with a '\0'.
+void csc_jsonWriter_null(csc_jsonWriter_t *jw);
+void csc_jsonWriter_bool(csc_jsonWriter_t *jw, csc_bool_t val);
+void csc_jsonWriter_int(csc_jsonWriter_t *jw, int64_t val);
+void csc_jsonWriter_float(csc_jsonWriter_t *jw, double val);
+void csc_jsonWriter_str(csc_jsonWriter_t *jw, const char *val);
+void csc_jsonWriter_strn(csc_jsonWriter_t *jw, const char *val, size_t len);
+
+// Returns what has been written and not yet passed on, ending with a
+// '\0', and sets '*len' to its length if 'len' is not NULL.
+const char *csc_jsonWriter_buf(csc_jsonWriter_t *jw, size_t *len);
+
+// Passes on what has been written to the string or file descriptor.
+// Returns csc_FALSE if writing to the file descriptor has failed.
+csc_bool_t csc_jsonWriter_flush(csc_jsonWriter_t *jw);
+
+// Forgets what has been written and not passed on, so that the writer
+// can be used again without allocating.
+void csc_jsonWriter_reset(csc_jsonWriter_t *jw);
+
+// Passes on what has been written, and frees the writer.
+void csc_jsonWriter_free(csc_jsonWriter_t *jw);
+
 
 //------- Add to a JSON object -------------
 
@@ -96,6 +216,9 @@ void csc_json_addBool(csc_json_t *js, const char *name, csc_bool_t val);
 // Add an integer value to a JSON object.
 void csc_json_addInt(csc_json_t *js, const char *name, int val);
 
+// Add a 64 bit integer value to a JSON object.
+void csc_json_addInt64(csc_json_t *js, const char *name, int64_t val);
+
 // Add an floating value to a JSON object.
 void csc_json_addFloat(csc_json_t *js, const char *name, double val);
 
@@ -107,6 +230,15 @@ void csc_json_addObj(csc_json_t *parent, const char *name, csc_json_t *child);
 // object OWNS the child, and freeing the object will free the array.
 void csc_json_addArr(csc_json_t *js, const char *name, csc_jsonArr_t *arr);
 
+// Add a new empty child JSON object to a JSON object, and return it to be
+// filled in.  The child is allocated as the parent is, in the same arena if
+// it has one, and belongs to the parent.
+csc_json_t *csc_json_addNewObj(csc_json_t *js, const char *name);
+
+// Add a new empty JSON array to a JSON object, and return it to be filled
+// in.  As for csc_json_addNewObj().
+csc_jsonArr_t *csc_json_addNewArr(csc_json_t *js, const char *name);
+
 
 //------- Get from a JSON object -------------
 
@@ -125,9 +257,15 @@ const char *csc_json_getStr(const csc_json_t *js, const char *name, csc_jsonErr_
 csc_bool_t csc_json_getBool(const csc_json_t *js, const char *name, csc_jsonErr_t *errNum);
 
 // Get an integer value from a JSON object.
-// Returns 0 if returned errNum is not csc_jsonErr_Ok.
+// Returns 0 if returned errNum is not csc_jsonErr_Ok.  It is
+// csc_jsonErr_OutOfRange if the value does not fit in an int.
 int csc_json_getInt(const csc_json_t *js, const char *name, csc_jsonErr_t *errNum);
 
+// Get a 64 bit integer value from a JSON object.  Integers are read as 64
+// bits, and one too big for that is read as a floating value.
+// Returns 0 if returned errNum is not csc_jsonErr_Ok.
+int64_t csc_json_getInt64(const csc_json_t *js, const char *name, csc_jsonErr_t *errNum);
+
 // Get a floating value from a JSON object.
 // Returns 0 if returned errNum is not csc_jsonErr_Ok.
 double csc_json_getFloat(const csc_json_t *js, const char *name, csc_jsonErr_t *errNum);
@@ -159,6 +297,7 @@ csc_jsonType_t csc_json_ndxType(const csc_json_t *js, int ndx);
 
 // Get a string value from a JSON object.
 // The caller may inspect, but not alter or free the returned string.
+// It becomes invalid as for csc_json_getStr().
 // Returns NULL if returned errNum is not csc_jsonErr_Ok.
 const char *csc_json_ndxStr(const csc_json_t *js, int ndx, csc_jsonErr_t *errNum);
 
@@ -167,9 +306,15 @@ const char *csc_json_ndxStr(const csc_json_t *js, int ndx, csc_jsonErr_t *errNum
 csc_bool_t csc_json_ndxBool(const csc_json_t *js, int ndx, csc_jsonErr_t *errNum);
 
 // Get an integer value from a JSON object.
-// Returns 0 if returned errNum is not csc_jsonErr_Ok.
+// Returns 0 if returned errNum is not csc_jsonErr_Ok.  It is
+// csc_jsonErr_OutOfRange if the value does not fit in an int.
 int csc_json_ndxInt(const csc_json_t *js, int ndx, csc_jsonErr_t *errNum);
 
+// Get a 64 bit integer value from a JSON object.  Integers are read as 64
+// bits, and one too big for that is read as a floating value.
+// Returns 0 if returned errNum is not csc_jsonErr_Ok.
+int64_t csc_json_ndxInt64(const csc_json_t *js, int ndx, csc_jsonErr_t *errNum);
+
 // Get a floating value from a JSON object.
 // Returns 0 if returned errNum is not csc_jsonErr_Ok.
 double csc_json_ndxFloat(const csc_json_t *js, int ndx, csc_jsonErr_t *errNum);
@@ -201,6 +346,9 @@ void csc_jsonArr_apndBool(csc_jsonArr_t *js, csc_bool_t val);
 // Append an integer value to a JSON array.
 void csc_jsonArr_apndInt(csc_jsonArr_t *js, int val);
 
+// Append a 64 bit integer value to a JSON array.
+void csc_jsonArr_apndInt64(csc_jsonArr_t *jas, int64_t val);
+
 // Append an floating value to a JSON array.
 void csc_jsonArr_apndFloat(csc_jsonArr_t *js, double val);
 
@@ -212,6 +360,14 @@ void csc_jsonArr_apndObj(csc_jsonArr_t *parent, csc_json_t *obj);
 // parent OWNS the child, and freeing the parent will free the child.
 void csc_jsonArr_apndArr(csc_jsonArr_t *parent, csc_jsonArr_t *child);
 
+// Append a new empty JSON object to a JSON array, and return it to be
+// filled in.  As for csc_json_addNewObj().
+csc_json_t *csc_jsonArr_apndNewObj(csc_jsonArr_t *jas);
+
+// Append a new empty child JSON array to a JSON array, and return it to be
+// filled in.  As for csc_json_addNewObj().
+csc_jsonArr_t *csc_jsonArr_apndNewArr(csc_jsonArr_t *jas);
+
 
 //------- Get from a JSON array -------------
 
@@ -224,6 +380,7 @@ csc_jsonType_t csc_jsonArr_getType(const csc_jsonArr_t *jas, int ndx);
 
 // Get a string value from a JSON array.
 // The caller may inspect, but not alter or free the returned string.
+// Returned value is freed and becomes invalid if JSON array is freed.
 // Returns NULL if returned errNum is not csc_jsonErr_Ok.
 const char *csc_jsonArr_getStr(const csc_jsonArr_t *jas, int ndx, csc_jsonErr_t *errNum);
 
@@ -232,9 +389,15 @@ const char *csc_jsonArr_getStr(const csc_jsonArr_t *jas, int ndx, csc_jsonErr_t
 csc_bool_t csc_jsonArr_getBool(const csc_jsonArr_t *jas, int ndx, csc_jsonErr_t *errNum);
 
 // Get an integer value from a JSON array.
-// Returns 0 if returned errNum is not csc_jsonErr_Ok.
+// Returns 0 if returned errNum is not csc_jsonErr_Ok.  It is
+// csc_jsonErr_OutOfRange if the value does not fit in an int.
 int csc_jsonArr_getInt(const csc_jsonArr_t *jas, int ndx, csc_jsonErr_t *errNum);
 
+// Get a 64 bit integer value from a JSON array.  Integers are read as 64
+// bits, and one too big for that is read as a floating value.
+// Returns 0 if returned errNum is not csc_jsonErr_Ok.
+int64_t csc_jsonArr_getInt64(const csc_jsonArr_t *jas, int ndx, csc_jsonErr_t *errNum);
+
 // Get a floating value from a JSON array.
 // Returns 0 if returned errNum is not csc_jsonErr_Ok.
 double csc_jsonArr_getFloat(const csc_jsonArr_t *jas, int ndx, csc_jsonErr_t *errNum);
@@ -249,4 +412,5 @@ const csc_json_t *csc_jsonArr_getObj(const csc_jsonArr_t *jas, int ndx, csc_json
 // Returns NULL if returned errNum is not csc_jsonErr_Ok.
 const csc_jsonArr_t *csc_jsonArr_getArr(const csc_jsonArr_t *jas, int ndx, csc_jsonErr_t *errNum);
 
+#endif
 
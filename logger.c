@@ -2,19 +2,41 @@
 // This work is licensed under a Creative Commons Attribution-ShareAlike 4.0 International License.
 
 #include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/file.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <signal.h>
 #include <semaphore.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
 #include <stdarg.h>
 #include <assert.h>
+#include <stdint.h>
+#include <math.h>
 
 #include "std.h"
 #include "alloc.h"
+#include "list.h"
+#include "numConv.h"
+#include "json.h"
 #include "logger.h"
 
+#define MaxRotateSuffixLen 12
+#define RecSlotLen 256
+
+
+// A growable buffer for formatting entries.  Reused from entry to entry.
+typedef struct logBuf_s
+{   char *chars;
+    int n;
+    int m;
+    csc_bool_t isFixed;  // Truncate rather than grow.
+} logBuf_t;
 
 
 typedef struct csc_log_t
@@ -23,7 +45,93 @@ typedef struct csc_log_t
     csc_log_level_t level;
     csc_bool_t isShowProcessId;
     sem_t sem;
-} csc_log_t;    
+ 
+// The log file is held open for append.  -1 if it could not be opened.
+    int fd;
+    volatile sig_atomic_t isReopen;  // Set by csc_log_reopen().
+ 
+// Rotation.
+    off_t rotateBytes;   // Rotate when file reaches this size.  0 for never.
+    int rotateSecs;      // Rotate every this many seconds.  0 for never.
+    int rotateKeep;      // Number of rotated files to retain.
+    time_t rotateNext;   // Time of next rotation by interval.
+    off_t nBytes;        // Size of the file when opened plus bytes written since.
+    csc_bool_t isRotate; // Rotate before the next entry is written.
+ 
+// Each entry is formatted here and then written with a single write().
+    logBuf_t buf;
+    csc_bool_t isJson;  // Entries are JSON objects, one per line.
+ 
+// Named channels.
+    csc_list_t *chans;
+ 
+// Flight recorder.  Each thread has its own ring of the last 'recN' entries.
+    int recN;
+    pthread_key_t recKey;
+    pthread_mutex_t recMutex;
+    struct logRing_s *rings;
+} csc_log_t;
+
+
+// A flight recorder ring.  Holds the last 'nSlots' entries of a thread,
+// each truncated to fit a slot.  Entry 'i' is in slot 'i%nSlots'.  Only
+// the owning thread adds entries, and only recDump() dumps them, so each
+// count has a single writer.  'slots' and 'nSlots' are only changed with
+// 'recMutex' held.
+typedef struct logRing_s
+{   struct logRing_s *next;
+    csc_log_t *logger;
+    int nSlots;
+    unsigned long nAdded;    // Entries added since the ring was sized.
+    unsigned long nDumped;   // Entries before this have been dumped.
+    char *slots;
+} logRing_t;
+
+
+typedef struct csc_logChan_t
+{   csc_log_t *logger;
+    char *name;
+    csc_log_level_t level;  // Zero to follow the level of the logger.
+} csc_logChan_t;
+
+
+static void logOpen(csc_log_t *logger)
+{   struct stat fdStat;
+    logger->fd = open(logger->path, O_WRONLY|O_APPEND|O_CREAT, 0666);
+    logger->nBytes = 0;
+    if (logger->fd>=0 && fstat(logger->fd, &fdStat)==0)
+        logger->nBytes = fdStat.st_size;
+    if (logger->rotateSecs > 0)
+    {   time_t now = time(NULL);
+        logger->rotateNext = (now/logger->rotateSecs + 1) * logger->rotateSecs;
+    }
+}
+
+
+static void logClose(csc_log_t *logger)
+{   if (logger->fd >= 0)
+        close(logger->fd);
+    logger->fd = -1;
+}
+
+
+// Thread exit.  Remove the ring of the thread from the logger and free it.
+static void ringUnlink(void *context)
+{   logRing_t *ring = context;
+    csc_log_t *logger = ring->logger;
+    logRing_t **pp;
+ 
+    pthread_mutex_lock(&logger->recMutex);
+    for (pp=&logger->rings; *pp!=NULL; pp=&(*pp)->next)
+    {   if (*pp == ring)
+        {   *pp = ring->next;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&logger->recMutex);
+    free(ring->slots);
+    free(ring);
+}
 
 
 csc_log_t *csc_log_new(const char *path, csc_log_level_t logLevel)
@@ -40,6 +148,24 @@ csc_log_t *csc_log_new(const char *path, csc_log_level_t logLevel)
     lgr->level = logLevel;
     lgr->idStr = NULL;
     retVal = sem_init(&lgr->sem, 1, 1); assert(retVal==0);
+    lgr->isReopen = csc_FALSE;
+    lgr->rotateBytes = 0;
+    lgr->rotateSecs = 0;
+    lgr->rotateKeep = 0;
+    lgr->rotateNext = 0;
+    lgr->nBytes = 0;
+    lgr->isRotate = csc_FALSE;
+    lgr->buf.chars = NULL;
+    lgr->buf.n = 0;
+    lgr->buf.m = 0;
+    lgr->buf.isFixed = csc_FALSE;
+    lgr->isJson = csc_FALSE;
+    lgr->chans = NULL;
+    lgr->recN = 0;
+    retVal = pthread_key_create(&lgr->recKey, ringUnlink); assert(retVal==0);
+    retVal = pthread_mutex_init(&lgr->recMutex, NULL); assert(retVal==0);
+    lgr->rings = NULL;
+    logOpen(lgr);
  
 // Test the logger with an initial entry.
     lgr->isShowProcessId = csc_TRUE;
@@ -78,68 +204,698 @@ csc_bool_t csc_log_setLogLevel(csc_log_t *logger, csc_log_level_t logLevel)
 }
 
 
+csc_bool_t csc_log_setRotate(csc_log_t *logger, long maxBytes, int intervalSecs, int nKeep)
+{   if (maxBytes<0 || intervalSecs<0 || nKeep<0)
+        return csc_FALSE;
+    sem_wait(&logger->sem);
+    logger->rotateBytes = maxBytes;
+    logger->rotateSecs = intervalSecs;
+    logger->rotateKeep = nKeep;
+    if (intervalSecs > 0)
+    {   time_t now = time(NULL);
+        logger->rotateNext = (now/intervalSecs + 1) * intervalSecs;
+    }
+    sem_post(&logger->sem);
+    return csc_TRUE;
+}
+
+
+void csc_log_reopen(csc_log_t *logger)
+{   logger->isReopen = csc_TRUE;
+}
+
+
+void csc_log_reopenHndl(int sigNum, void *context)
+{   (void)sigNum;
+    csc_log_reopen((csc_log_t*)context);
+}
+
+
+void csc_log_setJsonLines(csc_log_t *logger, csc_bool_t isJson)
+{   logger->isJson = isJson;
+}
+
+
+csc_bool_t csc_log_isOn(csc_log_t *logger, csc_log_level_t logLevel)
+{   return logLevel>=logger->level || logger->recN>0;
+}
+
+
+csc_logChan_t *csc_log_getChan(csc_log_t *logger, const char *name)
+{   csc_list_t *pls;
+    csc_logChan_t *chan;
+ 
+    sem_wait(&logger->sem);
+ 
+// Look for an existing channel.
+    for (pls=logger->chans; pls!=NULL; pls=pls->next)
+    {   chan = pls->data;
+        if (csc_streq(chan->name, name))
+            break;
+    }
+ 
+// Otherwise create it.
+    if (pls == NULL)
+    {   chan = csc_allocOne(csc_logChan_t);
+        chan->logger = logger;
+        chan->name = csc_alloc_str(name);
+        chan->level = 0;
+        csc_list_add(&logger->chans, chan);
+    }
+ 
+    sem_post(&logger->sem);
+    return chan;
+}
+
+
+csc_bool_t csc_log_setChanLevel(csc_log_t *logger, const char *name, csc_log_level_t logLevel)
+{   return csc_logChan_setLevel(csc_log_getChan(logger, name), logLevel);
+}
+
+
+csc_bool_t csc_logChan_setLevel(csc_logChan_t *chan, csc_log_level_t logLevel)
+{   if (logLevel!=0 && (logLevel<csc_log_TRACE || logLevel>csc_log_FATAL))
+        return csc_FALSE;
+    else
+    {   chan->level = logLevel;
+        return csc_TRUE;
+    }
+}
+
+
+static csc_bool_t chanIsOn(csc_logChan_t *chan, csc_log_level_t logLevel)
+{   csc_log_level_t level = chan->level;
+    if (level == 0)
+        level = chan->logger->level;
+    return logLevel >= level;
+}
+
+
+csc_bool_t csc_logChan_isOn(csc_logChan_t *chan, csc_log_level_t logLevel)
+{   return chanIsOn(chan, logLevel) || chan->logger->recN>0;
+}
+
+
+// The count is started again for a new second in the same compare and
+// swap that counts the entry, so threads crossing a second together
+// cannot undo each other's counts.  A thread that read the time before
+// another started a later second counts its entry in the later second.
+csc_bool_t csc_log_rateOk(csc_log_rate_t *rate, int perSec)
+{   unsigned long long sec = (unsigned long long)(uint32_t)time(NULL) << 32;
+    unsigned long long old, new;
+    if (perSec <= 0)
+        return csc_FALSE;
+    do
+    {   old = rate->secCount;
+        if ((old & ~0xFFFFFFFFULL) < sec)
+            new = sec + 1;
+        else if ((old & 0xFFFFFFFFULL) < (unsigned)perSec)
+            new = old + 1;
+        else
+            return csc_FALSE;
+    } while (!__sync_bool_compare_and_swap(&rate->secCount, old, new));
+    return csc_TRUE;
+}
+
+
+csc_bool_t csc_log_sampleOk(unsigned long *count, int k)
+{   return k<=1 || __sync_fetch_and_add(count, 1)%k == 0;
+}
+
+
 void csc_log_free(csc_log_t *logger)
 {   int retVal;
+    csc_list_t *pls;
+    csc_logChan_t *chan;
+    for (pls=logger->chans; pls!=NULL; pls=pls->next)
+    {   chan = pls->data;
+        free(chan->name);
+        free(chan);
+    }
+    csc_list_free(logger->chans);
+    pthread_key_delete(logger->recKey);
+    while (logger->rings != NULL)
+    {   logRing_t *ring = logger->rings;
+        logger->rings = ring->next;
+        free(ring->slots);
+        free(ring);
+    }
+    pthread_mutex_destroy(&logger->recMutex);
+    logClose(logger);
     free(logger->path);
     if (logger->idStr != NULL)
         free(logger->idStr);
+    if (logger->buf.chars != NULL)
+        free(logger->buf.chars);
     retVal = sem_destroy(&logger->sem); assert(retVal==0);
     free(logger);
 }
 
 
-static FILE *logGuts(csc_log_t *logger, csc_log_level_t logLevel, int *retVal)
-{   char timeStr[csc_timeStrSize+1];
+// Shift "path.N-1" to "path.N" and so on down to "path" to "path.1".  The
+// oldest is discarded.  Renames are atomic, so a writer in another process
+// holding the old file open keeps writing to it until it notices.
+static void logShiftFiles(csc_log_t *logger)
+{   int len = strlen(logger->path);
+    char *from = csc_allocMany(char, len+MaxRotateSuffixLen+1);
+    char *to = csc_allocMany(char, len+MaxRotateSuffixLen+1);
+    int i;
  
-// Only log if logLevel is greater or equal to the threshold.
-    if (logLevel < logger->level)
-    {   *retVal = csc_TRUE;
-        return NULL;
+    if (logger->rotateKeep == 0)
+        unlink(logger->path);
+    else
+    {   sprintf(to, "%s.%d", logger->path, logger->rotateKeep);
+        unlink(to);
+        for (i=logger->rotateKeep-1; i>0; i--)
+        {   sprintf(from, "%s.%d", logger->path, i);
+            rename(from, to);
+            strcpy(to, from);
+        }
+        rename(logger->path, to);
     }
+ 
+    free(from);
+    free(to);
+}
 
-// Prevent concurrent write to the logfile.
-    sem_wait(&logger->sem);
+
+// Called with the semaphore held, before each write.  Rotates or reopens
+// the log file if flagged.  The size is kept in 'nBytes' rather than asked
+// of the file, so that entries in between cost nothing.
+static void logCheckRotate(csc_log_t *logger)
+{   struct stat fdStat, pathStat;
  
-// Open the file for append.
-    FILE *fp = fopen(logger->path, "a");
-    if (fp == NULL)
-    {   *retVal = csc_FALSE;
-        return NULL;
+// Is rotation due by interval?  An empty file is left as it is.
+    if (logger->rotateSecs>0 && logger->fd>=0 && time(NULL)>=logger->rotateNext)
+    {   if (logger->nBytes > 0)
+            logger->isRotate = csc_TRUE;
+        else
+            logger->rotateNext = (time(NULL)/logger->rotateSecs + 1) * logger->rotateSecs;
     }
+    if (!logger->isRotate && !logger->isReopen)
+        return;
  
-// Create and format the time.
-    csc_dateTimeStr(timeStr);
+// Serialise rotation with other processes sharing the file, and only
+// rotate if another process has not already done so.
+    if (logger->isRotate && logger->fd>=0 && fstat(logger->fd, &fdStat)==0)
+    {   flock(logger->fd, LOCK_EX);
+        if (  stat(logger->path, &pathStat) == 0
+           && pathStat.st_ino == fdStat.st_ino
+           && pathStat.st_dev == fdStat.st_dev
+           )
+        {   logShiftFiles(logger);
+        }
+        flock(logger->fd, LOCK_UN);
+    }
+ 
+// Carry on with the new file.
+    logger->isRotate = csc_FALSE;
+    logger->isReopen = csc_FALSE;
+    logClose(logger);
+    logOpen(logger);
+}
+
+
+// Entry buffer.
+static void bufAppendN(logBuf_t *buf, const char *str, int len)
+{   if (buf->isFixed)
+    {   if (buf->n+len+1 > buf->m)
+            len = buf->m - buf->n - 1;
+    }
+    else if (buf->n+len+1 > buf->m)
+    {   buf->m = buf->m*2 + len + 128;
+        buf->chars = csc_ck_ralloc(buf->chars, buf->m);
+    }
+    memcpy(buf->chars+buf->n, str, len);
+    buf->n += len;
+}
+
+static void bufAppend(logBuf_t *buf, const char *str)
+{   bufAppendN(buf, str, strlen(str));
+}
+
+static void bufVprintf(logBuf_t *buf, const char *format, va_list args)
+{   va_list args2;
+    int len;
+    va_copy(args2, args);
+    len = vsnprintf(buf->chars+buf->n, buf->m-buf->n, format, args2);
+    va_end(args2);
+    if (len < 0)
+        return;
+    if (buf->isFixed)
+    {   if (buf->n+len+1 > buf->m)
+            len = buf->m - buf->n - 1;
+    }
+    else if (buf->n+len+1 > buf->m)
+    {   buf->m = buf->m*2 + len + 128;
+        buf->chars = csc_ck_ralloc(buf->chars, buf->m);
+        vsnprintf(buf->chars+buf->n, buf->m-buf->n, format, args);
+    }
+    buf->n += len;
+}
+
+static void bufPrintf(logBuf_t *buf, const char *format, ...)
+{   va_list args;
+    va_start(args, format);
+    bufVprintf(buf, format, args);
+    va_end(args);
+}
+
+// Append 'str' escaped as the inside of a JSON string.  Runs of characters
+// that need no escaping are copied in one go.
+static void bufAppendJsonChars(logBuf_t *buf, const char *str)
+{   static const char hex[] = "0123456789abcdef";
+    const char *run;
+    char esc[7];
+    unsigned char ch;
+ 
+    while (*str != '\0')
+    {   run = str;
+        while ((ch=*str)>=' ' && ch!='\"' && ch!='\\')
+            str++;
+        if (str > run)
+            bufAppendN(buf, run, str-run);
+        if (ch == '\0')
+            break;
+        esc[0] = '\\';
+        switch (ch)
+        {   case '\"':  esc[1] = '\"';  break;
+            case '\\': esc[1] = '\\'; break;
+            case '\n':  esc[1] = 'n';  break;
+            case '\r':  esc[1] = 'r';  break;
+            case '\t':  esc[1] = 't';  break;
+            case '\b':  esc[1] = 'b';  break;
+            case '\f':  esc[1] = 'f';  break;
+            default:    esc[1] = 'u';
+        }
+        if (esc[1] == 'u')
+        {   esc[2] = '0';
+            esc[3] = '0';
+            esc[4] = hex[ch>>4];
+            esc[5] = hex[ch&15];
+            bufAppendN(buf, esc, 6);
+        }
+        else
+            bufAppendN(buf, esc, 2);
+        str++;
+    }
+}
+
+// Append 'str' as a quoted JSON string.
+static void bufAppendJsonStr(logBuf_t *buf, const char *str)
+{   bufAppendN(buf, "\"", 1);
+    bufAppendJsonChars(buf, str!=NULL ? str : "(null)");
+    bufAppendN(buf, "\"", 1);
+}
+
+// Append printf() style output as a quoted JSON string.  The output is
+// formatted straight into the buffer, and only copied aside for escaping
+// if it turns out to need it.
+static void bufVprintfJsonStr(logBuf_t *buf, const char *format, va_list args)
+{   unsigned char ch;
+    char rawSpace[RecSlotLen];
+    char *raw;
+    int i;
+ 
+    bufAppendN(buf, "\"", 1);
+    i = buf->n;
+    bufVprintf(buf, format, args);
+    for (; i<buf->n; i++)
+    {   ch = buf->chars[i];
+        if (ch<' ' || ch=='\"' || ch=='\\')
+            break;
+    }
+    if (i < buf->n)
+    {   if (buf->n-i < RecSlotLen)
+            raw = rawSpace;
+        else
+            raw = csc_allocMany(char, buf->n-i+1);
+        memcpy(raw, buf->chars+i, buf->n-i);
+        raw[buf->n-i] = '\0';
+        buf->n = i;
+        bufAppendJsonChars(buf, raw);
+        if (raw != rawSpace)
+            free(raw);
+    }
+    bufAppendN(buf, "\"", 1);
+}
+
+
+// Write all of 'len' bytes of 'p' to 'fd'.  Safe to call from a signal
+// handler.
+static csc_bool_t writeAll(int fd, const char *p, int len)
+{   int nOut;
+    if (fd < 0)
+        return csc_FALSE;
+    while (len > 0)
+    {   nOut = write(fd, p, len);
+        if (nOut < 0)
+        {   if (errno == EINTR)
+                continue;
+            return csc_FALSE;
+        }
+        p += nOut;
+        len -= nOut;
+    }
+    return csc_TRUE;
+}
+
+
+// Append the structured fields 'fields' to an entry.  These are triples
+// of key, csc_jsonType_t and value, terminated by a NULL key.  JSON has no
+// infinities or NaNs, so in JSON lines these are written as null.
+static void logFields(csc_log_t *logger, logBuf_t *buf, va_list *fields)
+{   const char *key;
+    csc_jsonType_t type;
+    char numStr[csc_numConv_FloatLen+1];
+    double num;
+ 
+    while ((key=va_arg(*fields, const char*)) != NULL)
+    {   type = va_arg(*fields, int);
+        if (logger->isJson)
+        {   bufAppendN(buf, ",", 1);
+            bufAppendJsonStr(buf, key);
+            bufAppendN(buf, ":", 1);
+        }
+        else
+        {   bufAppendN(buf, " ", 1);
+            bufAppend(buf, key);
+            bufAppendN(buf, "=", 1);
+        }
+        switch (type)
+        {   case csc_jsonType_String:
+                bufAppendJsonStr(buf, va_arg(*fields, const char*));
+                break;
+            case csc_jsonType_Int:
+                bufPrintf(buf, "%d", va_arg(*fields, int));
+                break;
+            case csc_jsonType_Float:
+                num = va_arg(*fields, double);
+                if (logger->isJson && !isfinite(num))
+                    bufAppendN(buf, "null", 4);
+                else
+                    bufAppendN(buf, numStr, csc_numConv_fmtFloat(numStr, num));
+                break;
+            case csc_jsonType_Bool:
+                bufAppend(buf, va_arg(*fields, int) ? "true" : "false");
+                break;
+            default:
+                bufAppend(buf, "null");
+        }
+    }
+}
+
+
+// Returns the date and time as formatted by csc_dateTimeStr().  The
+// string is only reformatted once a second by each thread, as localtime()
+// is expensive.
+static const char *logTimeStr(void)
+{   static __thread time_t lastTime = -1;
+    static __thread char timeStr[csc_timeStrSize+1];
+    time_t now = time(NULL);
+    if (now != lastTime)
+    {   csc_dateTimeStr(timeStr);
+        lastTime = now;
+    }
+    return timeStr;
+}
+
+
+// Format a complete entry into 'buf'.  The message is 'msg' if it is not
+// NULL, otherwise it is formatted from 'format' and 'args'.  'fields' may
+// be NULL.
+static void logFormat( csc_log_t *logger
+                     , logBuf_t *buf
+                     , csc_log_level_t logLevel
+                     , const char *chanName
+                     , const char *msg
+                     , const char *format
+                     , va_list *args
+                     , va_list *fields
+                     )
+{   const char *timeStr = logTimeStr();
  
 // Make the entry.
-    fprintf(fp, "%d[%s]", (int)logLevel, timeStr);
-    if (logger->idStr)
-        fprintf(fp, "%s ", logger->idStr);
-    if (logger->isShowProcessId)
-        fprintf(fp, "%d ", (int)getpid());
-    
-// Return stuff.
-    return fp;
+    buf->n = 0;
+    if (logger->isJson)
+    {   bufPrintf(buf, "{\"level\":%d,\"time\":\"%s\"", (int)logLevel, timeStr);
+        if (logger->idStr)
+        {   bufAppend(buf, ",\"id\":");
+            bufAppendJsonStr(buf, logger->idStr);
+        }
+        if (logger->isShowProcessId)
+            bufPrintf(buf, ",\"pid\":%d", (int)getpid());
+        if (chanName)
+        {   bufAppend(buf, ",\"chan\":");
+            bufAppendJsonStr(buf, chanName);
+        }
+        bufAppend(buf, ",\"msg\":");
+        if (msg != NULL)
+            bufAppendJsonStr(buf, msg);
+        else
+            bufVprintfJsonStr(buf, format, *args);
+        if (fields)
+            logFields(logger, buf, fields);
+        bufAppendN(buf, "}\n", 2);
+    }
+    else
+    {   bufPrintf(buf, "%d[%s]", (int)logLevel, timeStr);
+        if (logger->idStr)
+            bufPrintf(buf, "%s ", logger->idStr);
+        if (logger->isShowProcessId)
+            bufPrintf(buf, "%d ", (int)getpid());
+        if (chanName)
+            bufPrintf(buf, "%s: ", chanName);
+        if (msg != NULL)
+            bufAppend(buf, msg);
+        else
+            bufVprintf(buf, format, *args);
+        if (fields)
+            logFields(logger, buf, fields);
+        bufAppendN(buf, "\n", 1);
+    }
 }
 
 
-int csc_log_str(csc_log_t *logger, csc_log_level_t logLevel, const char *msg)
-{   int retVal;
+// Write the entry in one go.  O_APPEND makes this atomic with respect to
+// other processes writing to the same file.  Called with the semaphore held.
+// The entry that reaches the size limit only flags the rotation, which is
+// done before the next entry.
+static int logWrite(csc_log_t *logger)
+{   csc_bool_t isOk;
+    logCheckRotate(logger);
+    isOk = writeAll(logger->fd, logger->buf.chars, logger->buf.n);
+    if (isOk)
+        logger->nBytes += logger->buf.n;
+    if (logger->rotateBytes>0 && logger->nBytes>=logger->rotateBytes)
+        logger->isRotate = csc_TRUE;
+    return isOk;
+}
+
+
+// Get the flight recorder ring of the calling thread, creating it or
+// sizing it to 'nSlots' if need be.  'nSlots' is read from the logger once
+// by the caller, so that it cannot change part way through an entry.
+static logRing_t *recGetRing(csc_log_t *logger, int nSlots)
+{   logRing_t *ring = pthread_getspecific(logger->recKey);
+    char *slots;
+ 
+// Create the ring.
+    if (ring == NULL)
+    {   ring = csc_allocOne(logRing_t);
+        ring->logger = logger;
+        ring->nSlots = 0;
+        ring->nAdded = 0;
+        ring->nDumped = 0;
+        ring->slots = NULL;
+        pthread_mutex_lock(&logger->recMutex);
+        ring->next = logger->rings;
+        logger->rings = ring;
+        pthread_mutex_unlock(&logger->recMutex);
+        pthread_setspecific(logger->recKey, ring);
+    }
  
-// Create initial part of entry, if the logging level is suitable.
-    FILE *fp = logGuts(logger, logLevel, &retVal);
-    if (fp == NULL)
-        return retVal;
+// Size the ring.  The old slots are freed with the lock held, so that a
+// dump in another thread is not part way through them.
+    if (ring->nSlots != nSlots)
+    {   slots = csc_allocMany(char, nSlots*RecSlotLen);
+        pthread_mutex_lock(&logger->recMutex);
+        if (ring->slots != NULL)
+            free(ring->slots);
+        ring->slots = slots;
+        ring->nSlots = nSlots;
+        ring->nAdded = 0;
+        ring->nDumped = 0;
+        pthread_mutex_unlock(&logger->recMutex);
+    }
  
-// Print the message.
-    fprintf(fp, "%s\n", msg);
+    return ring;
+}
+
+
+// The slot for the next entry of the calling thread's ring.  No I/O and
+// no locking, as the ring belongs to the calling thread.
+static char *recNextSlot(logRing_t *ring)
+{   return ring->slots + (ring->nAdded % ring->nSlots)*RecSlotLen;
+}
+
+
+// Make sure that a slot holding 'len' characters is a terminated line,
+// and then add it to the ring.
+static void recEndSlot(logRing_t *ring, char *slot, int len)
+{   if (len > RecSlotLen-2)
+        len = RecSlotLen-2;
+    if (len==0 || slot[len-1]!='\n')
+        slot[len++] = '\n';
+    slot[len] = '\0';
+    __sync_synchronize();
+    ring->nAdded++;
+}
+
+
+// Record an already formatted entry, truncating it to fit a slot.
+static void recAdd(csc_log_t *logger, int nSlots, const char *entry, int len)
+{   logRing_t *ring = recGetRing(logger, nSlots);
+    char *slot = recNextSlot(ring);
+    if (len > RecSlotLen-2)
+        len = RecSlotLen-2;
+    memcpy(slot, entry, len);
+    recEndSlot(ring, slot, len);
+}
+
+
+// Write the entries of every ring that have not been dumped to the log
+// file, oldest first.  Other threads carry on adding entries meanwhile,
+// so each entry is copied out of its slot, and skipped if by then the
+// slot is being reused.  When called from a signal handler, 'isLock'
+// should be false, as the interrupted code may hold the lock.
+static void recDump(csc_log_t *logger, csc_bool_t isLock)
+{   static const char head[] = "---- Flight recorder begins ----\n";
+    static const char tail[] = "---- Flight recorder ends ----\n";
+    static const char jsonHead[] = "{\"recorder\":\"begins\"}\n";
+    static const char jsonTail[] = "{\"recorder\":\"ends\"}\n";
+    logRing_t *ring;
+    char entry[RecSlotLen];
+    unsigned long iEntry, nAdded;
+ 
+    if (isLock)
+        pthread_mutex_lock(&logger->recMutex);
+    if (logger->isJson)
+        writeAll(logger->fd, jsonHead, sizeof(jsonHead)-1);
+    else
+        writeAll(logger->fd, head, sizeof(head)-1);
+    for (ring=logger->rings; ring!=NULL; ring=ring->next)
+    {   nAdded = ring->nAdded;
+        __sync_synchronize();
+        iEntry = ring->nDumped;
+        if (nAdded-iEntry > (unsigned long)ring->nSlots)
+            iEntry = nAdded - ring->nSlots;
+        for (; iEntry<nAdded; iEntry++)
+        {   memcpy(entry, ring->slots + (iEntry%ring->nSlots)*RecSlotLen, RecSlotLen);
+            __sync_synchronize();
+            if (ring->nAdded-iEntry >= (unsigned long)ring->nSlots)
+                continue;
+            writeAll(logger->fd, entry, strnlen(entry, RecSlotLen));
+        }
+        ring->nDumped = nAdded;
+    }
+    if (logger->isJson)
+        writeAll(logger->fd, jsonTail, sizeof(jsonTail)-1);
+    else
+        writeAll(logger->fd, tail, sizeof(tail)-1);
+    if (isLock)
+        pthread_mutex_unlock(&logger->recMutex);
+}
+
+
+csc_bool_t csc_log_setRecorder(csc_log_t *logger, int nEntries)
+{   if (nEntries < 0)
+        return csc_FALSE;
+    logger->recN = nEntries;
+    return csc_TRUE;
+}
+
+
+void csc_log_recorderDump(csc_log_t *logger)
+{   if (logger->recN == 0)
+        return;
+    sem_wait(&logger->sem);
+    recDump(logger, csc_TRUE);
+    sem_post(&logger->sem);
+}
+
+
+void csc_log_recorderHndl(int sigNum, void *context)
+{   csc_log_t *logger = context;
+    if (logger->recN > 0)
+        recDump(logger, csc_FALSE);
  
-// Close the file.
-    fclose(fp);
+// Let crash signals have their default effect once the handler returns.
+    if (  sigNum==SIGSEGV || sigNum==SIGBUS || sigNum==SIGFPE
+       || sigNum==SIGILL || sigNum==SIGABRT
+       )
+    {   signal(sigNum, SIG_DFL);
+        raise(sigNum);
+    }
+}
+
 
+// Makes an entry.  The message is 'msg' if it is not NULL, otherwise it
+// is formatted from 'format' and 'args'.  'fields' are any structured
+// fields, or NULL.
+static int logEntry( csc_log_t *logger
+                   , csc_log_level_t logLevel
+                   , csc_bool_t isOn
+                   , const char *chanName
+                   , const char *msg
+                   , const char *format
+                   , va_list *args
+                   , va_list *fields
+                   )
+{   int retVal;
+    int recN = logger->recN;
+ 
+// Only log if logLevel is greater or equal to the threshold.  Otherwise
+// format straight into the flight recorder, if there is one.
+    if (!isOn)
+    {   if (recN > 0)
+        {   logRing_t *ring = recGetRing(logger, recN);
+            logBuf_t slotBuf;
+            slotBuf.chars = recNextSlot(ring);
+            slotBuf.m = RecSlotLen-1;
+            slotBuf.isFixed = csc_TRUE;
+            logFormat(logger, &slotBuf, logLevel, chanName, msg, format, args, fields);
+            recEndSlot(ring, slotBuf.chars, slotBuf.n);
+        }
+        return csc_TRUE;
+    }
+ 
+// Prevent concurrent write to the logfile.
+    sem_wait(&logger->sem);
+ 
+// Format the entry.
+    logFormat(logger, &logger->buf, logLevel, chanName, msg, format, args, fields);
+ 
+// Keep the flight recorder up to date, and dump it if things are fatal.
+    if (recN > 0)
+    {   if (logLevel == csc_log_FATAL)
+            recDump(logger, csc_TRUE);
+        recAdd(logger, recN, logger->buf.chars, logger->buf.n);
+    }
+ 
+// Write the entry.
+    retVal = logWrite(logger);
+ 
 // Allow other threads to write to the logfile.
     sem_post(&logger->sem);
  
-    return csc_TRUE;
+    return retVal;
+}
+
+
+int csc_log_str(csc_log_t *logger, csc_log_level_t logLevel, const char *msg)
+{   return logEntry( logger, logLevel, logLevel>=logger->level
+                   , NULL, msg, NULL, NULL, NULL);
 }
 
 
@@ -148,27 +904,82 @@ int csc_log_printf( csc_log_t *logger
                  , const char *format
                  , ...
                  )
-{   int retVal;
-    va_list args;
+{   va_list args;
+    int retVal;
+ 
+    if (logLevel<logger->level && logger->recN==0)
+        return csc_TRUE;
  
-// Create initial par of entry, if the logging level is suitable.
-    FILE *fp = logGuts(logger, logLevel, &retVal);
-    if (fp == NULL)
-        return retVal;
+    va_start(args, format);
+    retVal = logEntry( logger, logLevel, logLevel>=logger->level
+                     , NULL, NULL, format, &args, NULL);
+    va_end(args);
+    return retVal;
+}
+
+
+int csc_log_fields( csc_log_t *logger
+                  , csc_log_level_t logLevel
+                  , const char *msg
+                  , ...
+                  )
+{   va_list fields;
+    int retVal;
  
-// Print the message.
-   va_start(args, format);
-   vfprintf(fp, format, args);
-   va_end(args);
-   fprintf(fp, "\n");
+    if (logLevel<logger->level && logger->recN==0)
+        return csc_TRUE;
  
-// Close the file.
-    fclose(fp);
+    va_start(fields, msg);
+    retVal = logEntry( logger, logLevel, logLevel>=logger->level
+                     , NULL, msg, NULL, NULL, &fields);
+    va_end(fields);
+    return retVal;
+}
 
-// Allow other threads to write to the logfile.
-    sem_post(&logger->sem);
 
-    return csc_TRUE;
+int csc_logChan_str(csc_logChan_t *chan, csc_log_level_t logLevel, const char *msg)
+{   return logEntry( chan->logger, logLevel, chanIsOn(chan, logLevel)
+                   , chan->name, msg, NULL, NULL, NULL);
+}
+
+
+int csc_logChan_printf( csc_logChan_t *chan
+                      , csc_log_level_t logLevel
+                      , const char *format
+                      , ...
+                      )
+{   csc_log_t *logger = chan->logger;
+    csc_bool_t isOn = chanIsOn(chan, logLevel);
+    va_list args;
+    int retVal;
+ 
+    if (!isOn && logger->recN==0)
+        return csc_TRUE;
+ 
+    va_start(args, format);
+    retVal = logEntry(logger, logLevel, isOn, chan->name, NULL, format, &args, NULL);
+    va_end(args);
+    return retVal;
+}
+
+
+int csc_logChan_fields( csc_logChan_t *chan
+                      , csc_log_level_t logLevel
+                      , const char *msg
+                      , ...
+                      )
+{   csc_log_t *logger = chan->logger;
+    csc_bool_t isOn = chanIsOn(chan, logLevel);
+    va_list fields;
+    int retVal;
+ 
+    if (!isOn && logger->recN==0)
+        return csc_TRUE;
+ 
+    va_start(fields, msg);
+    retVal = logEntry(logger, logLevel, isOn, chan->name, msg, NULL, NULL, &fields);
+    va_end(fields);
+    return retVal;
 }
 
 
@@ -178,7 +989,7 @@ void csc_log_assertFail( csc_log_t *log
                        , const char *expr
                        )
 {   csc_log_printf( log, csc_log_FATAL
-                  , "Assertion failure (%s) in file \"%s\" at line %d" 
+                  , "Assertion failure (%s) in file \"%s\" at line %d"
                   , expr, fname, lineNo
                   );
     exit(1);
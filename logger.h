@@ -4,9 +4,12 @@
 #ifndef csc_LOG_H
 #define csc_LOG_H 1
 
+#include <time.h>
 #include "std.h"
+#include "json.h"
 
 typedef struct csc_log_t csc_log_t;
+typedef struct csc_logChan_t csc_logChan_t;
 
 typedef enum
 {   csc_log_TRACE = 1,   // For debugging your server.
@@ -36,6 +39,31 @@ void csc_log_setIdStr(csc_log_t *logger, const char *str);
 void csc_log_setIsShowPid(csc_log_t *logger, csc_bool_t isShow);
 
 
+// Rotate the log file when it reaches 'maxBytes' in size, or every
+// 'intervalSecs' seconds, whichever comes first.  Pass 0 for either to
+// disable that condition.  On rotation the log file is renamed to
+// "path.1", any "path.1" is renamed to "path.2" and so on, keeping at most
+// 'nKeep' old files.  Rotation is by rename(), so no entries are lost, and
+// other processes sharing the log file follow on to the new file.  The
+// size is counted from the entries this logger writes, so a file shared
+// with other processes may grow past 'maxBytes' before it is rotated.
+// Returns csc_FALSE if any argument is negative.
+csc_bool_t csc_log_setRotate(csc_log_t *logger, long maxBytes, int intervalSecs, int nKeep);
+
+
+// Close and reopen the log file before the next entry is written.  Use
+// this after an external tool has moved the log file aside.  Safe to call
+// from a signal handler.
+void csc_log_reopen(csc_log_t *logger);
+
+
+// Calls csc_log_reopen() with 'context' as the logger.  This allows the
+// reopen to be wired to a signal, e.g:-
+//
+//      csc_signal_addHndl(SIGUSR1, csc_log_reopenHndl, log);
+void csc_log_reopenHndl(int sigNum, void *context);
+
+
 // Destructor.
 void csc_log_free(csc_log_t *logger);
 
@@ -60,6 +88,143 @@ int csc_log_printf( csc_log_t *logger
                  );
 
 
+// Returns csc_TRUE if an entry at 'logLevel' would be logged or recorded.
+csc_bool_t csc_log_isOn(csc_log_t *logger, csc_log_level_t logLevel);
+
+
+// ------- Channels -------
+// A channel is a named part of the log with its own logging threshold,
+// so that e.g. TRACE may be turned on for one subsystem only.  Entries
+// are written to the logger's file with the channel name after the
+// prefix.  Channels are owned by the logger and freed with it.
+
+// Get the channel called 'name', creating it if it does not exist.  A new
+// channel follows the logging threshold of the logger until its level is set.
+csc_logChan_t *csc_log_getChan(csc_log_t *logger, const char *name);
+
+// Change the logging threshold of a channel at runtime.  A 'logLevel' of
+// zero makes the channel follow the logger again.  Returns csc_TRUE if
+// logLevel has acceptable value, csc_FALSE otherwise.
+csc_bool_t csc_logChan_setLevel(csc_logChan_t *chan, csc_log_level_t logLevel);
+csc_bool_t csc_log_setChanLevel(csc_log_t *logger, const char *name, csc_log_level_t logLevel);
+
+// Returns csc_TRUE if an entry at 'logLevel' would be logged or recorded by 'chan'.
+csc_bool_t csc_logChan_isOn(csc_logChan_t *chan, csc_log_level_t logLevel);
+
+// As csc_log_str() and csc_log_printf(), but for a channel.
+int csc_logChan_str(csc_logChan_t *chan, csc_log_level_t logLevel, const char *msg);
+int csc_logChan_printf( csc_logChan_t *chan
+                      , csc_log_level_t logLevel
+                      , const char *fmt
+                      , ...
+                      );
+
+
+// ------- Structured entries -------
+
+// Make every entry a compact JSON object on a line of its own, e.g:-
+//
+//      {"level":2,"time":"20170916.101500","pid":123,"msg":"Accepted"}
+//
+// The "id", "pid" and "chan" members are present only when an ID string,
+// process ID display or channel apply.  The default is csc_FALSE, which
+// gives the traditional "level[time]" entries.
+void csc_log_setJsonLines(csc_log_t *logger, csc_bool_t isJson);
+
+// Make an entry with message 'msg' followed by structured fields.  The
+// fields are given as triples of key, type and value, terminated by NULL.
+// Types are csc_jsonType_String (const char*), csc_jsonType_Int (int),
+// csc_jsonType_Float (double), csc_jsonType_Bool (csc_bool_t) and
+// csc_jsonType_Null (no value), e.g:-
+//
+//      csc_log_fields( log, csc_log_NOTICE, "Accepted connection"
+//                    , "ip", csc_jsonType_String, cliAddr
+//                    , "port", csc_jsonType_Int, portNum
+//                    , NULL);
+//
+// With JSON lines the fields become members of the object, and a float
+// that is infinite or NaN is written as null.  Otherwise they are appended
+// to the entry as key=value.  The entry is serialised
+// straight into the logger's reused buffer, with no JSON objects built.
+int csc_log_fields( csc_log_t *logger
+                  , csc_log_level_t logLevel
+                  , const char *msg
+                  , ...
+                  );
+int csc_logChan_fields( csc_logChan_t *chan
+                      , csc_log_level_t logLevel
+                      , const char *msg
+                      , ...
+                      );
+
+
+// ------- Rate limited and sampled entries -------
+// These macros log at most 'perSec' entries per second, or one entry in
+// every 'k', from each call site.  The level is checked first, so when
+// the entry would not be logged the arguments are not even evaluated,
+// e.g:-
+//
+//      csc_log_printfRate(log, csc_log_TRACE, 10, "got %s", expensive(x));
+
+// The second, in the high 32 bits, and the count of entries in it, in
+// the low 32 bits, so that both change together.
+typedef struct
+{   unsigned long long secCount;
+} csc_log_rate_t;
+
+csc_bool_t csc_log_rateOk(csc_log_rate_t *rate, int perSec);
+csc_bool_t csc_log_sampleOk(unsigned long *count, int k);
+
+#define csc_log_printfRate(log, lvl, perSec, ...)  do {                       \
+    static csc_log_rate_t csc_log_rate_;                                      \
+    if (csc_log_isOn(log,lvl) && csc_log_rateOk(&csc_log_rate_,perSec))       \
+        csc_log_printf(log, lvl, __VA_ARGS__);                                \
+} while (0)
+
+#define csc_log_printfSample(log, lvl, k, ...)  do {                          \
+    static unsigned long csc_log_count_;                                      \
+    if (csc_log_isOn(log,lvl) && csc_log_sampleOk(&csc_log_count_,k))         \
+        csc_log_printf(log, lvl, __VA_ARGS__);                                \
+} while (0)
+
+#define csc_logChan_printfRate(chan, lvl, perSec, ...)  do {                  \
+    static csc_log_rate_t csc_log_rate_;                                      \
+    if (csc_logChan_isOn(chan,lvl) && csc_log_rateOk(&csc_log_rate_,perSec))  \
+        csc_logChan_printf(chan, lvl, __VA_ARGS__);                           \
+} while (0)
+
+#define csc_logChan_printfSample(chan, lvl, k, ...)  do {                     \
+    static unsigned long csc_log_count_;                                      \
+    if (csc_logChan_isOn(chan,lvl) && csc_log_sampleOk(&csc_log_count_,k))    \
+        csc_logChan_printf(chan, lvl, __VA_ARGS__);                           \
+} while (0)
+
+
+// ------- Flight recorder -------
+// When the flight recorder is on, every entry is kept in memory as if the
+// logging level were TRACE, regardless of the logging threshold.  Each
+// thread has its own ring of the last 'nEntries' entries, so recording
+// takes no locks and does no I/O.  The rings are written to the log file
+// when a FATAL entry is made (which includes csc_log_assertFail()), when
+// csc_log_recorderDump() is called, or on a signal wired to
+// csc_log_recorderHndl().  Recorded entries are truncated to 255 chars.
+
+// Turn the flight recorder on with rings of 'nEntries', or off if zero.
+// Returns csc_FALSE if 'nEntries' is negative.
+csc_bool_t csc_log_setRecorder(csc_log_t *logger, int nEntries);
+
+// Write the flight recorder rings to the log file, and empty them.
+void csc_log_recorderDump(csc_log_t *logger);
+
+// Signal handler for csc_signal_addHndl() with the logger as context,
+// which dumps the flight recorder.  For crash signals (SIGSEGV, SIGBUS,
+// SIGFPE, SIGILL and SIGABRT) the default action is then restored and the
+// signal raised again, so that the program still dies.  e.g:-
+//
+//      csc_signal_addHndl(SIGSEGV, csc_log_recorderHndl, log);
+void csc_log_recorderHndl(int sigNum, void *context);
+
+
 // If we set the logging level to TRACE then this puts an entry into the
 // log file with the file name and line number.
 // 
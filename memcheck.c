@@ -4,6 +4,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <pthread.h>
 
 #define EXTRA_SIZE (sizeof(memchk_type) + sizeof(csc_ulong))
 #define CKVAL (1431655765)
@@ -31,6 +32,11 @@ typedef struct memchk       /* size must be integral no *sizeof(double) */
 
 long mck_maxchunks = ((unsigned long)-1 >> 1);
 
+/* Guards the list of chunks, so that memory may be allocated and freed
+ * from several threads.
+ */
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+
 static long nmlc=0;
 static memchk_type anchor = { &anchor, &anchor, (char*)NULL, 0 };
 static memchk_type *lo_adr = (memchk_type*)NULL;
@@ -65,6 +71,7 @@ char *csc_mck_malloc(csc_uint size, int line, char *file)
     if ((header=(memchk_type*)malloc((csc_uint)(size+EXTRA_SIZE))) == NULL)
         return NULL;
     affirm(!align_err(header));
+    pthread_mutex_lock(&mutex);
  
 /* Set upper and lower boundaries. */
     hi = (memchk_type*)((char*)header + size + EXTRA_SIZE);
@@ -105,6 +112,7 @@ char *csc_mck_malloc(csc_uint size, int line, char *file)
  
 /* OK. */
     nmlc++;
+    pthread_mutex_unlock(&mutex);
     return block;
 }
 
@@ -135,13 +143,15 @@ void csc_mck_free(char *block, int line, char *file)
 {   memchk_type *header;
  
     header = (memchk_type*)(block - sizeof(memchk_type));
+    pthread_mutex_lock(&mutex);
     freecheck(header, line,file);
     (header->next)->prev = header->prev;
     (header->prev)->next = header->next;
     /* header->prev = NULL; */
     /* header->next = NULL; */
-    free((char*)header);
     nmlc--;
+    pthread_mutex_unlock(&mutex);
+    free((char*)header);
 }
 
 
@@ -160,12 +170,15 @@ char *csc_mck_realloc(char *block, csc_uint size, int line, char *file)
  
 /* Check the old memory. */
     header = (memchk_type*)(block - sizeof(memchk_type));
+    pthread_mutex_lock(&mutex);
     freecheck(header, line,file);
  
 /* Get the memory. */
     header = (memchk_type*)realloc((char*)header, (csc_uint)(size+EXTRA_SIZE));
     if (header == NULL)
+    {   pthread_mutex_unlock(&mutex);
         return NULL;
+    }
  
 /* Set upper and lower boundaries. */
     hi = (memchk_type*)((char*)header + size + EXTRA_SIZE);
@@ -185,6 +198,7 @@ char *csc_mck_realloc(char *block, csc_uint size, int line, char *file)
     (header->prev)->next = header;
  
 /* OK. */
+    pthread_mutex_unlock(&mutex);
     return block;
 }
 
@@ -212,6 +226,7 @@ void csc_mck_exit(int status, int line, char *file)
 int csc_mck_checkmem(int flag, int line, char *file)
 {   memchk_type *pt;
     int err=csc_FALSE;
+    pthread_mutex_lock(&mutex);
     if ((anchor.next)->prev != &anchor)
         err = csc_TRUE;
     for (pt=anchor.next; pt!=&anchor && !err; pt=pt->next)
@@ -223,6 +238,7 @@ int csc_mck_checkmem(int flag, int line, char *file)
          ||  memcmp(pt->end, (char*)(&pt->ckval), sizeof(csc_ulong))  )
             err = csc_TRUE;
     }
+    pthread_mutex_unlock(&mutex);
     if (err)
     {   if (flag)
             msg_quit("Non allocated memory overwritten", file, line);
@@ -275,9 +291,11 @@ static void msg_quit(char *msg, char *file, int line)
 void csc_mck_print(FILE *fout)
 {   memchk_type *pt;
  
+    pthread_mutex_lock(&mutex);
     for (pt=anchor.next; pt!=&anchor; pt=pt->next)
     {   fprintf(fout, "%ld %s\n", pt->line_no, pt->fname);
     }
+    pthread_mutex_unlock(&mutex);
 }
 
 
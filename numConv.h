@@ -0,0 +1,39 @@
+// Author: Dr Stephen Braithwaite.
+// This work is licensed under a Creative Commons Attribution-ShareAlike 4.0 International License.
+
+#ifndef csc_NUMCONV_H
+#define csc_NUMCONV_H 1
+
+#include <stdint.h>
+#include "std.h"
+
+// Conversions between numbers and their decimal text, without going
+// through the C library's locale-aware printf() and strtod() in the usual
+// cases.  A double is written with the fewest digits that read back as
+// exactly the same double.
+
+// The most characters written for a 64 bit integer or a double, not
+// counting the '\0'.
+#define csc_numConv_IntLen 20
+#define csc_numConv_FloatLen 24
+
+
+// Write 'val' in decimal to 'buf', which must have room for
+// csc_numConv_IntLen+1 characters.  Returns the number written, not
+// counting the '\0'.
+int csc_numConv_fmtInt(char *buf, int64_t val);
+
+// Write 'val' to 'buf' with the fewest significant digits that read back
+// as 'val', which must have room for csc_numConv_FloatLen+1 characters.
+// The form is as for printf("%.17g"), so a value with a decimal exponent
+// from -4 to 16 is written without one, and a whole number has no decimal
+// point.  Returns the number of characters written, not counting the '\0'.
+int csc_numConv_fmtFloat(char *buf, double val);
+
+// Set '*val' to the double nearest to 'mant' times ten to the 'exp10',
+// negated if 'isNeg'.  Returns csc_FALSE, without setting '*val', in the
+// rare cases that this cannot be decided quickly, when the caller should
+// fall back to strtod().
+csc_bool_t csc_numConv_decToFloat(uint64_t mant, int exp10, csc_bool_t isNeg, double *val);
+
+#endif
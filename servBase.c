@@ -26,6 +26,9 @@
 #define ConfIdentMaxThreads "MaxThreads"
 #define ConfIdentBacklog "Backlog"
 #define ConfIdentLogLevel "LogLevel"
+#define ConfIdentLogRotateBytes "LogRotateBytes"
+#define ConfIdentLogRotateSecs "LogRotateSecs"
+#define ConfIdentLogRotateKeep "LogRotateKeep"
 
 #define srvModelStr_OneByOne "OneByOne"
 #define srvModel_OneByOne 1
@@ -79,6 +82,10 @@ static int serv_OneByOne( csc_srv_t *srv
             csc_log_str(log, csc_log_NOTICE
                         , "Server terminating due to caught signal");
         }
+        else if (rwSock == -2)
+        {   // Interrupted by another signal, e.g. SIGUSR1 to reopen the log.
+            continue;
+        }
         else if (rwSock < 0)
         {   csc_log_str(log, csc_log_FATAL, csc_srv_getErrMsg(srv)); 
             servSig.isQuit = csc_TRUE;
@@ -135,6 +142,10 @@ static int serv_Forking( csc_srv_t *srv
             csc_log_str(log, csc_log_NOTICE
                         , "Server terminating due to caught signal");
         }
+        else if (rwSock == -2)
+        {   // Interrupted by another signal, e.g. SIGUSR1 to reopen the log.
+            continue;
+        }
         else if (rwSock < 0)
         {   csc_log_str(log, csc_log_FATAL, csc_srv_getErrMsg(srv)); 
             servSig.isQuit = csc_TRUE;
@@ -234,6 +245,7 @@ int csc_servBase_server( char *connType
                        , void *local      // Values to pass to doConn() and to doInit().
                        )
 {   int retVal = csc_TRUE;
+    const char *rotBytesStr, *rotSecsStr, *rotKeepStr;
     const char *logLevelStr, *portNumStr, *backlogStr, *ipStr, *maxThreadsStr;
     int iniFileLineNum, portNum, srvModel, backlog, maxThreads, result;
  
@@ -249,6 +261,7 @@ int csc_servBase_server( char *connType
         retVal = csc_FALSE; 
         goto cleanup;
     }
+    csc_signal_addHndl(SIGUSR1, csc_log_reopenHndl, log);
  
 // Check the server model.
     if (csc_streq(srvModelStr,srvModelStr_OneByOne))
@@ -305,6 +318,33 @@ int csc_servBase_server( char *connType
         }
     }
  
+// Get and set log rotation.
+    rotBytesStr = csc_ini_getStr(ini, ConfSection, ConfIdentLogRotateBytes);
+    rotSecsStr = csc_ini_getStr(ini, ConfSection, ConfIdentLogRotateSecs);
+    rotKeepStr = csc_ini_getStr(ini, ConfSection, ConfIdentLogRotateKeep);
+    if (rotBytesStr!=NULL || rotSecsStr!=NULL)
+    {   if (rotBytesStr == NULL)
+            rotBytesStr = "0";
+        if (rotSecsStr == NULL)
+            rotSecsStr = "0";
+        if (rotKeepStr == NULL)
+            rotKeepStr = "5";
+        if (  !csc_isValid_int(rotBytesStr)
+           || !csc_isValid_int(rotSecsStr)
+           || !csc_isValid_int(rotKeepStr)
+           || !csc_log_setRotate(log, atol(rotBytesStr), atoi(rotSecsStr), atoi(rotKeepStr))
+           )
+        {   csc_log_printf( log
+                         , csc_log_FATAL
+                         , "Invalid log rotation in section \"%s\" configuration file \"%s\""
+                         , ConfSection
+                         , configPath
+                         );
+            retVal = csc_FALSE; 
+            goto cleanup;
+        }
+    }
+ 
 // Get the port number.
     portNumStr = csc_ini_getAllocStr(ini, ConfSection, ConfIdentPort);
     if (portNumStr==NULL || !csc_isValid_int(portNumStr))
@@ -400,7 +440,9 @@ cleanup:  // Free resources.
     if (ini != NULL)
         csc_ini_free(ini);
     if (log != NULL)
+    {   csc_signal_delHndl(SIGUSR1, log);
         csc_log_free(log);
+    }
     if (srv != NULL)
         csc_srv_free(srv);
  
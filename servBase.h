@@ -31,7 +31,8 @@
 // established.  
 // 
 // It will call the routine doConn() for every connection received.
-// Connections are logged at the NOTICE level.
+// Connections are logged at the NOTICE level.  The log file is reopened
+// on receipt of SIGUSR1.
 // 
 // This routine takes the following arguments:-
 // 
@@ -47,6 +48,9 @@
 //  section:-
 //  *   PortNum -    (required) The port number to listen on.
 //  *   LogLevel     (optional. Dflt=2 (i.e. NOTICE)).  Logging level.
+//  *   LogRotateBytes (optional. Dflt=0 (i.e. never)).  Rotate log at this size.
+//  *   LogRotateSecs  (optional. Dflt=0 (i.e. never)).  Rotate log at this interval.
+//  *   LogRotateKeep  (optional. Dflt=5).  Number of rotated log files kept.
 //  *   IP -         (optional. Dflt=all interfaces) the IP number to listen on.
 //  *   MaxThreads - (optional. Dflt=10) Maximum simultaneous connections.
 //  *   Backlog -    (optional. Dflt=10) Max size of connection queue.